@@ -0,0 +1,132 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file autobaud.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "autobaud.h"
+
+//-- Rates autopilots are usually set to, most common first
+static const UINT32 kRates[] PROGMEM = {
+    57600, 115200, 921600, 460800, 230400, 1500000, 2000000, 500000, 1000000, 38400};
+
+#define AUTOBAUD_RATE_COUNT     (sizeof(kRates) / sizeof(kRates[0]))
+
+//---------------------------------------------------------------------------------
+AutoBaud::AutoBaud()
+    : _active(false), _rate(DEFAULT_UART_SPEED), _start(0), _next(0), _trials(0), _measured(0)
+    , _sysid(0), _frames(0), _frame_bytes(0), _raw_bytes(0)
+{
+}
+
+//---------------------------------------------------------------------------------
+void AutoBaud::begin(UINT32 rate, UINT32 now)
+{
+    _active = true;
+    _next = 0;
+    _trials = 0;
+    _measured = 0;
+    _try(rate, now);
+}
+
+//---------------------------------------------------------------------------------
+void AutoBaud::_try(UINT32 rate, UINT32 now)
+{
+    _rate = rate;
+    _start = now;
+    _trials++;
+    _framer.reset();
+    _frames = 0;
+    _frame_bytes = 0;
+    _raw_bytes = 0;
+}
+
+//---------------------------------------------------------------------------------
+void AutoBaud::feed(const UINT8 *buffer, UINT32 len)
+{
+    while (len > 0)
+    {
+        UINT8 result;
+        UINT32 used = _framer.parse(buffer, len, result);
+        buffer += used;
+        len -= used;
+        if (result == FRAMER_FRAME)
+        {
+            //-- At the wrong rate a start byte shows up now and then, but
+            //   rarely twice from the same "system"
+            if (_frames == 0)
+                _sysid = _framer.sysId();
+            if (_framer.sysId() == _sysid)
+                _frames++;
+            _frame_bytes += _framer.length();
+        }
+        else if (result == FRAMER_RAW)
+            _raw_bytes += _framer.length();
+    }
+}
+
+//---------------------------------------------------------------------------------
+bool AutoBaud::poll(UINT32 now, UINT32 measured)
+{
+    if (!_active)
+        return false;
+
+    if (_frames >= AUTOBAUD_FRAMES && _raw_bytes * 8 <= _frame_bytes)
+    {
+        _active = false;
+        return false;
+    }
+
+    //-- A new pulse width estimate jumps the queue, once
+    if (measured && measured != _rate && measured != _measured)
+    {
+        _measured = measured;
+        _try(measured, now);
+        return true;
+    }
+
+    if (now - _start >= AUTOBAUD_WINDOW)
+    {
+        UINT32 rate = pgm_read_dword(&kRates[_next]);
+        _next = (_next + 1) % AUTOBAUD_RATE_COUNT;
+        if (rate == _rate)
+        {
+            rate = pgm_read_dword(&kRates[_next]);
+            _next = (_next + 1) % AUTOBAUD_RATE_COUNT;
+        }
+        _try(rate, now);
+        return true;
+    }
+    return false;
+}
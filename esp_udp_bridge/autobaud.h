@@ -0,0 +1,87 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file autobaud.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Finds the autopilot's UART rate. The UART's pulse width measurement,
+ * when it has one, says which rate to try first; otherwise the candidate
+ * rates are tried in turn. A rate is accepted once a few MAVLink frames
+ * from one system arrive with next to no stray bytes between them.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef AUTOBAUD_H
+#define AUTOBAUD_H
+
+#include "common.h"
+#include "mavlink_framer.h"
+
+#define AUTOBAUD_WINDOW         2100    // ms listened at each rate (two 1 Hz heartbeats)
+#define AUTOBAUD_FRAMES         2       // Frames from one system that confirm a rate
+
+class AutoBaud
+{
+public:
+    AutoBaud();
+
+    //-- Starts searching from the given rate
+    void        begin       (UINT32 rate, UINT32 now);
+    bool        active      () const { return _active; }
+    //-- Rate being tried, or the one that was found
+    UINT32      rate        () const { return _rate; }
+    UINT16      trials      () const { return _trials; }
+
+    //-- Looks at bytes received at the current rate
+    void        feed        (const UINT8 *buffer, UINT32 len);
+    //-- measured is the UART's pulse width estimate (0 if none). Returns true
+    //   when the UART has to be restarted at rate().
+    bool        poll        (UINT32 now, UINT32 measured);
+
+private:
+    void        _try        (UINT32 rate, UINT32 now);
+
+private:
+    MavlinkFramer _framer;
+    bool        _active;
+    UINT32      _rate;
+    UINT32      _start;
+    UINT8       _next;      // Next candidate to try
+    UINT16      _trials;
+    UINT32      _measured;  // Pulse width estimate already tried
+    UINT8       _sysid;     // System of the first frame at this rate
+    UINT8       _frames;    // Frames from _sysid
+    UINT32      _frame_bytes;
+    UINT32      _raw_bytes;
+};
+
+#endif
@@ -38,16 +38,27 @@
 #include "bridge.h"
 #include "parameters.h"
 
+#include <new>
+
 //---------------------------------------------------------------------------------
-ESP8266Bridge::ESP8266Bridge()
-    : _udp_port(DEFAULT_UDP_HPORT), _baudrate(DEFAULT_UART_SPEED)
+ESP8266Bridge::ESP8266Bridge(BridgeSerial *serial, BridgeUdp *udp, BridgeTcp *tcp, BridgeTcp *ws)
+    : _baudrate(DEFAULT_UART_SPEED), _receivePermission(true)
+    , _rx_mark_head(0), _rx_mark_tail(0), _rx_time(0), _tx_policy(DEFAULT_UART_TX_POLICY)
+    , _queue(NULL), _queue_len(0), _queue_size(UAS_QUEUE_SIZE), _queue_frames(0), _queue_threshold(DEFAULT_QUEUE_THRESHOLD)
+    , _queue_timeout(DEFAULT_QUEUE_TIMEOUT), _queue_time(0), _queue_clients(UDP_CLIENTS_ALL)
+    , _compress(false), _fec_clients(UDP_CLIENTS_ALL), _fec_time(0), _congested(false), _congested_time(0), _retry(NULL), _retry_clients(0), _retry_count(0)
+    , _serial(serial), _udp(udp), _ip(0), _udp_port(DEFAULT_UDP_HPORT), _link_header(false)
+    , _reliable(false), _rel_acks(0), _tcp(tcp), _tcp_framers(NULL), _ws(ws), _ws_framers(NULL)
 {
-    //    memset(&_buf, 0, sizeof(_buf));
+    memset(&_queue_stats, 0, sizeof(_queue_stats));
+    memset(&_compress_stats, 0, sizeof(_compress_stats));
+    memset(&_route_stats, 0, sizeof(_route_stats));
+    memset(&_stats, 0, sizeof(_stats));
 }
 
 //---------------------------------------------------------------------------------
 //-- Initialize
-void ESP8266Bridge::begin(IPAddress gcsIP, UINT16 udpHPort, UINT16 udpCPort, UINT32 serial_baudRate)
+void ESP8266Bridge::begin(UINT32 gcsIP, UINT16 udpHPort, UINT16 udpCPort, UINT32 serial_baudRate)
 {
     // UDP Begin
     {
@@ -55,50 +66,272 @@ void ESP8266Bridge::begin(IPAddress gcsIP, UINT16 udpHPort, UINT16 udpCPort, UIN
         //-- Init variables that shouldn't change unless we reboot
         _udp_port = udpHPort;
         //-- Start UDP
-        _udp.begin(udpCPort);
+        _udp->begin(udpCPort);
+        //-- GCS endpoints are learned from uplink traffic; the fixed host
+        //   port destination is only used when enabled
+        _clients.begin(getMaxClients(), (UINT32)getClientTimeout() * 1000);
+        if (getStaticHostEnabled())
+            _clients.setStatic(_ip, _udp_port);
+        _link_header = getUdpLinkHeader() != 0;
+        _reliable = getUdpReliable() != 0;
+        _rel_acks = 0;
+        for (UINT8 i = 0; i < MAX_UDP_CLIENTS; i++)
+        {
+            _links[i].reset();
+            _rel[i].reset();
+        }
+    }
+
+    // TCP Begin
+    {
+        //-- What TCP and WebSocket need per client comes from the heap, and
+        //   only with their port set (about 9.5 and 10 KB)
+        if (getWifiTcpPort() && !_tcp_framers)
+            _tcp_framers = new (std::nothrow) MavlinkFramer[TCP_MAX_CLIENTS];
+        _tcp_clients.begin(_tcp_framers ? _tcp : NULL, getWifiTcpPort());
+        if (getWifiWsPort() && !_ws_framers)
+            _ws_framers = new (std::nothrow) MavlinkFramer[TCP_MAX_CLIENTS];
+        _ws_clients.begin(_ws_framers ? _ws : NULL, getWifiWsPort());
     }
 
     // Serial Begin
     {
         //-- Start UART connected to UAS
-        Serial.begin(serial_baudRate);
-//-- Swap to TXD2/RXD2 (GPIO015/GPIO013) For ESP12 Only
-#ifdef ENABLE_DEBUG
-#ifdef ARDUINO_ESP8266_ESP12
-        Serial.swap();
-#endif
-#endif
-        // raise serial buffer size (default is 256)
-        Serial.setRxBufferSize(DEFAULT_RECEVE_BUFFER_SIZE);
+        _baudrate = serial_baudRate;
+        _serial->begin(serial_baudRate);
+        _serial->setFlowControl(getUartFlowControl() != 0);
+        _tx_policy = getUartTxPolicy();
+        if (getUartAutoBaud())
+            _autobaud.begin(serial_baudRate, millis());
+    }
+
+    // Outgoing Queue
+    {
+        _compress = getUdpCompress() != 0;
+        _fec.begin(getUdpFec());
+        _queue_size = UAS_QUEUE_SIZE;
+        if (_compress)
+            _queue_size -= LZF_HEADER_LEN;
+        if (_fec.enabled())
+            _queue_size -= FEC_OVERHEAD;
+        if (_link_header)
+            _queue_size -= LINK_HEADER_LEN;
+        _queue_threshold = getQueueThreshold();
+        if (_queue_threshold == 0 || _queue_threshold > _queue_size)
+            _queue_threshold = _queue_size;
+        _queue_timeout = getQueueTimeout();
+        packetPool.begin();
+        if (_queue)
+            packetPool.release(_queue);
+        _queue = NULL;
+        _queue_len = 0;
+        _queue_frames = 0;
+        _framer.reset();
+        _qos.reset();
+        _limiter.reset();
+        loadRateLimits();
+        _congested = false;
+        if (_retry)
+            packetPool.release(_retry);
+        _retry = NULL;
+    }
+
+    // Routing
+    {
+        _udp_framer.reset();
+        _router.reset();
     }
 }
 
 //---------------------------------------------------------------------------------
-//-- Read message from GCS
+//-- Read message(s) from GCS
 void ESP8266Bridge::udp_readMessageRaw()
 {
-    int udp_count = _udp.parsePacket();
-    UINT8 buf[DEFAULT_RECEVE_BUFFER_SIZE];
-    int buf_index = 0;
+    UINT32 budget = UDP_READ_BUDGET;
+    UINT32 udp_count;
+    UINT32 drained = 0;
 
-    if (udp_count > 0)
+    //-- Drain every queued datagram until the byte budget for this pass is spent
+    while (budget > 0 && (udp_count = _udp->parsePacket()) > 0)
     {
-        while (buf_index < udp_count)
+        INT8 slot = _clients.touch(_udp->remoteIP(), _udp->remotePort(), millis());
+        _stats.udp_to_serial.datagrams++;
+        _stats.udp_to_serial.bytes_in += udp_count;
+        drained += udp_count;
+        //-- Receive straight into the ring and route from there. Everything is
+        //   routed before the next read, so each datagram starts at the
+        //   beginning of the ring and frames are handed on in place.
+        if (_udp_ring.empty())
+            _udp_ring.reset();
+        UINT32 room;
+        UINT8 *span;
+        bool first = true;
+        bool keep = true;
+        while ((span = _udp_ring.writeSpan(room), room > 0))
         {
-            int result = _udp.read();
-            if (result >= 0)
+            UINT32 len = _udp->read(span, room);
+            if (len == 0)
+                break;
+            _udp_ring.commit(len);
+            if (first)
+                keep = _udpHeaders(slot, span, len);
+            first = false;
+            if (!keep)
+            {
+                _udp_ring.discard(_udp_ring.used());
+                continue;
+            }
+            const UINT8 *data;
+            while ((data = _udp_ring.readSpan(len), len > 0))
             {
-                buf[buf_index] = result;
-                buf_index++;
+                _udpParse(data, len, slot);
+                _udp_ring.consume(len);
             }
         }
-        serial_sendMessageRaw(buf, buf_index);
+        budget = (udp_count < budget) ? budget - udp_count : 0;
+    }
+    if (drained > _stats.udp_high_water)
+        _stats.udp_high_water = drained > 0xFFFF ? 0xFFFF : drained;
+    _serialDrain();
+
+    //-- One ACK per client and pass, right away: the proxy resends a hole
+    //   as soon as it sees one
+    for (UINT8 i = 0; _rel_acks; i++, _rel_acks >>= 1)
+    {
+        if (!(_rel_acks & 1))
+            continue;
+        UINT8 ack[REL_ACK_LEN];
+        _rel[i].ack(ack);
+        _udpSendDirect(ack, REL_ACK_LEN, 1 << i);
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- Take new stream clients (TCP or WebSocket) and read from all of them.
+//   The bytes take the same path as datagrams, only framed per client as a
+//   stream may split frames anywhere.
+template <class Table>
+void ESP8266Bridge::_streamRead(Table &table, MavlinkFramer *framers)
+{
+    UINT8 fresh = table.poll(millis());
+    for (UINT8 i = 0; fresh; i++, fresh >>= 1)
+    {
+        if (fresh & 1)
+            framers[i].reset();
+    }
+    //-- What slow clients did not take last time goes out first
+    table.flush(millis());
+
+    UINT32 budget = UDP_READ_BUDGET;
+    for (UINT8 i = 0; i < TCP_MAX_CLIENTS && budget > 0; i++)
+    {
+        if (!(table.mask() & (1 << i)))
+            continue;
+        while (budget > 0)
+        {
+            if (_udp_ring.empty())
+                _udp_ring.reset();
+            UINT32 room;
+            UINT8 *span = _udp_ring.writeSpan(room);
+            if (room > budget)
+                room = budget;
+            UINT32 len = table.read(i, span, room);
+            if (len == 0)
+                break;
+            _udp_ring.commit(len);
+            _stats.udp_to_serial.bytes_in += len;
+            _streamParse(framers[i], span, len);
+            _udp_ring.consume(len);
+            budget -= len;
+        }
+    }
+    _serialDrain();
+}
+
+//---------------------------------------------------------------------------------
+void ESP8266Bridge::tcp_readMessageRaw()
+{
+    if (_tcp_clients.enabled())
+        _streamRead(_tcp_clients, _tcp_framers);
+}
+
+//---------------------------------------------------------------------------------
+void ESP8266Bridge::ws_readMessageRaw()
+{
+    if (_ws_clients.enabled())
+        _streamRead(_ws_clients, _ws_framers);
+}
+
+//---------------------------------------------------------------------------------
+void ESP8266Bridge::_streamParse(MavlinkFramer &framer, const UINT8 *buffer, UINT32 len)
+{
+    while (len > 0)
+    {
+        UINT8 result;
+        UINT32 used = framer.parse(buffer, len, result);
+        buffer += used;
+        len -= used;
+        if (result == FRAMER_FRAME)
+            _udpRoute(framer, -1);
+        else if (result == FRAMER_RAW)
+            _serialQueue(framer.data(), framer.length(), false);
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- Take the headers a client behind the proxy puts in front of a datagram:
+//   the link header, then the reliable uplink sequence. Returns false for a
+//   datagram that was already handed on, or that cannot be: a sender that
+//   got no client slot (slot -1) cannot be acknowledged, and its resends
+//   could not be told from new data.
+bool ESP8266Bridge::_udpHeaders(INT8 slot, const UINT8 *data, UINT32 len)
+{
+    UINT32 used = 0;
+    if (_link_header && (slot >= 0 ? _links[slot].receive(data, len, micros()) : LinkPeer::hasHeader(data, len)))
+        used = LINK_HEADER_LEN;
+    bool keep = true;
+    if (_reliable && RelReceiver::isData(&data[used], len - used))
+    {
+        if (slot < 0)
+        {
+            _stats.udp_to_serial.drops[DROP_NO_CLIENT] += len;
+            return false;
+        }
+        keep = _rel[slot].receive(&data[used]);
+        used += REL_HEADER_LEN;
+        _rel_acks |= 1 << slot;
+    }
+    _udp_ring.consume(used);
+    return keep;
+}
+
+//---------------------------------------------------------------------------------
+//-- Drop clients that went quiet, and what was learned about them
+void ESP8266Bridge::housekeeping()
+{
+    UINT8 freed = _clients.expire(millis());
+    if (freed)
+        _router.forgetClients(freed);
+    for (UINT8 i = 0; freed; i++, freed >>= 1)
+    {
+        if (freed & 1)
+        {
+            _links[i].reset();
+            _rel[i].reset();
+        }
     }
 }
 
+//---------------------------------------------------------------------------------
+void ESP8266Bridge::loadRateLimits()
+{
+    for (UINT8 i = 0; i < RATE_LIMIT_SLOTS; i++)
+        _limiter.setRule(i, getRateLimit(i));
+}
+
 //---------------------------------------------------------------------------------
 //-- Forward message(s) to the GCS
-UINT32 ESP8266Bridge::udp_sendMessageRaw(UINT8 *buffer, UINT32 len)
+UINT32 ESP8266Bridge::udp_sendMessageRaw(const UINT8 *buffer, UINT32 len)
 {
     // if(getWifiMode() == WIFI_MODE_AP)
     // {
@@ -112,54 +345,576 @@ UINT32 ESP8266Bridge::udp_sendMessageRaw(UINT8 *buffer, UINT32 len)
     //      _udp.beginPacket(_ip, _udp_port);
     // }
 
-    _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+    return _udpSend(buffer, len, UDP_CLIENTS_ALL);
+}
+
+//---------------------------------------------------------------------------------
+//-- Send to the given client slots. The same buffer goes to every client,
+//   nothing is copied per recipient.
+UINT32 ESP8266Bridge::_udpSend(const UINT8 *buffer, UINT32 len, UINT8 clients)
+{
+    DirectionStats &stats = _stats.serial_to_udp;
+    clients &= _clients.mask();
+    if (!clients)
+    {
+        stats.drops[DROP_NO_CLIENT] += len;
+        return 0;
+    }
+    UINT32 sent = 0;
+    for (UINT8 i = 0; clients; i++, clients >>= 1)
+    {
+        if (!(clients & 1))
+            continue;
+        const UdpClient &client = _clients.at(i);
+        LinkPeer &link = _links[i];
+        if (_link_header && link.active())
+        {
+            //-- Sequenced per client, sent in front of the shared buffer
+            UINT8 header[LINK_HEADER_LEN];
+            link.header(header, micros());
+            if (_udp->sendTo(client.ip, client.port, header, LINK_HEADER_LEN, buffer, len) == LINK_HEADER_LEN + len)
+            {
+                link.sent();
+                stats.datagrams++;
+                stats.bytes_out += len;
+                sent++;
+            }
+            else
+                stats.drops[DROP_SEND_FAILED] += len;
+        }
+        else if (_udp->sendTo(client.ip, client.port, buffer, len) == len)
+        {
+            stats.datagrams++;
+            stats.bytes_out += len;
+            sent++;
+        }
+        else
+            stats.drops[DROP_SEND_FAILED] += len;
+    }
+    return sent ? len : 0;
+}
 
-    size_t sent = _udp.write(buffer, len);
-    _udp.endPacket();
-    _udp.flush();
-    return sent;
+//---------------------------------------------------------------------------------
+//-- Send as is, for what is not part of the downlink (ACKs, frames from one
+//   client to another): no link header, so the link sequence and the
+//   serial to UDP counters only cover the downlink
+void ESP8266Bridge::_udpSendDirect(const UINT8 *buffer, UINT32 len, UINT8 clients)
+{
+    clients &= _clients.mask();
+    for (UINT8 i = 0; clients; i++, clients >>= 1)
+    {
+        if (clients & 1)
+        {
+            const UdpClient &client = _clients.at(i);
+            _udp->sendTo(client.ip, client.port, buffer, len);
+        }
+    }
 }
 
+//---------------------------------------------------------------------------------
+//-- Split GCS data into MAVLink frames so they can be routed; anything that
+//   is not MAVLink goes to the UAS untouched
+void ESP8266Bridge::_udpParse(const UINT8 *buffer, UINT32 len, INT8 slot)
+{
+    while (len > 0)
+    {
+        UINT8 result;
+        UINT32 used = _udp_framer.parse(buffer, len, result);
+        buffer += used;
+        len -= used;
+        if (result == FRAMER_FRAME)
+            _udpRoute(_udp_framer, slot);
+        else if (result == FRAMER_RAW)
+            _serialQueue(_udp_framer.data(), _udp_framer.length(), false);
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- Learn the sender of a GCS frame, then send the frame on. Frames aimed at
+//   a system behind another client go to that client, and stay off the UART
+//   unless the target was also seen there (or was never seen at all). TCP
+//   clients have no UDP slot (-1) and are not learned.
+void ESP8266Bridge::_udpRoute(const MavlinkFramer &framer, INT8 slot)
+{
+    _stats.udp_to_serial.frames++;
+    if (slot >= 0)
+        _router.learnClient(framer.sysId(), slot);
+
+    bool serial = true;
+    UINT8 target = MavlinkRouter::targetSystem(framer);
+    if (target)
+    {
+        UINT8 clients = _router.clientsFor(target) & _clients.mask();
+        if (slot >= 0)
+            clients &= ~(1 << slot);
+        if (clients)
+        {
+            _udpSendDirect(framer.data(), framer.length(), clients);
+            _route_stats.up_to_clients++;
+        }
+        serial = _router.onSerial(target) || !_router.clientsFor(target);
+    }
+    if (serial)
+        _serialQueue(framer.data(), framer.length(), true);
+    else
+        _route_stats.up_not_serial++;
+}
+
+//---------------------------------------------------------------------------------
+//-- Read from UAS into the outgoing queue, sending a datagram once it is
+//   full enough or the oldest queued byte is too old
 void ESP8266Bridge::serial_readMessageRaw()
 {
-    UINT8 buf[1024];
-    UINT16 buf_index = 0;
+    _serialDrain();
+    _serialIngest();
+    if (_autobaud.active())
+    {
+        _autoBaud();
+        return;
+    }
+    UINT32 pending = _rx_ring.used();
+    if (pending > _stats.ring_high_water)
+        _stats.ring_high_water = pending;
 
-    // while(Serial.available() && _receivePermission)
-    // {
-    //     buf_index = Serial.readBytesUntil(0,buf,DEFAULT_RECEVE_BUFFER_SIZE);
-    //     buf[buf_index] = 0;
-    //     if(buf_index > 0)
-    //     {
-    //          _forwardTo->sendMessageRaw((UINT8*)buf, buf_index);
-    //     }
-    // }
+    //-- Frame what was ingested, one contiguous span of the ring at a time
+    UINT32 budget = SERIAL_PARSE_BUDGET;
+    while (budget > 0)
+    {
+        UINT32 len;
+        const UINT8 *span = _rx_ring.readSpan(len);
+        if (len == 0)
+            break;
+        if (len > budget)
+            len = budget;
+        //-- Queue timeouts count from when these bytes reached the UART, not
+        //   from when loop() got to them, so a span never crosses two reads
+        SerialRxMark *mark = NULL;
+        if (_rx_mark_head != _rx_mark_tail)
+        {
+            mark = &_rx_marks[_rx_mark_tail & (SERIAL_RX_MARKS - 1)];
+            if (len > mark->len)
+                len = mark->len;
+            _rx_time = mark->time;
+        }
+        _serialParse(span, len);
+        _rx_ring.consume(len);
+        budget -= len;
+        if (mark && (mark->len -= len) == 0)
+            _rx_mark_tail++;
+    }
+    _qosDispatch();
 
-    if (Serial.available())
+    if (_queue_len > 0 && (millis() - _queue_time) >= _queue_timeout && !_linkCongested())
+        _queueFlush(QUEUE_FLUSH_TIMEOUT);
+    if (_fec.pending() && (millis() - _fec_time) >= FEC_GROUP_TIMEOUT)
+        _fecParity();
+}
+
+//---------------------------------------------------------------------------------
+//-- Move everything the UART has buffered into the ring, in bulk and
+//   byte-for-byte (binary safe)
+void ESP8266Bridge::_serialIngest()
+{
+    if (_serial->hasOverrun())
+        _stats.rx_overruns++;
+    if (_serial->hasRxError())
+        _stats.rx_errors++;
+    UINT32 avail = _serial->available();
+    if (avail == 0)
+        return;
+    UINT32 time = _serial->rxTime();
+    UINT32 added = 0;
+    while (avail > 0)
+    {
+        UINT32 len;
+        UINT8 *span = _rx_ring.writeSpan(len);
+        if (len == 0)
+            break;
+        if (len > avail)
+            len = avail;
+        len = _serial->read(span, len);
+        if (len == 0)
+            break;
+        _rx_ring.commit(len);
+        avail -= len;
+        added += len;
+        _stats.serial_to_udp.bytes_in += len;
+    }
+    if (added == 0)
+        return;
+    //-- With every mark taken the bytes join the newest read, whose time is
+    //   the older of the two
+    if ((UINT8)(_rx_mark_head - _rx_mark_tail) == SERIAL_RX_MARKS)
+    {
+        _rx_marks[(_rx_mark_head - 1) & (SERIAL_RX_MARKS - 1)].len += added;
+        return;
+    }
+    SerialRxMark &mark = _rx_marks[_rx_mark_head & (SERIAL_RX_MARKS - 1)];
+    mark.len = added;
+    mark.time = time;
+    _rx_mark_head++;
+}
+
+//---------------------------------------------------------------------------------
+//-- Looking for the autopilot's rate: what arrives only tells whether the
+//   current rate is right, and is not forwarded
+void ESP8266Bridge::_autoBaud()
+{
+    UINT32 len;
+    const UINT8 *span;
+    while ((span = _rx_ring.readSpan(len), len > 0))
+    {
+        _autobaud.feed(span, len);
+        _rx_ring.consume(len);
+    }
+    _rx_mark_tail = _rx_mark_head;
+    if (_autobaud.poll(millis(), _serial->detectBaudRate()))
+    {
+        _serial->begin(_autobaud.rate());
+        _serial->setFlowControl(getUartFlowControl() != 0);
+    }
+    else if (!_autobaud.active())
+    {
+        _baudrate = _autobaud.rate();
+        _framer.reset();
+        DEBUG_LOG("UART rate found: %u after %u trial(s)\n", _baudrate, _autobaud.trials());
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- Split serial data into whole MAVLink frames (and runs of anything else)
+void ESP8266Bridge::_serialParse(const UINT8 *buffer, UINT32 len)
+{
+    while (len > 0)
     {
-        while (Serial.available())
+        UINT8 result;
+        UINT32 used = _framer.parse(buffer, len, result);
+        buffer += used;
+        len -= used;
+        if (result == FRAMER_FRAME)
         {
-            int dat = Serial.read();
-            if (dat > 0)
+            _stats.serial_to_udp.frames++;
+            _router.learnSerial(_framer.sysId());
+            if (!_limiter.allow(_framer.msgId(), millis()))
             {
-                buf[buf_index] = dat;
-                buf_index++;
+                _stats.serial_to_udp.drops[DROP_RATE_LIMIT] += _framer.length();
+                continue;
             }
+            //-- Targeted frames only go to the clients their target was seen behind
+            UINT8 target = MavlinkRouter::targetSystem(_framer);
+            UINT8 clients = target ? (_router.clientsFor(target) & _clients.mask()) : 0;
+            if (clients)
+                _route_stats.down_targeted++;
+            else
+                clients = UDP_CLIENTS_ALL;
+            _qosAppend(_framer.data(), _framer.length(), true, clients, _qos.classify(_framer.msgId()));
+        }
+        else if (result == FRAMER_RAW)
+        {
+            _qosAppend(_framer.data(), _framer.length(), false, UDP_CLIENTS_ALL, QOS_NORMAL);
         }
+    }
+}
 
-        buf[buf_index] = 0;
-        if (buf_index > 0)
+//---------------------------------------------------------------------------------
+//-- Straight into the outgoing queue while the link keeps up. Otherwise wait
+//   in the priority queues, so what matters most goes first once it recovers.
+void ESP8266Bridge::_qosAppend(const UINT8 *buffer, UINT32 len, bool frame, UINT8 clients, UINT8 cls)
+{
+    if (_qos.empty() && !_retry && !_linkCongested())
+    {
+        _queueAppend(buffer, len, frame, clients);
+        return;
+    }
+    //-- Frames fit one record; runs of other bytes are split
+    while (len > 0)
+    {
+        UINT32 n = (len < QOS_RECORD_MAX) ? len : QOS_RECORD_MAX;
+        _stats.serial_to_udp.drops[DROP_QOS] += _qos.push(cls, buffer, n, clients, frame);
+        buffer += n;
+        len -= n;
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- Move waiting data into the outgoing queue, highest class first, until
+//   the link pushes back again
+void ESP8266Bridge::_qosDispatch()
+{
+    if (_retry && !_linkCongested())
+        _retrySend();
+    while (!_qos.empty() && !_linkCongested())
+    {
+        UINT8 clients;
+        bool frame;
+        UINT16 len = _qos.pop(_qos_record, clients, frame);
+        _queueAppend(_qos_record, len, frame, clients);
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- Another attempt at the datagram that could not be sent
+void ESP8266Bridge::_retrySend()
+{
+    if (_udpSend(_retry->data, _retry->len, _retry_clients) || ++_retry_count >= QOS_RETRIES)
+    {
+        packetPool.release(_retry);
+        _retry = NULL;
+    }
+    else
+    {
+        _congested = true;
+        _congested_time = millis();
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- A failed send (or an empty packet pool) means the link is congested;
+//   the next attempt is made QOS_BACKOFF ms later
+bool ESP8266Bridge::_linkCongested()
+{
+    if (_congested && (millis() - _congested_time) >= QOS_BACKOFF)
+        _congested = false;
+    return _congested;
+}
+
+//---------------------------------------------------------------------------------
+//-- Add to the outgoing queue. Frames are never split across datagrams, while
+//   bytes that are not part of a frame fill whatever room is left. A datagram
+//   only holds data for one set of clients.
+void ESP8266Bridge::_queueAppend(const UINT8 *buffer, UINT32 len, bool frame, UINT8 clients)
+{
+    if (clients != _queue_clients)
+    {
+        _queueFlush(QUEUE_FLUSH_ROUTE);
+        _queue_clients = clients;
+    }
+
+    if (frame)
+    {
+        if (_queue_len + len > _queue_size)
+            _queueFlush(QUEUE_FLUSH_FULL);
+        _queue_frames++;
+    }
+
+    while (len > 0)
+    {
+        if (_queue_len == 0)
+        {
+            if (!_queue && !(_queue = packetPool.alloc()))
+            {
+                _stats.serial_to_udp.drops[DROP_NO_BUFFER] += len;
+                _congested = true;
+                _congested_time = millis();
+                return;
+            }
+            _queue_time = _rx_time;
+        }
+        UINT32 room = _queue_size - _queue_len;
+        UINT32 n = (len < room) ? len : room;
+        memcpy(&_queue->data[_queue_len], buffer, n);
+        _queue_len += n;
+        buffer += n;
+        len -= n;
+        if (_queue_len == _queue_size)
+            _queueFlush(QUEUE_FLUSH_FULL);
+        else if (_queue_len >= _queue_threshold)
+            _queueFlush(QUEUE_FLUSH_THRESHOLD);
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- Send the queued bytes as one datagram, and hand the buffer back
+void ESP8266Bridge::_queueFlush(UINT8 reason)
+{
+    if (_queue_len == 0)
+        return;
+
+    _queue->len = _queue_len;
+    //-- TCP and WebSocket clients get every datagram as it came from the UART:
+    //   a stream needs neither compression envelopes nor parity
+    UINT8 streams = 0;
+    if (_tcp_clients.enabled())
+        streams += _tcp_clients.send(_queue->data, _queue_len, millis());
+    if (_ws_clients.enabled())
+        streams += _ws_clients.send(_queue->data, _queue_len, millis());
+    _stats.serial_to_udp.datagrams += streams;
+    _stats.serial_to_udp.bytes_out += _queue_len * streams;
+    if (_compress)
+        _queueCompress();
+    if (_fec.enabled())
+    {
+        //-- A group only covers datagrams for one set of clients
+        if (_fec.pending() && _queue_clients != _fec_clients)
+            _fecParity();
+        if (!_fec.pending())
         {
-            udp_sendMessageRaw(buf, buf_index);
+            _fec_clients = _queue_clients;
+            _fec_time = millis();
         }
+        _queue->len = _fec.add(_queue->data, _queue->len);
+    }
+    if (!(_queue_clients & _clients.mask()))
+    {
+        //-- No UDP client: only lost if no stream client took it either
+        if (!streams)
+            _stats.serial_to_udp.drops[DROP_NO_CLIENT] += _queue->len;
+    }
+    else if (!_udpSend(_queue->data, _queue->len, _queue_clients))
+    {
+        //-- Nobody took it: the link is congested. Keep the datagram (unless
+        //   one is already waiting) and try again after QOS_BACKOFF.
+        _stats.congestions++;
+        _congested = true;
+        _congested_time = millis();
+        if (!_retry)
+        {
+            packetPool.retain(_queue);
+            _retry = _queue;
+            _retry_clients = _queue_clients;
+            _retry_count = 0;
+        }
+    }
+    packetPool.release(_queue);
+    _queue = NULL;
+    if (_fec.enabled() && _fec.full())
+        _fecParity();
+
+    _queue_stats.datagrams++;
+    _queue_stats.bytes += _queue_len;
+    _queue_stats.frames += _queue_frames;
+    _queue_stats.flushes[reason]++;
+    _queue_stats.fill[((UINT32)(_queue_len - 1) * UAS_QUEUE_FILL_BUCKETS) / UAS_QUEUE_SIZE]++;
+    _queue_len = 0;
+    _queue_frames = 0;
+}
+
+//---------------------------------------------------------------------------------
+//-- Put the queued datagram in an LZF envelope, compressed into a second
+//   pool buffer if that makes it smaller, stored in place otherwise
+void ESP8266Bridge::_queueCompress()
+{
+    UINT32 start = micros();
+    PacketBuffer *out = packetPool.alloc();
+    UINT32 len = out ? Lzf_compress(_queue->data, _queue_len, &out->data[LZF_HEADER_LEN], _queue_len - 1) : 0;
+    if (len)
+    {
+        out->data[1] = LZF_COMPRESSED;
+        packetPool.release(_queue);
+        _queue = out;
     }
+    else
+    {
+        memmove(&_queue->data[LZF_HEADER_LEN], _queue->data, _queue_len);
+        _queue->data[1] = LZF_STORED;
+        len = _queue_len;
+        if (out)
+            packetPool.release(out);
+        _compress_stats.stored++;
+    }
+    _queue->data[0] = LZF_MAGIC;
+    _queue->data[2] = _queue_len & 0xFF;
+    _queue->data[3] = _queue_len >> 8;
+    _queue->len = len + LZF_HEADER_LEN;
+
+    UINT32 elapsed = micros() - start;
+    _compress_stats.datagrams++;
+    _compress_stats.bytes_in += _queue_len;
+    _compress_stats.bytes_out += _queue->len;
+    _compress_stats.time_us += elapsed;
+    if (elapsed > _compress_stats.max_us)
+        _compress_stats.max_us = elapsed;
+}
+
+//---------------------------------------------------------------------------------
+//-- Close the FEC group and send its parity, unless the link is already
+//   congested: the datagrams it would rebuild are then waiting for a retry
+//   anyway, and more airtime would only make it worse
+void ESP8266Bridge::_fecParity()
+{
+    const UINT8 *parity;
+    UINT32 len = _fec.parity(parity);
+    if (!len)
+        return;
+    if (_linkCongested())
+        _fec.skipped();
+    else
+        _udpSend(parity, len, _fec_clients);
 }
 
 //---------------------------------------------------------------------------------
 //-- Send message to UAS
-UINT32 ESP8266Bridge::serial_sendMessageRaw(UINT8 *buffer, UINT32 len)
+UINT32 ESP8266Bridge::serial_sendMessageRaw(const UINT8 *buffer, UINT32 len)
 {
-    Serial.write(buffer, len);
-    //Serial.flush();
+    return _serialQueue(buffer, len, false);
+}
+
+//---------------------------------------------------------------------------------
+//-- Queue for the UAS and return how many bytes were taken. When the queue is
+//   full, UART_TX_POLICY decides what goes: the new bytes, the oldest queued
+//   ones, or (for MAVLink frames) the whole new frame so the autopilot never
+//   sees a truncated one.
+UINT32 ESP8266Bridge::_serialQueue(const UINT8 *buffer, UINT32 len, bool frame)
+{
+    DirectionStats &stats = _stats.udp_to_serial;
+    _serialDrain();
+    UINT32 space = _tx_ring.space();
+    if (len > space)
+    {
+        if (_tx_policy == UART_TX_DROP_OLDEST)
+        {
+            if (len > _tx_ring.capacity())
+            {
+                stats.drops[DROP_SERIAL_FULL] += len - _tx_ring.capacity();
+                buffer += len - _tx_ring.capacity();
+                len = _tx_ring.capacity();
+            }
+            //-- Both ends of the queue belong to loop(), so the producer
+            //   may discard from the consumer side
+            _tx_ring.discard(len - space);
+            stats.drops[DROP_SERIAL_FULL] += len - space;
+        }
+        else if (_tx_policy == UART_TX_DROP_FRAME && frame)
+        {
+            stats.drops[DROP_SERIAL_FULL] += len;
+            return 0;
+        }
+        else
+        {
+            stats.drops[DROP_SERIAL_FULL] += len - space;
+            len = space;
+        }
+    }
+    _tx_ring.write(buffer, len);
+    UINT32 pending = _tx_ring.used();
+    if (pending > _stats.tx_high_water)
+        _stats.tx_high_water = pending;
+    _serialDrain();
     return len;
 }
+
+//---------------------------------------------------------------------------------
+//-- Hand the UART as much of the TX queue as its FIFO takes without blocking
+//   (with RTS/CTS the FIFO stops draining while the autopilot is busy)
+void ESP8266Bridge::_serialDrain()
+{
+    //-- Nothing goes out at what may be the wrong rate
+    if (_autobaud.active())
+        return;
+    UINT32 room = _serial->availableForWrite();
+    while (room > 0)
+    {
+        UINT32 len;
+        const UINT8 *span = _tx_ring.readSpan(len);
+        if (len == 0)
+            break;
+        if (len > room)
+            len = room;
+        UINT32 written = _serial->write(span, len);
+        _tx_ring.consume(written);
+        _stats.udp_to_serial.bytes_out += written;
+        if (written < len)
+            break;
+        room -= written;
+    }
+}
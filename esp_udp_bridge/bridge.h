@@ -39,35 +39,243 @@
 #define BRIDGE_H
 
 #include "common.h"
-#include <ESP8266WiFi.h>
-#include <WiFiClient.h>
-#include <WiFiUdp.h>
+#include "autobaud.h"
+#include "fec.h"
+#include "link_header.h"
+#include "lzf.h"
+#include "mavlink_framer.h"
+#include "mavlink_router.h"
+#include "packet_pool.h"
+#include "qos.h"
+#include "rate_limiter.h"
+#include "reliable.h"
+#include "spsc_ring.h"
+#include "tcp_clients.h"
+#include "ws_clients.h"
+#include "transport.h"
+#include "udp_clients.h"
 
-//-- UDP Outgoing Packet Queue
-#define UAS_QUEUE_SIZE          60
-#define UAS_QUEUE_THRESHOLD     20
-#define UAS_QUEUE_TIMEOUT       5 // 5ms
+//-- UDP Incoming Datagrams
+#define UDP_MAX_DATAGRAM_SIZE   PACKET_BUFFER_SIZE
+#define UDP_READ_BUDGET         4096 // Max bytes forwarded to the UART per loop() pass
+#define UDP_RING_SIZE           2048 // Power of two that holds a whole datagram
+
+//-- Serial Incoming Data
+#define SERIAL_RING_SIZE        2048 // Must be a power of two
+#define SERIAL_PARSE_BUDGET     1024 // Max bytes framed per loop() pass
+#define SERIAL_RX_MARKS         8    // Reads whose arrival time is kept while in the ring (power of two)
+
+//-- Bytes one read moved into the ring, and when they reached the UART
+struct SerialRxMark
+{
+    UINT16 len;
+    UINT32 time;
+};
+
+//-- UDP Outgoing Packet Queue (threshold and timeout are parameters)
+#define UAS_QUEUE_SIZE          UDP_MAX_DATAGRAM_SIZE
+#define UAS_QUEUE_FILL_BUCKETS  8
+
+enum
+{
+    QUEUE_FLUSH_THRESHOLD = 0,
+    QUEUE_FLUSH_TIMEOUT,
+    QUEUE_FLUSH_FULL,       // Next frame would not fit in the datagram
+    QUEUE_FLUSH_ROUTE,      // Next frame goes to a different set of clients
+    QUEUE_FLUSH_COUNT
+};
+
+//-- Coalescing statistics, so threshold and timeout can be tuned per vehicle
+struct QueueStats
+{
+    UINT32 datagrams;
+    UINT32 bytes;
+    UINT32 frames;
+    UINT32 flushes[QUEUE_FLUSH_COUNT];
+    UINT32 fill[UAS_QUEUE_FILL_BUCKETS]; // Datagrams per fill level (1/8th of UAS_QUEUE_SIZE each)
+};
+
+//-- Downlink compression (UDP_COMPRESS), to tell whether it pays off
+struct CompressStats
+{
+    UINT32 datagrams;
+    UINT32 stored;          // Sent uncompressed, as they would not shrink
+    UINT32 bytes_in;        // Before compression
+    UINT32 bytes_out;       // After, including the envelope
+    UINT32 time_us;         // Spent compressing
+    UINT32 max_us;          // Slowest datagram
+};
+
+//-- Runtime statistics, per direction. Counters are only written from loop(),
+//   so readers see plain (possibly slightly stale) values without locking.
+enum
+{
+    DROP_NO_CLIENT = 0,     // Datagram had nobody to go to (downlink: no UDP, TCP or WebSocket client; uplink: its sender got no client slot)
+    DROP_SEND_FAILED,       // UDP send failed (per client)
+    DROP_SERIAL_FULL,       // UART TX queue was full (see UART_TX_POLICY)
+    DROP_NO_BUFFER,         // Packet pool was empty
+    DROP_QOS,               // Dropped by priority while the WiFi link was congested
+    DROP_RATE_LIMIT,        // Frames over their RATE_LIMIT (UAS to GCS only)
+    DROP_COUNT
+};
+
+struct DirectionStats
+{
+    UINT32 bytes_in;
+    UINT32 bytes_out;       // Per recipient
+    UINT32 datagrams;       // Sent (serial to UDP) or received (UDP to serial)
+    UINT32 frames;
+    UINT32 drops[DROP_COUNT]; // Bytes
+};
+
+struct BridgeStats
+{
+    DirectionStats serial_to_udp;   // Includes frames forwarded between clients
+    DirectionStats udp_to_serial;
+    UINT32 rx_overruns;             // Times the UART lost bytes before the bridge read them
+    UINT32 rx_errors;               // Times the UART saw framing or parity errors (wrong rate, noise)
+    UINT16 ring_high_water;         // Most bytes waiting in the serial ring
+    UINT16 udp_high_water;          // Most UDP bytes drained in one pass
+    UINT16 tx_high_water;           // Most bytes waiting in the UART TX queue
+    UINT32 congestions;             // Datagrams that could not be sent to any client
+};
+
+//-- Routing statistics (frames that did not go everywhere)
+struct RouteStats
+{
+    UINT32 down_targeted;   // UAS frames sent only to the clients behind their target
+    UINT32 up_to_clients;   // GCS frames forwarded to another client
+    UINT32 up_not_serial;   // GCS frames kept off the UART (target is behind a client)
+};
 
 
 class ESP8266Bridge
 {
 public:
-    ESP8266Bridge();
+    //-- tcp is only used when WIFI_TCP_PORT is set, ws when WIFI_WS_PORT is
+    ESP8266Bridge(BridgeSerial *serial, BridgeUdp *udp, BridgeTcp *tcp = NULL, BridgeTcp *ws = NULL);
 
-    void        begin(IPAddress gcsIP, UINT16 udpHPort, UINT16 udpCPort, UINT32 serial_baudRate);
+    void        begin(UINT32 gcsIP, UINT16 udpHPort, UINT16 udpCPort, UINT32 serial_baudRate);
     void        udp_readMessageRaw();
-    UINT32      udp_sendMessageRaw(UINT8 *buffer, UINT32 len);
+    void        tcp_readMessageRaw();
+    void        ws_readMessageRaw();
+    UINT32      udp_sendMessageRaw(const UINT8 *buffer, UINT32 len);
     void        serial_readMessageRaw  ();
-    UINT32      serial_sendMessageRaw  (UINT8 *buffer, UINT32 len);
+    UINT32      serial_sendMessageRaw  (const UINT8 *buffer, UINT32 len);
+    //-- Periodic work off the I/O path (client expiry)
+    void        housekeeping();
+    //-- (Re)reads the RATE_LIMIT parameters; may be called at any time
+    void        loadRateLimits();
+
+    const QueueStats &getQueueStats() const { return _queue_stats; }
+    const CompressStats &getCompressStats() const { return _compress_stats; }
+    bool        getCompress() const { return _compress; }
+    const FecEncoder &getFec() const { return _fec; }
+    bool        getLinkHeader() const { return _link_header; }
+    const LinkPeer &getLink(UINT8 slot) const { return _links[slot]; }
+    bool        getReliable() const { return _reliable; }
+    const RelReceiver &getRel(UINT8 slot) const { return _rel[slot]; }
+    const UdpClientTable &getClients() const { return _clients; }
+    const TcpClientTable &getTcpClients() const { return _tcp_clients; }
+    const WsClientTable &getWsClients() const { return _ws_clients; }
+    const RouteStats &getRouteStats() const { return _route_stats; }
+    const BridgeStats &getStats() const { return _stats; }
+    UINT32      getTxPending() const { return _tx_ring.used(); }
+    UINT32      getBaudRate() const { return _autobaud.active() ? _autobaud.rate() : _baudrate; }
+    const AutoBaud &getAutoBaud() const { return _autobaud; }
+    const QosQueue &getQos() const { return _qos; }
+    const RateLimiter &getRateLimiter() const { return _limiter; }
 
 private:
-    UINT16      _baudrate;
+    void        _serialIngest();
+    void        _serialParse(const UINT8 *buffer, UINT32 len);
+    void        _qosAppend(const UINT8 *buffer, UINT32 len, bool frame, UINT8 clients, UINT8 cls);
+    void        _qosDispatch();
+    bool        _linkCongested();
+    void        _retrySend();
+    void        _queueAppend(const UINT8 *buffer, UINT32 len, bool frame, UINT8 clients);
+    void        _queueFlush(UINT8 reason);
+    void        _queueCompress();
+    void        _fecParity();
+    bool        _udpHeaders(INT8 slot, const UINT8 *data, UINT32 len);
+    void        _udpParse(const UINT8 *buffer, UINT32 len, INT8 slot);
+    void        _udpRoute(const MavlinkFramer &framer, INT8 slot);
+    template <class Table>
+    void        _streamRead(Table &table, MavlinkFramer *framers);
+    void        _streamParse(MavlinkFramer &framer, const UINT8 *buffer, UINT32 len);
+    UINT32      _serialQueue(const UINT8 *buffer, UINT32 len, bool frame);
+    void        _serialDrain();
+    void        _autoBaud();
+    UINT32      _udpSend(const UINT8 *buffer, UINT32 len, UINT8 clients);
+    void        _udpSendDirect(const UINT8 *buffer, UINT32 len, UINT8 clients);
+
+private:
+    UINT32      _baudrate;
+    AutoBaud    _autobaud;
     bool        _receivePermission;
 
 private:
-    WiFiUDP     _udp;
-    IPAddress   _ip;
+    SpscRing<SERIAL_RING_SIZE> _rx_ring;
+    SerialRxMark _rx_marks[SERIAL_RX_MARKS];
+    UINT8       _rx_mark_head;
+    UINT8       _rx_mark_tail;
+    UINT32      _rx_time;   // millis() when the bytes being framed arrived
+    SpscRing<UDP_RING_SIZE> _udp_ring;
+    SpscRing<UART_TX_QUEUE_SIZE> _tx_ring;
+    UINT8       _tx_policy;
+
+private:
+    PacketBuffer *_queue;   // From packetPool while bytes are queued
+    UINT16      _queue_len;
+    UINT16      _queue_size;    // Room for the LZF envelope, FEC and link headers is kept
+    UINT16      _queue_frames;
+    UINT16      _queue_threshold;
+    UINT16      _queue_timeout;
+    UINT32      _queue_time;
+    UINT8       _queue_clients; // Client slots the queued frames go to
+    QueueStats  _queue_stats;
+    bool        _compress;
+    CompressStats _compress_stats;
+    FecEncoder  _fec;
+    UINT8       _fec_clients;   // Client slots of the open FEC group
+    UINT32      _fec_time;      // millis() when the open group started
+    MavlinkFramer _framer;
+
+private:
+    RateLimiter _limiter;
+    QosQueue    _qos;
+    UINT8       _qos_record[QOS_RECORD_MAX];
+    bool        _congested;
+    UINT32      _congested_time; // millis() of the last failed send
+    PacketBuffer *_retry;   // Datagram no client took, sent again first
+    UINT8       _retry_clients;
+    UINT8       _retry_count;
+
+private:
+    MavlinkFramer _udp_framer;
+    MavlinkRouter _router;
+    RouteStats  _route_stats;
+    BridgeStats _stats;
+
+private:
+    BridgeSerial *_serial;
+    BridgeUdp   *_udp;
+    UINT32      _ip;
     UINT16      _udp_port;
+    UdpClientTable _clients;
+    bool        _link_header;
+    LinkPeer    _links[MAX_UDP_CLIENTS]; // Per client slot
+    bool        _reliable;
+    RelReceiver _rel[MAX_UDP_CLIENTS];
+    UINT8       _rel_acks;      // Client slots owed an ACK
+
+private:
+    BridgeTcp   *_tcp;
+    TcpClientTable _tcp_clients;
+    MavlinkFramer *_tcp_framers; // Frames span reads on a stream; allocated with the port
+    BridgeTcp   *_ws;
+    WsClientTable _ws_clients;
+    MavlinkFramer *_ws_framers; // ... and WebSocket messages
 };
 
 #endif
@@ -36,16 +36,23 @@
  */
 
 #include "common.h"
+#include "packet_pool.h"
 
+//-- Formats into a pool buffer rather than the (4 KB) system stack; the
+//   message is dropped if none is free
 int log(const char *format, ...)
 {
+    PacketBuffer *buffer = packetPool.alloc();
+    if (!buffer)
+        return 0;
+    char *temp = (char *)buffer->data;
     va_list arg;
     va_start(arg, format);
-    char temp[1024];
-    unsigned long long len = ets_vsnprintf(temp, 1024, format, arg);
+    unsigned long long len = ets_vsnprintf(temp, sizeof(buffer->data), format, arg);
 #ifdef ENABLE_DEBUG
     Serial1.print(temp);
 #endif
     va_end(arg);
+    packetPool.release(buffer);
     return len;
 }
\ No newline at end of file
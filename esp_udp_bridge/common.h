@@ -49,21 +49,75 @@
 #define UINT8                       uint8_t
 #define UINT16                      uint16_t
 #define UINT32                      uint32_t
+#define UINT64                      uint64_t
 #define INT8                        int8_t
 #define INT16                       int16_t
 #define INT32                       int32_t
+#define INT64                       int64_t
 
 
 #define DEFAULT_WIFI_MODE           WIFI_MODE_AP
 #define DEFAULT_UART_SPEED          115200
+#define MAX_UART_SPEED              3000000
 #define DEFAULT_WIFI_CHANNEL        11
 #define DEFAULT_UDP_HPORT           13580
 #define DEFAULT_UDP_CPORT           13585
 
 #define DEFAULT_RECEVE_BUFFER_SIZE  1024
 
+#define PACKET_BUFFER_SIZE          1472    // One UDP datagram (1500 MTU - IPv4 - UDP headers)
+#define PACKET_POOL_SIZE            4       // Buffers shared by both directions and log()
+
+#define DEFAULT_QUEUE_THRESHOLD     512     // Bytes queued before a datagram is sent
+#define DEFAULT_QUEUE_TIMEOUT       5       // Max age (ms) of queued bytes before a datagram is sent
+#define MAX_QUEUE_TIMEOUT           1000
+
+#define DEFAULT_MAX_CLIENTS         4       // GCS endpoints the downlink is sent to
+#define MAX_UDP_CLIENTS             8       // Client table capacity
+#define DEFAULT_CLIENT_TIMEOUT      10      // Seconds without a datagram before a client is dropped
+#define MAX_CLIENT_TIMEOUT          3600
+
+//-- TCP listener (WIFI_TCP_PORT) for GCS tools that only speak TCP
+#define DEFAULT_TCP_PORT            0       // Off; MAVLink tools usually use 5760
+#define TCP_MAX_CLIENTS             4
+#define TCP_TX_QUEUE_SIZE           2048    // Per client, must be a power of two
+#define TCP_STALL_TIMEOUT           3000    // ms a client may take nothing while bytes wait
+
+//-- WebSocket listener (WIFI_WS_PORT) for browser based ground tools, on
+//   TCP_MAX_CLIENTS connections of its own
+#define DEFAULT_WS_PORT             0       // Off; usually 81, next to the web pages on 80
+#define WS_PATH                     "/mavlink"
+#define WS_HANDSHAKE_TIMEOUT        5000    // ms to send the upgrade request
+
+//-- UART TX queue (GCS to UAS), drained as the TX FIFO has room
+#define UART_TX_QUEUE_SIZE          2048    // Must be a power of two
+#define UART_TX_DROP_NEWEST         0       // Bytes that do not fit are dropped
+#define UART_TX_DROP_OLDEST         1       // The oldest queued bytes make room
+#define UART_TX_DROP_FRAME          2       // A MAVLink frame that does not fit is dropped whole
+#define DEFAULT_UART_TX_POLICY      UART_TX_DROP_FRAME
+#define UART_RTS_THRESHOLD          96      // RX FIFO level (of 128) that deasserts RTS
+
+//-- Downlink rate limits (RATE_LIMIT1.. parameters): message ID in the low
+//   24 bits, frames per second in the top 8, 0 for an unused slot
+#define RATE_LIMIT_SLOTS            8
+#define RATE_LIMIT_RULE(msgid, hz)  ((((UINT32)(hz)) << 24) | ((msgid) & 0xFFFFFF))
+#define RATE_LIMIT_MSGID(rule)      ((rule) & 0xFFFFFF)
+#define RATE_LIMIT_HZ(rule)         ((rule) >> 24)
+
+//-- Downlink FEC (UDP_FEC parameter): datagrams per parity datagram
+#define FEC_GROUP_MAX               16
+
 #define TIMEOUT                     10 * 1000
 
+//-- Scheduler periods and budgets (us). Bridge I/O is serviced at least
+//   every SCHED_IO_PERIOD as long as no task overruns its budget.
+#define SCHED_IO_PERIOD             2000
+#define SCHED_IO_BUDGET             500
+#define SCHED_HTTPD_PERIOD          20000
+#define SCHED_HTTPD_BUDGET          1000
+#define SCHED_HOUSEKEEPING_PERIOD   100000
+#define SCHED_HOUSEKEEPING_BUDGET   100
+
 //-- The version is set from the build system (major, minor and build)
 #define ESP_UDP_BRIDGE_VERSION_MAJOR     1
 #define ESP_UDP_BRIDGE_VERSION_MINOR     0
@@ -115,6 +169,13 @@ typedef enum PARAM_EXT_TYPE
 //-- Debug sent out to Serial1 (GPIO02), which is TX only (no RX).
 //#define ENABLE_DEBUG
 
+//-- UART RX through our own FIFO-full/RX-timeout interrupt into a lock-free
+//   ring (UART0 only). Comment out to use the HardwareSerial RX buffer.
+#define ENABLE_UART_ISR
+
+//-- Per-stage loop() timing histograms, served at /profile.json
+//#define ENABLE_PROFILER
+
 
 int log(const char *format, ...);
 
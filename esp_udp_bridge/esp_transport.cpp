@@ -0,0 +1,431 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file esp_transport.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "esp_transport.h"
+
+#include <esp8266_peri.h>
+
+#ifdef ENABLE_UART_ISR
+
+//-- UART0 RX ring, filled from the interrupt (single producer) and drained
+//   by loop() (single consumer). Each side only writes its own index.
+#define UART_RX_RING_SIZE       DEFAULT_RECEVE_BUFFER_SIZE  // Must be a power of two
+#define UART_RX_RING_MASK       (UART_RX_RING_SIZE - 1)
+#define UART_BURST_RING_SIZE    16                          // Must be a power of two
+#define UART_BURST_RING_MASK    (UART_BURST_RING_SIZE - 1)
+#define UART_RX_FIFO_THRESHOLD  64      // Interrupt when the 128 byte FIFO is half full
+#define UART_RX_TIMEOUT         2       // ... or after 2 idle byte times
+
+//-- Where each burst of bytes starts in the ring, and when it arrived
+struct UartBurst
+{
+    UINT32 position;
+    UINT32 time;    // millis()
+};
+
+static UINT8            _rx_ring[UART_RX_RING_SIZE];
+static volatile UINT32  _rx_head;       // Written by the interrupt only
+static volatile UINT32  _rx_tail;       // Written by loop() only
+static UartBurst        _bursts[UART_BURST_RING_SIZE];
+static volatile UINT32  _burst_head;    // Written by the interrupt only
+static volatile UINT32  _burst_tail;    // Written by loop() only
+static bool             _burst_open;    // Interrupt only: line has not gone idle yet
+static volatile bool    _rx_overrun;
+static volatile bool    _rx_error;
+
+#define MEMORY_BARRIER()        __asm__ __volatile__("" ::: "memory")
+
+//---------------------------------------------------------------------------------
+static void IRAM_ATTR uartRxIsr(void *arg, void *frame)
+{
+    (void)arg;
+    (void)frame;
+    UINT32 status = USIS(0);
+    if (status & ((1 << UIFF) | (1 << UITO)))
+    {
+        UINT32 count = (USS(0) >> USRXC) & 0xFF;
+        UINT32 head = _rx_head;
+        UINT32 tail = _rx_tail;
+        if (count && !_burst_open)
+        {
+            //-- First bytes after the line was idle start a new burst
+            UINT32 bhead = _burst_head;
+            if (bhead - _burst_tail < UART_BURST_RING_SIZE)
+            {
+                _bursts[bhead & UART_BURST_RING_MASK].position = head;
+                _bursts[bhead & UART_BURST_RING_MASK].time = millis();
+                MEMORY_BARRIER();
+                _burst_head = bhead + 1;
+            }
+            _burst_open = true;
+        }
+        while (count--)
+        {
+            UINT8 c = USF(0);
+            if (head - tail < UART_RX_RING_SIZE)
+                _rx_ring[head++ & UART_RX_RING_MASK] = c;
+            else
+                _rx_overrun = true;
+        }
+        //-- Publish the bytes only once they are in the ring
+        MEMORY_BARRIER();
+        _rx_head = head;
+        if (status & (1 << UITO))
+            _burst_open = false;
+    }
+    if (status & (1 << UIOF))
+        _rx_overrun = true;
+    if (status & ((1 << UIFR) | (1 << UIPE)))
+        _rx_error = true;
+    USIC(0) = status;
+}
+#endif
+
+//---------------------------------------------------------------------------------
+EspSerial::EspSerial(HardwareSerial &serial)
+    : _serial(serial)
+{
+}
+
+//---------------------------------------------------------------------------------
+void EspSerial::begin(UINT32 baudRate)
+{
+    //-- Start UART connected to UAS
+#ifdef ENABLE_UART_ISR
+    //-- The core only drives TX, RX is ours
+    _serial.begin(baudRate, SERIAL_8N1, SERIAL_TX_ONLY);
+#else
+    _serial.begin(baudRate);
+#endif
+//-- Swap to TXD2/RXD2 (GPIO015/GPIO013) For ESP12 Only
+#ifdef ENABLE_DEBUG
+#ifdef ARDUINO_ESP8266_ESP12
+    _serial.swap();
+#define UART_RX_SWAPPED
+#endif
+#endif
+#ifdef ENABLE_UART_ISR
+    ETS_UART_INTR_DISABLE();
+#ifdef UART_RX_SWAPPED
+    pinMode(13, FUNCTION_4);
+#else
+    pinMode(3, SPECIAL);
+#endif
+    //-- Drop anything already in the FIFO
+    USC0(0) |= (1 << UCRXRST);
+    USC0(0) &= ~(1 << UCRXRST);
+    _rx_head = _rx_tail = 0;
+    _burst_head = _burst_tail = 0;
+    _burst_open = false;
+    _rx_overrun = false;
+    _rx_error = false;
+    USC1(0) = (UART_RX_FIFO_THRESHOLD << UCFFT) | (UART_RX_TIMEOUT << UCTOT) | (1 << UCTOE);
+    USIC(0) = 0xFFFF;
+    USIE(0) = (1 << UIFF) | (1 << UIOF) | (1 << UITO) | (1 << UIFR) | (1 << UIPE);
+    ETS_UART_INTR_ATTACH(uartRxIsr, NULL);
+    ETS_UART_INTR_ENABLE();
+#else
+    // raise serial buffer size (default is 256)
+    _serial.setRxBufferSize(DEFAULT_RECEVE_BUFFER_SIZE);
+#endif
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspSerial::available()
+{
+#ifdef ENABLE_UART_ISR
+    return _rx_head - _rx_tail;
+#else
+    int avail = _serial.available();
+    return avail > 0 ? avail : 0;
+#endif
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspSerial::read(UINT8 *buffer, UINT32 len)
+{
+#ifdef ENABLE_UART_ISR
+    UINT32 tail = _rx_tail;
+    UINT32 avail = _rx_head - tail;
+    MEMORY_BARRIER();
+    if (len > avail)
+        len = avail;
+    //-- At most two copies, before and after the wrap
+    UINT32 offset = tail & UART_RX_RING_MASK;
+    UINT32 first = UART_RX_RING_SIZE - offset;
+    if (first > len)
+        first = len;
+    memcpy(buffer, &_rx_ring[offset], first);
+    memcpy(&buffer[first], _rx_ring, len - first);
+    MEMORY_BARRIER();
+    _rx_tail = tail + len;
+    return len;
+#else
+    return _serial.read((char *)buffer, len);
+#endif
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspSerial::availableForWrite()
+{
+    int avail = _serial.availableForWrite();
+    return avail > 0 ? avail : 0;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspSerial::write(const UINT8 *buffer, UINT32 len)
+{
+    return _serial.write(buffer, len);
+}
+
+//---------------------------------------------------------------------------------
+bool EspSerial::hasOverrun()
+{
+#ifdef ENABLE_UART_ISR
+    if (!_rx_overrun)
+        return false;
+    _rx_overrun = false;
+    return true;
+#else
+    return _serial.hasOverrun();
+#endif
+}
+
+//---------------------------------------------------------------------------------
+bool EspSerial::hasRxError()
+{
+#ifdef ENABLE_UART_ISR
+    if (!_rx_error)
+        return false;
+    _rx_error = false;
+    return true;
+#else
+    return _serial.hasRxError();
+#endif
+}
+
+//---------------------------------------------------------------------------------
+//-- Non-blocking: the first call starts the measurement
+UINT32 EspSerial::detectBaudRate()
+{
+    int rate = uart_detect_baudrate(0);
+    return rate > 0 ? rate : 0;
+}
+
+//---------------------------------------------------------------------------------
+//-- UART0 only: CTS on GPIO13 holds the TX FIFO, RTS on GPIO15 is raised
+//   when the RX FIFO fills up. Both pins are taken by the TXD2/RXD2 swap.
+void EspSerial::setFlowControl(bool enable)
+{
+#ifndef UART_RX_SWAPPED
+    if (enable)
+    {
+        pinMode(13, FUNCTION_4);    // U0CTS
+        pinMode(15, FUNCTION_4);    // U0RTS
+        USC1(0) = (USC1(0) & ~(0x7F << UCRXHFT)) | (UART_RTS_THRESHOLD << UCRXHFT) | (1 << UCRXHFE);
+        USC0(0) |= (1 << UCTXHFE);
+    }
+    else
+    {
+        USC0(0) &= ~(1 << UCTXHFE);
+        USC1(0) &= ~(1 << UCRXHFE);
+    }
+#else
+    (void)enable;
+#endif
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspSerial::rxTime()
+{
+#ifdef ENABLE_UART_ISR
+    //-- Skip bursts that were read completely; the oldest one left holds
+    //   the oldest unread byte
+    UINT32 tail = _rx_tail;
+    UINT32 btail = _burst_tail;
+    UINT32 bhead = _burst_head;
+    MEMORY_BARRIER();
+    while (bhead - btail > 1 && (INT32)(_bursts[(btail + 1) & UART_BURST_RING_MASK].position - tail) <= 0)
+        btail++;
+    _burst_tail = btail;
+    if (btail != bhead && _rx_head != tail)
+        return _bursts[btail & UART_BURST_RING_MASK].time;
+#endif
+    return millis();
+}
+
+//---------------------------------------------------------------------------------
+EspUdp::EspUdp()
+{
+}
+
+//---------------------------------------------------------------------------------
+bool EspUdp::begin(UINT16 port)
+{
+    return _udp.begin(port) == 1;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspUdp::parsePacket()
+{
+    int len = _udp.parsePacket();
+    return len > 0 ? len : 0;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspUdp::read(UINT8 *buffer, UINT32 len)
+{
+    int got = _udp.read(buffer, len);
+    return got > 0 ? got : 0;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspUdp::remoteIP()
+{
+    return (UINT32)_udp.remoteIP();
+}
+
+//---------------------------------------------------------------------------------
+UINT16 EspUdp::remotePort()
+{
+    return _udp.remotePort();
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspUdp::sendTo(UINT32 ip, UINT16 port, const UINT8 *buffer, UINT32 len)
+{
+    if (!_udp.beginPacket(IPAddress(ip), port))
+        return 0;
+    size_t sent = _udp.write(buffer, len);
+    if (!_udp.endPacket())
+        return 0;
+    return sent;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspUdp::sendTo(UINT32 ip, UINT16 port, const UINT8 *header, UINT32 header_len, const UINT8 *buffer, UINT32 len)
+{
+    if (!_udp.beginPacket(IPAddress(ip), port))
+        return 0;
+    size_t sent = _udp.write(header, header_len);
+    sent += _udp.write(buffer, len);
+    if (!_udp.endPacket())
+        return 0;
+    return sent;
+}
+
+//---------------------------------------------------------------------------------
+EspTcp::EspTcp()
+    : _server(DEFAULT_TCP_PORT)
+{
+}
+
+//---------------------------------------------------------------------------------
+bool EspTcp::begin(UINT16 port)
+{
+    _server.begin(port);
+    _server.setNoDelay(true);
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+bool EspTcp::accept(UINT8 slot)
+{
+    WiFiClient client = _server.available();
+    if (!client)
+        return false;
+    _clients[slot] = client;
+    _clients[slot].setNoDelay(true);
+    //-- write() returns once lwIP has the bytes, without waiting for the ACK
+    _clients[slot].setSync(false);
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+bool EspTcp::reject()
+{
+    WiFiClient client = _server.available();
+    if (!client)
+        return false;
+    client.stop();
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+bool EspTcp::connected(UINT8 slot)
+{
+    return _clients[slot].connected();
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspTcp::read(UINT8 slot, UINT8 *buffer, UINT32 len)
+{
+    if (_clients[slot].available() <= 0)
+        return 0;
+    int got = _clients[slot].read(buffer, len);
+    return got > 0 ? got : 0;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspTcp::availableForWrite(UINT8 slot)
+{
+    return _clients[slot].availableForWrite();
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspTcp::write(UINT8 slot, const UINT8 *buffer, UINT32 len)
+{
+    return len ? _clients[slot].write(buffer, len) : 0;
+}
+
+//---------------------------------------------------------------------------------
+void EspTcp::close(UINT8 slot)
+{
+    _clients[slot].stop();
+}
+
+//---------------------------------------------------------------------------------
+UINT32 EspTcp::remoteIP(UINT8 slot)
+{
+    return (UINT32)_clients[slot].remoteIP();
+}
+
+//---------------------------------------------------------------------------------
+UINT16 EspTcp::remotePort(UINT8 slot)
+{
+    return _clients[slot].remotePort();
+}
@@ -0,0 +1,106 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file esp_transport.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Bridge transports backed by the ESP8266 UART, WiFiUDP and WiFiServer.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef ESP_TRANSPORT_H
+#define ESP_TRANSPORT_H
+
+#include "transport.h"
+#include <ESP8266WiFi.h>
+#include <WiFiClient.h>
+#include <WiFiUdp.h>
+
+class EspSerial : public BridgeSerial
+{
+public:
+    EspSerial(HardwareSerial &serial);
+
+    void    begin               (UINT32 baudRate);
+    UINT32  available           ();
+    UINT32  read                (UINT8 *buffer, UINT32 len);
+    UINT32  availableForWrite   ();
+    UINT32  write               (const UINT8 *buffer, UINT32 len);
+    bool    hasOverrun          ();
+    UINT32  rxTime              ();
+    bool    hasRxError          ();
+    void    setFlowControl      (bool enable);
+    UINT32  detectBaudRate      ();
+
+private:
+    HardwareSerial &_serial;
+};
+
+class EspUdp : public BridgeUdp
+{
+public:
+    EspUdp();
+
+    bool    begin               (UINT16 port);
+    UINT32  parsePacket         ();
+    UINT32  read                (UINT8 *buffer, UINT32 len);
+    UINT32  remoteIP            ();
+    UINT16  remotePort          ();
+    UINT32  sendTo              (UINT32 ip, UINT16 port, const UINT8 *buffer, UINT32 len);
+    UINT32  sendTo              (UINT32 ip, UINT16 port, const UINT8 *header, UINT32 header_len, const UINT8 *buffer, UINT32 len);
+
+private:
+    WiFiUDP _udp;
+};
+
+class EspTcp : public BridgeTcp
+{
+public:
+    EspTcp();
+
+    bool    begin               (UINT16 port);
+    bool    accept              (UINT8 slot);
+    bool    reject              ();
+    bool    connected           (UINT8 slot);
+    UINT32  read                (UINT8 slot, UINT8 *buffer, UINT32 len);
+    UINT32  availableForWrite   (UINT8 slot);
+    UINT32  write               (UINT8 slot, const UINT8 *buffer, UINT32 len);
+    void    close               (UINT8 slot);
+    UINT32  remoteIP            (UINT8 slot);
+    UINT16  remotePort          (UINT8 slot);
+
+private:
+    WiFiServer _server;
+    WiFiClient _clients[TCP_MAX_CLIENTS];
+};
+
+#endif
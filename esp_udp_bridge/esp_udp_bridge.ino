@@ -42,14 +42,23 @@
 #include "common.h"
 #include "parameters.h"
 #include "bridge.h"
+#include "esp_transport.h"
 #include "httpd.h"
+#include "packet_pool.h"
+#include "profiler.h"
+#include "scheduler.h"
 
 // #define FACTORY_RESET_PIN_ENABLE
 #define GPIO02  2
 
 IPAddress               localIP;
 ESP8266Httpd            updateServer;
-ESP8266Bridge           bridge;
+EspSerial               bridgeSerial(Serial);
+EspUdp                  bridgeUdp;
+EspTcp                  bridgeTcp;
+EspTcp                  bridgeWs;
+ESP8266Bridge           bridge(&bridgeSerial, &bridgeUdp, &bridgeTcp, &bridgeWs);
+Scheduler               scheduler;
 
 IPAddress local_ip(192,168,1,1);
 IPAddress gateway(192,168,1,1);
@@ -93,8 +102,53 @@ void reset_interrupt(){
 
 
 
+//-- Scheduler tasks
+static void udpReadTask()
+{
+    PROFILE_START();
+    bridge.udp_readMessageRaw();
+    PROFILE_MARK(PROFILE_UDP_READ);
+}
+
+static void serialReadTask()
+{
+    PROFILE_START();
+    bridge.serial_readMessageRaw();
+    PROFILE_MARK(PROFILE_SERIAL_READ);
+}
+
+static void tcpReadTask()
+{
+    PROFILE_START();
+    bridge.tcp_readMessageRaw();
+    PROFILE_MARK(PROFILE_TCP_READ);
+}
+
+static void wsReadTask()
+{
+    PROFILE_START();
+    bridge.ws_readMessageRaw();
+    PROFILE_MARK(PROFILE_WS_READ);
+}
+
+static void httpdTask()
+{
+    PROFILE_START();
+    updateServer.checkUpdates();
+    PROFILE_MARK(PROFILE_HTTPD);
+}
+
+static void housekeepingTask()
+{
+    PROFILE_START();
+    bridge.housekeeping();
+    PROFILE_MARK(PROFILE_HOUSEKEEPING);
+}
+
 void setup()
 {
+    //-- First, so log() has buffers
+    packetPool.begin();
     Eeprom_begin();
     
     delay(1000);
@@ -173,17 +227,28 @@ void setup()
    
 
 
-   bridge.begin(gcs_ip, getWifiUdpHport(), getWifiUdpCport(), DEFAULT_UART_SPEED);
+   bridge.begin((UINT32)gcs_ip, getWifiUdpHport(), getWifiUdpCport(), getUartBaudRate());
    //-- Initialize Update Server
-   updateServer.begin();
+   updateServer.begin(&bridge, &scheduler);
+#ifdef ENABLE_PROFILER
+   Profile_begin();
+#endif
+
+   //-- Bridge I/O on every pass, the rest in whatever time is left
+   scheduler.addTask("udp_read", udpReadTask, TASK_IO, SCHED_IO_PERIOD, SCHED_IO_BUDGET);
+   scheduler.addTask("serial_read", serialReadTask, TASK_IO, SCHED_IO_PERIOD, SCHED_IO_BUDGET);
+   if (getWifiTcpPort())
+       scheduler.addTask("tcp_read", tcpReadTask, TASK_IO, SCHED_IO_PERIOD, SCHED_IO_BUDGET);
+   if (getWifiWsPort())
+       scheduler.addTask("ws_read", wsReadTask, TASK_IO, SCHED_IO_PERIOD, SCHED_IO_BUDGET);
+   scheduler.addTask("httpd", httpdTask, TASK_BACKGROUND, SCHED_HTTPD_PERIOD, SCHED_HTTPD_BUDGET);
+   scheduler.addTask("housekeeping", housekeepingTask, TASK_BACKGROUND, SCHED_HOUSEKEEPING_PERIOD, SCHED_HOUSEKEEPING_BUDGET);
 }
 
 
 void loop()
 {
-    bridge.udp_readMessageRaw();
-    // // delay(0);
-    bridge.serial_readMessageRaw();
-    
-    updateServer.checkUpdates();
+    PROFILE_LOOP_START();
+    //-- One pass, then back to the SDK for WiFi
+    scheduler.run();
 }
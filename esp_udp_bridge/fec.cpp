@@ -0,0 +1,252 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file fec.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "fec.h"
+
+//---------------------------------------------------------------------------------
+//-- XOR the 16 bit length and the bytes of a datagram into a parity that
+//   holds used bytes, zero extending it first if the datagram is longer
+static void _accumulate(UINT8 *parity, UINT16 &used, const UINT8 *data, UINT32 len)
+{
+    if (len + 2 > used)
+    {
+        memset(&parity[used], 0, len + 2 - used);
+        used = len + 2;
+    }
+    parity[0] ^= len & 0xFF;
+    parity[1] ^= len >> 8;
+    for (UINT32 i = 0; i < len; i++)
+        parity[i + 2] ^= data[i];
+}
+
+//---------------------------------------------------------------------------------
+static UINT8 _bits(UINT16 mask)
+{
+    UINT8 n = 0;
+    for (; mask; mask &= mask - 1)
+        n++;
+    return n;
+}
+
+//---------------------------------------------------------------------------------
+FecEncoder::FecEncoder()
+{
+    begin(0);
+}
+
+//---------------------------------------------------------------------------------
+void FecEncoder::begin(UINT8 group_size)
+{
+    _group_size = (group_size > FEC_GROUP_MAX) ? FEC_GROUP_MAX : group_size;
+    _group = 0;
+    _count = 0;
+    _parity_len = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+//---------------------------------------------------------------------------------
+UINT32 FecEncoder::add(UINT8 *data, UINT32 len)
+{
+    _accumulate(&_parity[FEC_HEADER_LEN], _parity_len, data, len);
+    memmove(&data[FEC_HEADER_LEN], data, len);
+    data[0] = FEC_MAGIC;
+    data[1] = _group;
+    data[2] = _count++;
+    _stats.data_bytes += len + FEC_HEADER_LEN;
+    return len + FEC_HEADER_LEN;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 FecEncoder::parity(const UINT8 *&out)
+{
+    if (!_count)
+        return 0;
+    _parity[0] = FEC_MAGIC;
+    _parity[1] = _group++;
+    _parity[2] = FEC_PARITY | _count;
+    UINT32 len = FEC_HEADER_LEN + _parity_len;
+    _count = 0;
+    _parity_len = 0;
+    _stats.groups++;
+    _stats.parity_bytes += len;
+    out = _parity;
+    return len;
+}
+
+//---------------------------------------------------------------------------------
+FecDecoder::FecDecoder()
+{
+    reset();
+}
+
+//---------------------------------------------------------------------------------
+void FecDecoder::reset()
+{
+    for (UINT8 i = 0; i < FEC_DECODER_GROUPS; i++)
+        _groups[i].used = false;
+    _age = 0;
+    _recovered_len = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+//---------------------------------------------------------------------------------
+bool FecDecoder::isFec(const UINT8 *in, UINT32 len)
+{
+    return len > FEC_HEADER_LEN && in[0] == FEC_MAGIC;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 FecDecoder::receive(const UINT8 *in, UINT32 len, const UINT8 *&out)
+{
+    _recovered_len = 0;
+    if (!isFec(in, len) || len - FEC_HEADER_LEN > 2 + FEC_PAYLOAD_MAX)
+        return 0;
+    UINT8 index = in[2];
+    const UINT8 *payload = &in[FEC_HEADER_LEN];
+    len -= FEC_HEADER_LEN;
+    Group &g = *_find(in[1]);
+    if (index & FEC_PARITY)
+    {
+        UINT8 count = index & ~FEC_PARITY;
+        if (g.parity_len)
+        {
+            _stats.duplicates++;
+            return 0;
+        }
+        if (count == 0 || count > FEC_GROUP_MAX || len < 2)
+            return 0;
+        memcpy(g.parity, payload, len);
+        g.parity_len = len;
+        g.count = count;
+        _stats.parity++;
+        _tryRecover(g);
+        return 0;
+    }
+    if (index >= FEC_GROUP_MAX || len > FEC_PAYLOAD_MAX)
+        return 0;
+    if (g.received & (1 << index))
+    {
+        _stats.duplicates++;
+        return 0;
+    }
+    g.received |= 1 << index;
+    if (index >= g.highest)
+        g.highest = index + 1;
+    _accumulate(g.acc, g.len, payload, len);
+    _stats.datagrams++;
+    _tryRecover(g);
+    out = payload;
+    return len;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 FecDecoder::recovered(const UINT8 *&out)
+{
+    UINT32 len = _recovered_len;
+    _recovered_len = 0;
+    out = &_recovered[2];
+    return len;
+}
+
+//---------------------------------------------------------------------------------
+void FecDecoder::flush()
+{
+    for (UINT8 i = 0; i < FEC_DECODER_GROUPS; i++)
+    {
+        if (_groups[i].used)
+            _close(_groups[i]);
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- The group with this sequence, opened in place of the oldest if needed
+FecDecoder::Group *FecDecoder::_find(UINT8 seq)
+{
+    Group *slot = NULL;
+    for (UINT8 i = 0; i < FEC_DECODER_GROUPS; i++)
+    {
+        Group &g = _groups[i];
+        if (g.used && g.seq == seq)
+            return &g;
+        if (!slot || (slot->used && (!g.used || g.age < slot->age)))
+            slot = &g;
+    }
+    if (slot->used)
+        _close(*slot);
+    slot->used = true;
+    slot->seq = seq;
+    slot->count = 0;
+    slot->highest = 0;
+    slot->received = 0;
+    slot->len = 0;
+    slot->parity_len = 0;
+    slot->age = _age++;
+    return slot;
+}
+
+//---------------------------------------------------------------------------------
+//-- Without the parity, only gaps before the highest index are known losses
+void FecDecoder::_close(Group &g)
+{
+    UINT8 expected = g.parity_len ? g.count : g.highest;
+    UINT16 mask = (expected >= 16) ? 0xFFFF : (UINT16)((1 << expected) - 1);
+    _stats.lost += expected - _bits(g.received & mask);
+    g.used = false;
+}
+
+//---------------------------------------------------------------------------------
+//-- The parity XOR everything received is the one datagram still missing
+bool FecDecoder::_tryRecover(Group &g)
+{
+    if (!g.parity_len || g.len > g.parity_len)
+        return false;
+    UINT16 mask = (g.count >= 16) ? 0xFFFF : (UINT16)((1 << g.count) - 1);
+    UINT16 missing = mask & ~g.received;
+    if (_bits(missing) != 1)
+        return false;
+    for (UINT16 i = 0; i < g.parity_len; i++)
+        _recovered[i] = g.parity[i] ^ ((i < g.len) ? g.acc[i] : 0);
+    UINT32 len = _recovered[0] | ((UINT32)_recovered[1] << 8);
+    if (len + 2 > g.parity_len)
+        return false;
+    //-- Counted as received, so it is neither rebuilt twice nor lost
+    g.received |= missing;
+    _accumulate(g.acc, g.len, &_recovered[2], len);
+    _recovered_len = len;
+    _stats.recovered++;
+    return true;
+}
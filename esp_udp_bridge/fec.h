@@ -0,0 +1,158 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file fec.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * XOR forward error correction over groups of downlink datagrams. After
+ * every group of up to FEC_GROUP_MAX datagrams the bridge sends one parity
+ * datagram, from which the host side proxy rebuilds any single datagram of
+ * the group that WiFi lost. The encoder keeps one running parity and no
+ * copies of the datagrams; so does the decoder, per group in flight.
+ *
+ * Header: FEC_MAGIC, group sequence, then the index in the group (data)
+ * or FEC_PARITY plus the number of datagrams in the group (parity). The
+ * parity covers the 16 bit little endian length of each datagram followed
+ * by its bytes, zero padded to the longest one.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef FEC_H
+#define FEC_H
+
+#include "common.h"
+
+#define FEC_MAGIC               0xED    // Neither MAVLink nor LZF_MAGIC
+#define FEC_PARITY              0x80
+#define FEC_HEADER_LEN          3
+#define FEC_OVERHEAD            (FEC_HEADER_LEN + 2) // Header and length of a parity datagram
+#define FEC_GROUP_TIMEOUT       50      // ms an open group waits for more datagrams
+#define FEC_PAYLOAD_MAX         (PACKET_BUFFER_SIZE - FEC_OVERHEAD)
+#define FEC_DECODER_GROUPS      4       // Groups the decoder has in flight
+
+struct FecStats
+{
+    UINT32  groups;         // Parity datagrams built
+    UINT32  skipped;        // Parity not sent as the link was congested
+    UINT32  data_bytes;     // Data datagrams, headers included
+    UINT32  parity_bytes;
+};
+
+class FecEncoder
+{
+public:
+    FecEncoder();
+
+    //-- Datagrams per parity datagram, 0 to disable
+    void        begin       (UINT8 group_size);
+    bool        enabled     () const { return _group_size != 0; }
+    UINT8       groupSize   () const { return _group_size; }
+    UINT8       pending     () const { return _count; }
+    bool        full        () const { return _count >= _group_size; }
+
+    //-- Prepends the header to the len bytes in data (which must have room
+    //   for FEC_HEADER_LEN more, and len <= FEC_PAYLOAD_MAX) and adds them to
+    //   the parity. Returns the new length.
+    UINT32      add         (UINT8 *data, UINT32 len);
+    //-- Closes the group. Returns the parity datagram, valid until the next add().
+    UINT32      parity      (const UINT8 *&out);
+    //-- The parity of the closed group was not sent
+    void        skipped     () { _stats.skipped++; }
+
+    const FecStats &getStats() const { return _stats; }
+
+private:
+    UINT8       _group_size;
+    UINT8       _group;
+    UINT8       _count;
+    UINT16      _parity_len;    // Bytes of _parity in use, after the header
+    FecStats    _stats;
+    UINT8       _parity[FEC_OVERHEAD + FEC_PAYLOAD_MAX];
+};
+
+struct FecDecoderStats
+{
+    UINT32  datagrams;      // Data datagrams received
+    UINT32  parity;         // Parity datagrams received
+    UINT32  recovered;      // Data datagrams rebuilt from the parity
+    UINT32  lost;           // Missing data datagrams that could not be rebuilt
+    UINT32  duplicates;
+};
+
+class FecDecoder
+{
+public:
+    FecDecoder();
+
+    void        reset       ();
+    //-- Whether a datagram carries an FEC header
+    static bool isFec       (const UINT8 *in, UINT32 len);
+
+    //-- Takes a datagram with an FEC header. Returns the length of the data it
+    //   carries (0 for parity and duplicates), pointed to by out. Check
+    //   recovered() after each call.
+    UINT32      receive     (const UINT8 *in, UINT32 len, const UINT8 *&out);
+    //-- A datagram rebuilt by the last receive(), or 0
+    UINT32      recovered   (const UINT8 *&out);
+    //-- Counts what is still missing in the groups in flight as lost
+    void        flush       ();
+
+    const FecDecoderStats &getStats() const { return _stats; }
+
+private:
+    struct Group
+    {
+        bool    used;
+        UINT8   seq;
+        UINT8   count;      // Datagrams in the group, once the parity is in
+        UINT8   highest;    // Highest index + 1 seen
+        UINT16  received;   // Bitmask of indexes
+        UINT16  len;        // Bytes of acc in use
+        UINT16  parity_len; // Bytes of parity, 0 until it is in
+        UINT32  age;        // Order the group was opened in
+        UINT8   acc[2 + FEC_PAYLOAD_MAX];       // XOR of what was received
+        UINT8   parity[2 + FEC_PAYLOAD_MAX];
+    };
+
+    Group      *_find       (UINT8 seq);
+    void        _close      (Group &g);
+    bool        _tryRecover (Group &g);
+
+private:
+    Group       _groups[FEC_DECODER_GROUPS];
+    UINT32      _age;
+    UINT16      _recovered_len;
+    UINT8       _recovered[2 + FEC_PAYLOAD_MAX];
+    FecDecoderStats _stats;
+};
+
+#endif
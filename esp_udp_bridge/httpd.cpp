@@ -41,12 +41,15 @@
 #include <ESP8266WebServer.h>   // Include the WebServer library
 
 #include "httpd.h"
+#include "packet_pool.h"
+#include "page_writer.h"
+#include "profiler.h"
 
 const char kTEXTPLAIN[] = "text/plain";
 const char kTEXTHTML[] = "text/html";
 const char kACCESSCTL[] = "Access-Control-Allow-Origin";
 const char kUPLOADFORM[] = "<h1><a href='/'> ESP_UDP_BRIDGE (UDP to Serial Bridge)</a></h1><form method='POST' action='/upload' enctype='multipart/form-data'><input type='file' name='update'><br><input type='submit' value='Update'></form>";
-const char kHEADER[] = "<!doctype html><html><head><title>ESP_UDP_BRIDGE (UDP to Serial Bridge)</title></head><body><h1><a href='/'>ESP_UDP_BRIDGE (UDP to Serial Bridge)</a></h1>";
+const char kHEADER[] PROGMEM = "<!doctype html><html><head><title>ESP_UDP_BRIDGE (UDP to Serial Bridge)</title></head><body><h1><a href='/'>ESP_UDP_BRIDGE (UDP to Serial Bridge)</a></h1>";
 const char kBADARG[] = "BAD ARGS";
 const char kAPPJSON[] = "application/json";
 
@@ -59,12 +62,28 @@ const char *kIPSTA = "ipsta";
 const char *kGATESTA = "gatewaysta";
 const char *kSUBSTA = "subnetsta";
 const char *kCPORT = "cport";
+const char *kTCPPORT = "tcpport";
+const char *kWSPORT = "wsport";
 const char *kHPORT = "hport";
 const char *kCHANNEL = "channel";
 const char *kDEBUG = "debug";
 const char *kREBOOT = "reboot";
 const char *kPOSITION = "position";
 const char *kMODE = "mode";
+const char *kQTHRESHOLD = "qthreshold";
+const char *kQTIMEOUT = "qtimeout";
+const char *kMAXCLIENTS = "maxclients";
+const char *kCLIENTTIMEOUT = "clienttimeout";
+const char *kSTATICHOST = "statichost";
+const char *kTXPOLICY = "txpolicy";
+const char *kFLOWCTRL = "flowctrl";
+const char *kAUTOBAUD = "autobaud";
+const char *kCOMPRESS = "compress";
+const char *kFEC = "fec";
+const char *kLINKHEADER = "linkheader";
+const char *kRELIABLE = "reliable";
+const char *kRATELIMIT = "ratelimit"; // ratelimit1 .. ratelimit8
+const char *kRESET = "reset";
 
 const char *kFlashMaps[7] = {
     "512KB (256/256)",
@@ -76,6 +95,26 @@ const char *kFlashMaps[7] = {
     "4MB (1024/1024)"};
 
 static UINT32 flash = 0;
+static ESP8266Bridge *_bridge = NULL;
+static Scheduler *_scheduler = NULL;
+
+enum
+{
+    PAGE_ROOT = 0,
+    PAGE_PARAMETERS,
+    PAGE_SETUP,
+    PAGE_STATUS,
+    PAGE_STATS,
+    PAGE_COUNT
+};
+
+static const char kPageRoot[] PROGMEM = "Root";
+static const char kPageParameters[] PROGMEM = "Parameters";
+static const char kPageSetup[] PROGMEM = "Setup";
+static const char kPageStatus[] PROGMEM = "Status";
+static const char kPageStats[] PROGMEM = "Stats (JSON)";
+static PGM_P const kPageNames[PAGE_COUNT] = {kPageRoot, kPageParameters, kPageSetup, kPageStatus, kPageStats};
+static PageStats _page_stats[PAGE_COUNT];
 
 ESP8266WebServer webServer(80);
 bool started = false;
@@ -177,220 +216,279 @@ void handle_upload_status()
     }
 }
 
+//---------------------------------------------------------------------------------
+//-- Strings are stashed in four consecutive UINT32 parameters
+static bool isStringParam(int id)
+{
+    return id == ID_SSID1 || id == ID_PASS1 || id == ID_SSIDSTA1 || id == ID_PASSSTA1;
+}
+
+static bool isStringTail(int id)
+{
+    return (id > ID_SSID1 && id <= ID_SSID4) || (id > ID_PASS1 && id <= ID_PASS4) ||
+           (id > ID_SSIDSTA1 && id <= ID_SSIDSTA4) || (id > ID_PASSSTA1 && id <= ID_PASSSTA4);
+}
+
+//---------------------------------------------------------------------------------
+//-- Renders a value straight from the parameter table
+static void printParamValue(PageWriter &page, int id)
+{
+    ParameterFields *param = Param_getAt(id);
+    if (isStringParam(id))
+        page.printEscaped((const char *)param->value, 4 * sizeof(UINT32));
+    else if (param->length == sizeof(UINT32))
+        page.print(*((UINT32 *)param->value));
+    else if (param->length == sizeof(UINT16))
+        page.print((UINT32)*((UINT16 *)param->value));
+    else
+        page.print((UINT32)*((UINT8 *)param->value));
+}
+
 //---------------------------------------------------------------------------------
 void handle_getParameters()
 {
-        String message = FPSTR(kHEADER);
-    message += "<p>Parameters</p><table><tr><td width=\"240\">Name</td><td>Value</td></tr>";
+    PageWriter page(webServer, _page_stats[PAGE_PARAMETERS]);
+    page.begin(kTEXTHTML);
+    page.print_P(kHEADER);
+    page.print_P(PSTR("<p>Parameters</p><table><tr><td width=\"240\">Name</td><td>Value</td></tr>"));
     for (int i = 0; i < ID_COUNT; i++)
     {
-        if(i == ID_FWVER)
-        {
-            message += "<tr><td>";
-            message += Param_getAt(i)->id;
-            message += "</td>";
-            message += "<td>";
-            message += ESP_UDP_BRIDGE_VERSION_MAJOR;
-            message += ".";
-            message += ESP_UDP_BRIDGE_VERSION_MINOR;
-            message += ".";
-            message += ESP_UDP_BRIDGE_VERSION_BUILD;
-            message += "</td></tr>";
-        }
-        else if(i == ID_MODE)
-        {
-            message += "<tr><td>";
-            message += Param_getAt(i)->id;
-            message += "</td>";
-            message += "<td>";
-            if(getWifiMode() == WIFI_MODE_AP)
-            {
-                message += "AP (Access Point)";
-            }
-            else
-            {
-                message += "STA";
-            }
-            message += "</td></tr>";
-        }
-        else if(i == ID_IPADDRESS)
-        {
-            message += "<tr><td>";
-            message += Param_getAt(i)->id;
-            message += "</td>";
-            message += "<td>";
-            message += getLocalIPAddress();
-            message += "</td></tr>";
-        }
-        else if(i == ID_SSID1)
-        {
-            message += "<tr><td>";
-            message += Param_getAt(i)->id;
-            message += "</td>";
-            message += "<td>";
-            message += (const char*)getWifiSsid();
-            message += "</td></tr>";
-        }
-        else if(i > ID_SSID1 && i <= ID_SSID4) {}
-        else if(i == ID_PASS1)
-        {
-            message += "<tr><td>";
-            message += Param_getAt(i)->id;
-            message += "</td>";
-            message += "<td>";
-            message += (const char*)getWifiPassword();
-            message += "</td></tr>";
-        }
-        else if(i > ID_PASS1 && i <= ID_PASS4) {}
-        else if(i == ID_SSIDSTA1)
+        if (isStringTail(i))
+            continue;
+        page.print_P(PSTR("<tr><td>"));
+        page.print(Param_getAt(i)->id);
+        page.print_P(PSTR("</td><td>"));
+        if (i == ID_FWVER)
         {
-            message += "<tr><td>";
-            message += Param_getAt(i)->id;
-            message += "</td>";
-            message += "<td>";
-            message += (const char*)getWifiStaSsid();
-            message += "</td></tr>";
-        }
-        else if(i > ID_SSIDSTA1 && i <= ID_SSIDSTA4) {}
-        else if(i == ID_PASSSTA1)
-        {
-            message += "<tr><td>";
-            message += Param_getAt(i)->id;
-            message += "</td>";
-            message += "<td>";
-            message += (const char*)getWifiStaPassword();
-            message += "</td></tr>";
-        }
-        else if(i > ID_PASSSTA1 && i <= ID_PASSSTA4) {}
-        else // integer values
-        {
-            message += "<tr><td>";
-            message += Param_getAt(i)->id;
-            message += "</td>";
-            unsigned long val = 0;
-            if (Param_getAt(i)->type == PARAM_TYPE_UINT32)
-                val = (unsigned long)*((UINT32 *)Param_getAt(i)->value);
-            else if (Param_getAt(i)->type == PARAM_TYPE_UINT16)
-                val = (unsigned long)*((UINT16 *)Param_getAt(i)->value);
-            else
-                val = (unsigned long)*((UINT8 *)Param_getAt(i)->value);
-
-            message += "<td>";
-            message += val;
-            message += "</td></tr>";
+            char vstr[30];
+            snprintf(vstr, sizeof(vstr), "%u.%u.%u", ESP_UDP_BRIDGE_VERSION_MAJOR, ESP_UDP_BRIDGE_VERSION_MINOR, ESP_UDP_BRIDGE_VERSION_BUILD);
+            page.print(vstr);
         }
+        else if (i == ID_MODE)
+            page.print_P(getWifiMode() == WIFI_MODE_AP ? PSTR("AP (Access Point)") : PSTR("STA"));
+        else if (i == ID_IPADDRESS)
+            page.print(getLocalIPAddress().c_str());
+        else
+            printParamValue(page, i);
+        page.print_P(PSTR("</td></tr>"));
     }
-    message += "</table>";
-    message += "</body>";
-    webServer.send(200, FPSTR(kTEXTHTML), message);
+    page.print_P(PSTR("</table></body>"));
+    page.end();
 }
 
 //---------------------------------------------------------------------------------
 static void handle_root()
 {
-    String message = FPSTR(kHEADER);
-    message += "Version: ";
+    PageWriter page(webServer, _page_stats[PAGE_ROOT]);
+    setNoCacheHeaders();
+    page.begin(kTEXTHTML);
+    page.print_P(kHEADER);
+    page.print_P(PSTR("Version: "));
     char vstr[30];
     snprintf(vstr, sizeof(vstr), "%u.%u.%u", ESP_UDP_BRIDGE_VERSION_MAJOR, ESP_UDP_BRIDGE_VERSION_MINOR, ESP_UDP_BRIDGE_VERSION_BUILD);
-    message += vstr;
-    message += "<p>\n";
-    message += "<ul>\n";
-    message += "<li><a href='/getstatus'>Get Status</a>\n";
-    message += "<li><a href='/setup'>Setup</a>\n";
-    message += "<li><a href='/getparameters'>Get Parameters</a>\n";
-    message += "<li><a href='/update'>Update Firmware</a>\n";
-    message += "<li><a href='/reboot'>Reboot</a>\n";
-    message += "</ul></body>";
+    page.print(vstr);
+    page.print_P(PSTR(
+        "<p>\n"
+        "<ul>\n"
+        "<li><a href='/getstatus'>Get Status</a>\n"
+        "<li><a href='/setup'>Setup</a>\n"
+        "<li><a href='/getparameters'>Get Parameters</a>\n"
+        "<li><a href='/update'>Update Firmware</a>\n"
+        "<li><a href='/reboot'>Reboot</a>\n"
+        "</ul></body>"));
+    page.end();
+}
+
+//---------------------------------------------------------------------------------
+//-- Setup form fields, in page order
+enum
+{
+    FIELD_VALUE = 0,
+    FIELD_IP
+};
+
+struct SetupField
+{
+    PGM_P       label;
+    const char *name;
+    UINT8       id;
+    UINT8       format;
+};
+
+static const char kLabelSsid[] PROGMEM = "AP SSID";
+static const char kLabelPwd[] PROGMEM = "AP Password (min len 8)";
+static const char kLabelChannel[] PROGMEM = "WiFi Channel";
+static const char kLabelSsidSta[] PROGMEM = "Station SSID";
+static const char kLabelPwdSta[] PROGMEM = "Station Password";
+static const char kLabelIpSta[] PROGMEM = "Station IP";
+static const char kLabelGatewaySta[] PROGMEM = "Station Gateway";
+static const char kLabelSubnetSta[] PROGMEM = "Station Subnet";
+static const char kLabelHport[] PROGMEM = "Host Port";
+static const char kLabelStaticHost[] PROGMEM = "Send to Host Port (0/1)";
+static const char kLabelCport[] PROGMEM = "Client Port";
+static const char kLabelTcpPort[] PROGMEM = "TCP Port (0 off, usually 5760)";
+static const char kLabelWsPort[] PROGMEM = "WebSocket Port (0 off, usually 81)";
+static const char kLabelBaud[] PROGMEM = "Baudrate";
+static const char kLabelQThreshold[] PROGMEM = "Queue Threshold (bytes)";
+static const char kLabelQTimeout[] PROGMEM = "Queue Timeout (ms)";
+static const char kLabelMaxClients[] PROGMEM = "Max UDP Clients";
+static const char kLabelClientTimeout[] PROGMEM = "UDP Client Timeout (s)";
+static const char kLabelTxPolicy[] PROGMEM = "UART TX Full (0 newest/1 oldest/2 frame)";
+static const char kLabelFlowCtrl[] PROGMEM = "UART RTS/CTS (0/1)";
+static const char kLabelAutoBaud[] PROGMEM = "UART Auto-baud (0/1)";
+static const char kLabelCompress[] PROGMEM = "Compress Downlink (0/1, GCS needs lz_proxy)";
+static const char kLabelFec[] PROGMEM = "FEC Group Size (0 off/1-16, GCS needs lz_proxy)";
+static const char kLabelLinkHeader[] PROGMEM = "Link Header (0/1, GCS needs lz_proxy --link-header)";
+static const char kLabelReliable[] PROGMEM = "Reliable Uplink (0/1, GCS needs lz_proxy --reliable)";
+
+static const SetupField kSetupFields[] = {
+    {kLabelSsid, kSSID, ID_SSID1, FIELD_VALUE},
+    {kLabelPwd, kPWD, ID_PASS1, FIELD_VALUE},
+    {kLabelChannel, kCHANNEL, ID_CHANNEL, FIELD_VALUE},
+    {kLabelSsidSta, kSSIDSTA, ID_SSIDSTA1, FIELD_VALUE},
+    {kLabelPwdSta, kPWDSTA, ID_PASSSTA1, FIELD_VALUE},
+    {kLabelIpSta, kIPSTA, ID_IPSTA, FIELD_IP},
+    {kLabelGatewaySta, kGATESTA, ID_GATEWAYSTA, FIELD_IP},
+    {kLabelSubnetSta, kSUBSTA, ID_SUBNETSTA, FIELD_IP},
+    {kLabelHport, kHPORT, ID_HPORT, FIELD_VALUE},
+    {kLabelStaticHost, kSTATICHOST, ID_STATICHOST, FIELD_VALUE},
+    {kLabelCport, kCPORT, ID_CPORT, FIELD_VALUE},
+    {kLabelTcpPort, kTCPPORT, ID_TCPPORT, FIELD_VALUE},
+    {kLabelWsPort, kWSPORT, ID_WSPORT, FIELD_VALUE},
+    {kLabelBaud, kBAUD, ID_UART, FIELD_VALUE},
+    {kLabelAutoBaud, kAUTOBAUD, ID_UARTAUTOBAUD, FIELD_VALUE},
+    {kLabelTxPolicy, kTXPOLICY, ID_UARTTXPOLICY, FIELD_VALUE},
+    {kLabelFlowCtrl, kFLOWCTRL, ID_UARTFLOWCTRL, FIELD_VALUE},
+    {kLabelQThreshold, kQTHRESHOLD, ID_QTHRESHOLD, FIELD_VALUE},
+    {kLabelQTimeout, kQTIMEOUT, ID_QTIMEOUT, FIELD_VALUE},
+    {kLabelMaxClients, kMAXCLIENTS, ID_MAXCLIENTS, FIELD_VALUE},
+    {kLabelClientTimeout, kCLIENTTIMEOUT, ID_CLIENTTIMEOUT, FIELD_VALUE},
+    {kLabelCompress, kCOMPRESS, ID_UDPCOMPRESS, FIELD_VALUE},
+    {kLabelFec, kFEC, ID_UDPFEC, FIELD_VALUE},
+    {kLabelLinkHeader, kLINKHEADER, ID_UDPLINKHEADER, FIELD_VALUE},
+    {kLabelReliable, kRELIABLE, ID_UDPRELIABLE, FIELD_VALUE}};
+
+//---------------------------------------------------------------------------------
+static void handle_setup()
+{
+    PageWriter page(webServer, _page_stats[PAGE_SETUP]);
     setNoCacheHeaders();
-    webServer.send(200, FPSTR(kTEXTHTML), message);
+    page.begin(kTEXTHTML);
+    page.print_P(kHEADER);
+    page.print_P(PSTR(
+        "<h1>Setup</h1>\n"
+        "<form action='/setparameters' method='post'>\n"
+        "WiFi Mode:&nbsp;"
+        "<input type='radio' name='mode' value='0'"));
+    if (getWifiMode() == WIFI_MODE_AP)
+        page.print_P(PSTR(" checked"));
+    page.print_P(PSTR(">AccessPoint\n<input type='radio' name='mode' value='1'"));
+    if (getWifiMode() == WIFI_MODE_STA)
+        page.print_P(PSTR(" checked"));
+    page.print_P(PSTR(">Station<br>\n"));
+
+    for (UINT32 i = 0; i < sizeof(kSetupFields) / sizeof(kSetupFields[0]); i++)
+    {
+        const SetupField &field = kSetupFields[i];
+        page.print_P(field.label);
+        page.print_P(PSTR(":&nbsp;<input type='text' name='"));
+        page.print(field.name);
+        page.print_P(PSTR("' value='"));
+        if (field.format == FIELD_IP)
+            page.printIP(*((UINT32 *)Param_getAt(field.id)->value));
+        else
+            printParamValue(page, field.id);
+        page.print_P(PSTR("'><br>"));
+    }
 
-    // webServer.send(200,  "text/plain", "Hello world!");
+    //-- Rate limits as "msgid:Hz", empty for an unused slot
+    for (int i = 0; i < RATE_LIMIT_SLOTS; i++)
+    {
+        UINT32 rule = getRateLimit(i);
+        page.print_P(PSTR("Rate Limit "));
+        page.print((UINT32)(i + 1));
+        page.print_P(PSTR(" (msgid:Hz):&nbsp;<input type='text' name='"));
+        page.print(kRATELIMIT);
+        page.print((UINT32)(i + 1));
+        page.print_P(PSTR("' value='"));
+        if (rule)
+        {
+            page.print(RATE_LIMIT_MSGID(rule));
+            page.print_P(PSTR(":"));
+            page.print(RATE_LIMIT_HZ(rule));
+        }
+        page.print_P(PSTR("'><br>"));
+    }
+
+    page.print_P(PSTR("<input type='submit' value='Save'></form></body>"));
+    page.end();
 }
 
 //---------------------------------------------------------------------------------
-static void handle_setup()
+static void printTable(PageWriter &page, PGM_P title)
 {
-    String message = FPSTR(kHEADER);
-    message += "<h1>Setup</h1>\n";
-    message += "<form action='/setparameters' method='post'>\n";
+    page.print_P(PSTR("<p>"));
+    page.print_P(title);
+    page.print_P(PSTR("</p><table><col width=\"240\">\n"));
+}
 
-    message += "WiFi Mode:&nbsp;";
-    message += "<input type='radio' name='mode' value='0'";
-    if (getWifiMode() == WIFI_MODE_AP)
+//---------------------------------------------------------------------------------
+static void printRow(PageWriter &page, PGM_P label, UINT32 value)
+{
+    page.print_P(PSTR("<tr><td>"));
+    page.print_P(label);
+    page.print_P(PSTR("</td><td>"));
+    page.print(value);
+    page.print_P(PSTR("</td></tr>\n"));
+}
+
+//---------------------------------------------------------------------------------
+//-- One row per TCP or WebSocket connection: bytes sent / queued / trimmed
+static void printStreamClients(PageWriter &page, const TcpClientTable &conns)
+{
+    for (int i = 0; i < TCP_MAX_CLIENTS; i++)
     {
-        message += " checked";
+        if (!(conns.mask() & (1 << i)))
+            continue;
+        const TcpClient &client = conns.at(i);
+        page.print_P(PSTR("<tr><td>"));
+        page.printIP(client.ip);
+        page.print_P(PSTR(":"));
+        page.print((UINT32)client.port);
+        page.print_P(PSTR("</td><td>"));
+        page.print(client.bytes_out);
+        page.print_P(PSTR(" / "));
+        page.print(conns.queued(i));
+        page.print_P(PSTR(" / "));
+        page.print(client.trimmed);
+        page.print_P(PSTR("</td></tr>\n"));
     }
-    message += ">AccessPoint\n";
-    message += "<input type='radio' name='mode' value='1'";
-    if (getWifiMode() == WIFI_MODE_STA)
+}
+
+//---------------------------------------------------------------------------------
+//-- Priority class names, as on the status page and in /stats.json
+static const char kQosCritical[] PROGMEM = "critical";
+static const char kQosHigh[] PROGMEM = "high";
+static const char kQosNormal[] PROGMEM = "normal";
+static const char kQosBulk[] PROGMEM = "bulk";
+static PGM_P const kQosNames[QOS_CLASS_COUNT] = { kQosCritical, kQosHigh, kQosNormal, kQosBulk };
+
+//---------------------------------------------------------------------------------
+//-- Reliable uplink counters of the current clients
+static RelReceiverStats relTotals()
+{
+    RelReceiverStats total;
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < MAX_UDP_CLIENTS; i++)
     {
-        message += " checked";
-    }
-    message += ">Station<br>\n";
-
-    message += "AP SSID:&nbsp;";
-    message += "<input type='text' name='ssid' value='";
-    message += getWifiSsid();
-    message += "'><br>";
-
-    message += "AP Password (min len 8):&nbsp;";
-    message += "<input type='text' name='pwd' value='";
-    message += getWifiPassword();
-    message += "'><br>";
-
-    message += "WiFi Channel:&nbsp;";
-    message += "<input type='text' name='channel' value='";
-    message += getWifiChannel();
-    message += "'><br>";
-
-    message += "Station SSID:&nbsp;";
-    message += "<input type='text' name='ssidsta' value='";
-    message += getWifiStaSsid();
-    message += "'><br>";
-
-    message += "Station Password:&nbsp;";
-    message += "<input type='text' name='pwdsta' value='";
-    message += getWifiStaPassword();
-    message += "'><br>";
-
-    IPAddress IP;
-    message += "Station IP:&nbsp;";
-    message += "<input type='text' name='ipsta' value='";
-    IP = getWifiStaIP();
-    message += IP.toString();
-    message += "'><br>";
-
-    message += "Station Gateway:&nbsp;";
-    message += "<input type='text' name='gatewaysta' value='";
-    IP = getWifiStaGateway();
-    message += IP.toString();
-    message += "'><br>";
-
-    message += "Station Subnet:&nbsp;";
-    message += "<input type='text' name='subnetsta' value='";
-    IP = getWifiStaSubnet();
-    message += IP.toString();
-    message += "'><br>";
-
-    // message += "Host Port:&nbsp;";
-    // message += "<input type='text' name='hport' value='";
-    // message += getWifiUdpHport();
-    // message += "'><br>";
-
-    message += "Client Port:&nbsp;";
-    message += "<input type='text' name='cport' value='";
-    message += getWifiUdpCport();
-    message += "'><br>";
-
-    message += "Baudrate:&nbsp;";
-    message += "<input type='text' name='baud' value='";
-    message += getUartBaudRate();
-    message += "'><br>";
-
-    message += "<input type='submit' value='Save'>";
-    message += "</form>";
-    setNoCacheHeaders();
-    webServer.send(200, FPSTR(kTEXTHTML), message);
+        const RelReceiverStats &rs = _bridge->getRel(i).getStats();
+        total.received += rs.received;
+        total.duplicates += rs.duplicates;
+        total.skipped += rs.skipped;
+        total.restarts += rs.restarts;
+        total.acks += rs.acks;
+    }
+    return total;
 }
 
 //---------------------------------------------------------------------------------
@@ -398,22 +496,235 @@ static void handle_getStatus()
 {
     if (!flash)
         flash = ESP.getFreeSketchSpace();
-    // String message = FPSTR(kHEADER);
-    String message = kHEADER;
-    message += "<p>System Status</p><table>\n";
-    message += "<tr><td width=\"240\">Flash Size</td><td>";
-    message += ESP.getFlashChipRealSize();
-    message += "</td></tr>\n";
-    message += "<tr><td width=\"240\">Flash Available</td><td>";
-    message += flash;
-    message += "</td></tr>\n";
-    message += "<tr><td>RAM Left</td><td>";
-    message += String(ESP.getFreeHeap());
-    message += "</td></tr>\n";
-    message += "</table>";
-    message += "</body>";
+    PageWriter page(webServer, _page_stats[PAGE_STATUS]);
     setNoCacheHeaders();
-    webServer.send(200, FPSTR(kTEXTHTML), message);
+    page.begin(kTEXTHTML);
+    page.print_P(kHEADER);
+    printTable(page, PSTR("System Status"));
+    printRow(page, PSTR("Flash Size"), ESP.getFlashChipRealSize());
+    printRow(page, PSTR("Flash Available"), flash);
+    printRow(page, PSTR("RAM Left"), ESP.getFreeHeap());
+    page.print_P(PSTR("</table>"));
+
+    const BridgeStats &bs = _bridge->getStats();
+    const AutoBaud &autobaud = _bridge->getAutoBaud();
+    printTable(page, PSTR("UART"));
+    printRow(page, autobaud.active() ? PSTR("Baud Rate (searching)") : PSTR("Baud Rate"), _bridge->getBaudRate());
+    printRow(page, PSTR("Auto-baud Trials"), autobaud.trials());
+    printRow(page, PSTR("Framing Errors"), bs.rx_errors);
+    printRow(page, PSTR("RX Overruns"), bs.rx_overruns);
+    printRow(page, PSTR("TX Queued (bytes)"), _bridge->getTxPending());
+    page.print_P(PSTR("</table>"));
+
+    const QueueStats &qs = _bridge->getQueueStats();
+    printTable(page, PSTR("UDP Outgoing Queue"));
+    printRow(page, PSTR("Datagrams Sent"), qs.datagrams);
+    printRow(page, PSTR("Average Size (bytes)"), qs.datagrams ? qs.bytes / qs.datagrams : 0);
+    printRow(page, PSTR("Sent on Threshold"), qs.flushes[QUEUE_FLUSH_THRESHOLD]);
+    printRow(page, PSTR("Sent on Timeout"), qs.flushes[QUEUE_FLUSH_TIMEOUT]);
+    printRow(page, PSTR("Sent Full"), qs.flushes[QUEUE_FLUSH_FULL]);
+    printRow(page, PSTR("Sent on Route Change"), qs.flushes[QUEUE_FLUSH_ROUTE]);
+    printRow(page, PSTR("MAVLink Frames Sent"), qs.frames);
+    for (int i = 0; i < UAS_QUEUE_FILL_BUCKETS; i++)
+    {
+        page.print_P(PSTR("<tr><td>Filled up to "));
+        page.print((UINT32)((i + 1) * 100) / UAS_QUEUE_FILL_BUCKETS);
+        page.print_P(PSTR("%</td><td>"));
+        page.print(qs.fill[i]);
+        page.print_P(PSTR("</td></tr>\n"));
+    }
+    page.print_P(PSTR("</table>"));
+
+    const UdpClientTable &clients = _bridge->getClients();
+    printTable(page, PSTR("UDP Clients"));
+    for (int i = 0; i < MAX_UDP_CLIENTS; i++)
+    {
+        if (!(clients.mask() & (1 << i)))
+            continue;
+        const UdpClient &client = clients.at(i);
+        page.print_P(PSTR("<tr><td>"));
+        page.printIP(client.ip);
+        page.print_P(PSTR(":"));
+        page.print((UINT32)client.port);
+        page.print_P(PSTR("</td><td>"));
+        if (client.fixed)
+            page.print_P(PSTR("static"));
+        else
+        {
+            page.print((UINT32)(millis() - client.last_seen) / 1000);
+            page.print_P(PSTR(" s ago"));
+        }
+        page.print_P(PSTR("</td></tr>\n"));
+    }
+    printRow(page, PSTR("Rejected (table full)"), clients.rejected());
+    page.print_P(PSTR("</table>"));
+
+    const TcpClientTable &tcp = _bridge->getTcpClients();
+    printTable(page, tcp.enabled() ? PSTR("TCP Clients (bytes sent / queued / trimmed)") : PSTR("TCP Clients (off)"));
+    printStreamClients(page, tcp);
+    const TcpStats &ts = tcp.getStats();
+    printRow(page, PSTR("Accepted"), ts.accepted);
+    printRow(page, PSTR("Rejected (all slots taken)"), ts.rejected);
+    printRow(page, PSTR("Dropped (not reading)"), ts.stalled);
+    page.print_P(PSTR("</table>"));
+
+    const WsClientTable &ws = _bridge->getWsClients();
+    printTable(page, ws.enabled() ? PSTR("WebSocket Clients (bytes sent / queued / trimmed)") : PSTR("WebSocket Clients (off)"));
+    printStreamClients(page, ws.connections());
+    const WsStats &wss = ws.getStats();
+    printRow(page, PSTR("Upgraded"), wss.upgraded);
+    printRow(page, PSTR("Bad requests"), wss.bad_requests);
+    printRow(page, PSTR("Protocol errors"), wss.protocol_errors);
+    printRow(page, PSTR("Rejected (all slots taken)"), ws.connections().getStats().rejected);
+    printRow(page, PSTR("Dropped (not reading)"), ws.connections().getStats().stalled);
+    page.print_P(PSTR("</table>"));
+
+    if (_bridge->getLinkHeader())
+    {
+        printTable(page, PSTR("Uplink Quality (received / lost / reordered / duplicates / RTT us / latency us)"));
+        for (int i = 0; i < MAX_UDP_CLIENTS; i++)
+        {
+            const LinkPeer &link = _bridge->getLink(i);
+            if (!(clients.mask() & (1 << i)) || !link.active())
+                continue;
+            const LinkStats &ls = link.getStats();
+            page.print_P(PSTR("<tr><td>"));
+            page.printIP(clients.at(i).ip);
+            page.print_P(PSTR(":"));
+            page.print((UINT32)clients.at(i).port);
+            page.print_P(PSTR("</td><td>"));
+            page.print(ls.received);
+            page.print_P(PSTR(" / "));
+            page.print(ls.lost);
+            page.print_P(PSTR(" / "));
+            page.print(ls.reordered);
+            page.print_P(PSTR(" / "));
+            page.print(ls.duplicates);
+            page.print_P(PSTR(" / "));
+            page.print(ls.rtt_us);
+            page.print_P(PSTR(" / "));
+            page.print(ls.latency_us);
+            page.print_P(PSTR("</td></tr>\n"));
+        }
+        page.print_P(PSTR("</table>"));
+    }
+
+    const RelReceiverStats rel = relTotals();
+    printTable(page, _bridge->getReliable() ? PSTR("Reliable Uplink") : PSTR("Reliable Uplink (off)"));
+    printRow(page, PSTR("Datagrams"), rel.received);
+    printRow(page, PSTR("Retransmissions Dropped"), rel.duplicates);
+    printRow(page, PSTR("Given Up by the Proxy"), rel.skipped);
+    printRow(page, PSTR("ACKs Sent"), rel.acks);
+    page.print_P(PSTR("</table>"));
+
+    const RouteStats &rs = _bridge->getRouteStats();
+    printTable(page, PSTR("MAVLink Routing"));
+    printRow(page, PSTR("UAS Frames to Target Only"), rs.down_targeted);
+    printRow(page, PSTR("GCS Frames to Other Clients"), rs.up_to_clients);
+    printRow(page, PSTR("GCS Frames Kept off UART"), rs.up_not_serial);
+    page.print_P(PSTR("</table>"));
+
+    const CompressStats &cs = _bridge->getCompressStats();
+    printTable(page, _bridge->getCompress() ? PSTR("Downlink Compression") : PSTR("Downlink Compression (off)"));
+    printRow(page, PSTR("Datagrams"), cs.datagrams);
+    printRow(page, PSTR("Sent Uncompressed"), cs.stored);
+    printRow(page, PSTR("Size after Compression (%)"), cs.bytes_in ? (UINT32)(((UINT64)cs.bytes_out * 100) / cs.bytes_in) : 0);
+    printRow(page, PSTR("Average Time (us)"), cs.datagrams ? cs.time_us / cs.datagrams : 0);
+    printRow(page, PSTR("Longest Time (us)"), cs.max_us);
+    page.print_P(PSTR("</table>"));
+
+    const FecEncoder &fec = _bridge->getFec();
+    const FecStats &fs = fec.getStats();
+    printTable(page, fec.enabled() ? PSTR("Forward Error Correction") : PSTR("Forward Error Correction (off)"));
+    printRow(page, PSTR("Group Size"), fec.groupSize());
+    printRow(page, PSTR("Parity Datagrams"), fs.groups);
+    printRow(page, PSTR("Parity Skipped (congested)"), fs.skipped);
+    printRow(page, PSTR("Airtime Added (%)"), fs.data_bytes ? (UINT32)(((UINT64)fs.parity_bytes * 100) / fs.data_bytes) : 0);
+    page.print_P(PSTR("</table>"));
+
+    const QosQueue &qos = _bridge->getQos();
+    printTable(page, PSTR("Downlink Priority (frames / waited / dropped)"));
+    for (int i = 0; i < QOS_CLASS_COUNT; i++)
+    {
+        const QosClassStats &cs = qos.getStats(i);
+        page.print_P(PSTR("<tr><td>"));
+        page.print_P(kQosNames[i]);
+        page.print_P(PSTR("</td><td>"));
+        page.print(cs.frames);
+        page.print_P(PSTR(" / "));
+        page.print(cs.queued);
+        page.print_P(PSTR(" / "));
+        page.print(cs.dropped);
+        page.print_P(PSTR("</td></tr>\n"));
+    }
+    printRow(page, PSTR("Link Congested (datagrams)"), bs.congestions);
+    page.print_P(PSTR("</table>"));
+
+    const RateLimiter &limiter = _bridge->getRateLimiter();
+    printTable(page, PSTR("Rate Limits (passed / decimated)"));
+    for (int i = 0; i < RATE_LIMIT_SLOTS; i++)
+    {
+        const RateLimitSlot &rs = limiter.at(i);
+        if (!rs.rule)
+            continue;
+        page.print_P(PSTR("<tr><td>Message "));
+        page.print(RATE_LIMIT_MSGID(rs.rule));
+        page.print_P(PSTR(" at "));
+        page.print(RATE_LIMIT_HZ(rs.rule));
+        page.print_P(PSTR(" Hz</td><td>"));
+        page.print(rs.passed);
+        page.print_P(PSTR(" / "));
+        page.print(rs.decimated);
+        page.print_P(PSTR("</td></tr>\n"));
+    }
+    printRow(page, PSTR("Frames Decimated"), limiter.decimated());
+    page.print_P(PSTR("</table>"));
+
+    const PacketPoolStats &ps = packetPool.getStats();
+    printTable(page, PSTR("Packet Buffers"));
+    printRow(page, PSTR("Buffers"), PacketPool::size());
+    printRow(page, PSTR("In Use"), ps.in_use);
+    printRow(page, PSTR("Most in Use"), ps.high_water);
+    printRow(page, PSTR("Allocations"), ps.allocs);
+    printRow(page, PSTR("Pool Empty"), ps.exhausted);
+    printRow(page, PSTR("Bad Releases"), ps.bad_releases);
+    page.print_P(PSTR("</table>"));
+
+    printTable(page, PSTR("Scheduler (runs / missed deadlines / over budget / max us)"));
+    for (int i = 0; i < _scheduler->count(); i++)
+    {
+        const SchedulerTask &task = _scheduler->at(i);
+        page.print_P(PSTR("<tr><td>"));
+        page.print(task.name);
+        page.print_P(PSTR("</td><td>"));
+        page.print(task.runs);
+        page.print_P(PSTR(" / "));
+        page.print(task.missed);
+        page.print_P(PSTR(" / "));
+        page.print(task.overruns);
+        page.print_P(PSTR(" / "));
+        page.print(task.max_us);
+        page.print_P(PSTR("</td></tr>\n"));
+    }
+    page.print_P(PSTR("</table>"));
+
+    //-- Cost of the last request of each page (this one is still rendering)
+    printTable(page, PSTR("Page Rendering (time us / peak heap / bytes)"));
+    for (int i = 0; i < PAGE_COUNT; i++)
+    {
+        const PageStats &ps = _page_stats[i];
+        page.print_P(PSTR("<tr><td>"));
+        page.print_P(kPageNames[i]);
+        page.print_P(PSTR("</td><td>"));
+        page.print(ps.render_us);
+        page.print_P(PSTR(" / "));
+        page.print(ps.heap_used);
+        page.print_P(PSTR(" / "));
+        page.print(ps.bytes);
+        page.print_P(PSTR("</td></tr>\n"));
+    }
+    page.print_P(PSTR("</table></body>"));
+    page.end();
 }
 
 
@@ -440,6 +751,237 @@ void handle_getJSysInfo()
     webServer.send(200, "application/json", message);
 }
 
+//---------------------------------------------------------------------------------
+//-- "name":value followed by next (a comma, or the end of an object)
+static void printJson(PageWriter &page, PGM_P name, UINT32 value, const char *next = ",")
+{
+    page.print_P(PSTR("\""));
+    page.print_P(name);
+    page.print_P(PSTR("\":"));
+    page.print(value);
+    page.print(next);
+}
+
+//---------------------------------------------------------------------------------
+static void printDirection(PageWriter &page, PGM_P name, const DirectionStats &d)
+{
+    page.print_P(PSTR("\""));
+    page.print_P(name);
+    page.print_P(PSTR("\":{"));
+    printJson(page, PSTR("bytes_in"), d.bytes_in);
+    printJson(page, PSTR("bytes_out"), d.bytes_out);
+    printJson(page, PSTR("datagrams"), d.datagrams);
+    printJson(page, PSTR("frames"), d.frames);
+    printJson(page, PSTR("drop_no_client"), d.drops[DROP_NO_CLIENT]);
+    printJson(page, PSTR("drop_send"), d.drops[DROP_SEND_FAILED]);
+    printJson(page, PSTR("drop_serial_full"), d.drops[DROP_SERIAL_FULL]);
+    printJson(page, PSTR("drop_no_buffer"), d.drops[DROP_NO_BUFFER]);
+    printJson(page, PSTR("drop_qos"), d.drops[DROP_QOS]);
+    printJson(page, PSTR("drop_rate_limit"), d.drops[DROP_RATE_LIMIT], "},");
+}
+
+//---------------------------------------------------------------------------------
+//-- "clients":[...] of a TCP or WebSocket listener
+static void printJsonStreamClients(PageWriter &page, const TcpClientTable &conns)
+{
+    page.print_P(PSTR("\"clients\":["));
+    bool first = true;
+    for (int i = 0; i < TCP_MAX_CLIENTS; i++)
+    {
+        if (!(conns.mask() & (1 << i)))
+            continue;
+        const TcpClient &client = conns.at(i);
+        page.print_P(first ? PSTR("{") : PSTR(",{"));
+        first = false;
+        page.print_P(PSTR("\"ip\":\""));
+        page.printIP(client.ip);
+        page.print_P(PSTR("\","));
+        printJson(page, PSTR("port"), client.port);
+        printJson(page, PSTR("bytes_in"), client.bytes_in);
+        printJson(page, PSTR("bytes_out"), client.bytes_out);
+        printJson(page, PSTR("direct"), client.direct);
+        printJson(page, PSTR("queued"), conns.queued(i));
+        printJson(page, PSTR("queue_high_water"), client.queue_high_water);
+        printJson(page, PSTR("trimmed"), client.trimmed, "}");
+    }
+    page.print_P(PSTR("]"));
+}
+
+//---------------------------------------------------------------------------------
+//-- Bridge counters, to tell whether a telemetry gap came from the UART,
+//   the bridge or the WiFi link. Streamed, as the list keeps growing.
+static void handle_getJStats()
+{
+    const BridgeStats &stats = _bridge->getStats();
+    const UdpClientTable &clients = _bridge->getClients();
+    const PacketPoolStats &pool = packetPool.getStats();
+    const AutoBaud &autobaud = _bridge->getAutoBaud();
+    PageWriter page(webServer, _page_stats[PAGE_STATS]);
+    setNoCacheHeaders();
+    page.begin(kAPPJSON);
+    page.print_P(PSTR("{"));
+    printDirection(page, PSTR("serial_to_udp"), stats.serial_to_udp);
+    printDirection(page, PSTR("udp_to_serial"), stats.udp_to_serial);
+    printJson(page, PSTR("baud"), _bridge->getBaudRate());
+    printJson(page, PSTR("autobaud"), autobaud.active());
+    printJson(page, PSTR("autobaud_trials"), autobaud.trials());
+    printJson(page, PSTR("rx_errors"), stats.rx_errors);
+    printJson(page, PSTR("rx_overruns"), stats.rx_overruns);
+    printJson(page, PSTR("ring_high_water"), stats.ring_high_water);
+    printJson(page, PSTR("udp_high_water"), stats.udp_high_water);
+    printJson(page, PSTR("tx_pending"), _bridge->getTxPending());
+    printJson(page, PSTR("tx_high_water"), stats.tx_high_water);
+    printJson(page, PSTR("clients"), clients.count());
+    printJson(page, PSTR("clients_rejected"), clients.rejected());
+    const TcpClientTable &tcp = _bridge->getTcpClients();
+    const TcpStats &ts = tcp.getStats();
+    page.print_P(PSTR("\"tcp\":{"));
+    printJson(page, PSTR("enabled"), tcp.enabled());
+    printJson(page, PSTR("accepted"), ts.accepted);
+    printJson(page, PSTR("rejected"), ts.rejected);
+    printJson(page, PSTR("closed"), ts.closed);
+    printJson(page, PSTR("stalled"), ts.stalled);
+    printJsonStreamClients(page, tcp);
+    page.print_P(PSTR("},"));
+    const WsClientTable &ws = _bridge->getWsClients();
+    const WsStats &wss = ws.getStats();
+    const TcpStats &wcs = ws.connections().getStats();
+    page.print_P(PSTR("\"ws\":{"));
+    printJson(page, PSTR("enabled"), ws.enabled());
+    printJson(page, PSTR("accepted"), wcs.accepted);
+    printJson(page, PSTR("rejected"), wcs.rejected);
+    printJson(page, PSTR("upgraded"), wss.upgraded);
+    printJson(page, PSTR("bad_requests"), wss.bad_requests);
+    printJson(page, PSTR("protocol_errors"), wss.protocol_errors);
+    printJson(page, PSTR("closed"), wcs.closed + wss.closes);
+    printJson(page, PSTR("stalled"), wcs.stalled);
+    printJson(page, PSTR("pings"), wss.pings);
+    printJson(page, PSTR("messages_in"), wss.messages_in);
+    printJson(page, PSTR("messages_out"), wss.messages_out);
+    printJsonStreamClients(page, ws.connections());
+    page.print_P(PSTR("},"));
+    page.print_P(PSTR("\"pool\":{"));
+    printJson(page, PSTR("size"), PacketPool::size());
+    printJson(page, PSTR("in_use"), pool.in_use);
+    printJson(page, PSTR("high_water"), pool.high_water);
+    printJson(page, PSTR("allocs"), pool.allocs);
+    printJson(page, PSTR("exhausted"), pool.exhausted);
+    printJson(page, PSTR("bad_releases"), pool.bad_releases, "},");
+    printJson(page, PSTR("congestions"), stats.congestions);
+    const CompressStats &cs = _bridge->getCompressStats();
+    page.print_P(PSTR("\"compress\":{"));
+    printJson(page, PSTR("enabled"), _bridge->getCompress());
+    printJson(page, PSTR("datagrams"), cs.datagrams);
+    printJson(page, PSTR("stored"), cs.stored);
+    printJson(page, PSTR("bytes_in"), cs.bytes_in);
+    printJson(page, PSTR("bytes_out"), cs.bytes_out);
+    printJson(page, PSTR("time_us"), cs.time_us);
+    printJson(page, PSTR("max_us"), cs.max_us, "},");
+    const FecStats &fs = _bridge->getFec().getStats();
+    page.print_P(PSTR("\"fec\":{"));
+    printJson(page, PSTR("group"), _bridge->getFec().groupSize());
+    printJson(page, PSTR("groups"), fs.groups);
+    printJson(page, PSTR("skipped"), fs.skipped);
+    printJson(page, PSTR("data_bytes"), fs.data_bytes);
+    printJson(page, PSTR("parity_bytes"), fs.parity_bytes, "},");
+    printJson(page, PSTR("link_header"), _bridge->getLinkHeader());
+    page.print_P(PSTR("\"links\":["));
+    bool first = true;
+    for (int i = 0; i < MAX_UDP_CLIENTS; i++)
+    {
+        const LinkPeer &link = _bridge->getLink(i);
+        if (!(clients.mask() & (1 << i)) || !link.active())
+            continue;
+        const LinkStats &ls = link.getStats();
+        page.print_P(first ? PSTR("{") : PSTR(",{"));
+        first = false;
+        page.print_P(PSTR("\"ip\":\""));
+        page.printIP(clients.at(i).ip);
+        page.print_P(PSTR("\","));
+        printJson(page, PSTR("port"), clients.at(i).port);
+        printJson(page, PSTR("sent"), ls.sent);
+        printJson(page, PSTR("received"), ls.received);
+        printJson(page, PSTR("lost"), ls.lost);
+        printJson(page, PSTR("reordered"), ls.reordered);
+        printJson(page, PSTR("duplicates"), ls.duplicates);
+        printJson(page, PSTR("restarts"), ls.restarts);
+        printJson(page, PSTR("rtt_us"), ls.rtt_us);
+        printJson(page, PSTR("rtt_min_us"), ls.rtt_min_us);
+        printJson(page, PSTR("latency_us"), ls.latency_us);
+        printJson(page, PSTR("latency_max_us"), ls.latency_max_us, "}");
+    }
+    page.print_P(PSTR("],"));
+    const RelReceiverStats rel = relTotals();
+    page.print_P(PSTR("\"reliable\":{"));
+    printJson(page, PSTR("enabled"), _bridge->getReliable());
+    printJson(page, PSTR("received"), rel.received);
+    printJson(page, PSTR("duplicates"), rel.duplicates);
+    printJson(page, PSTR("skipped"), rel.skipped);
+    printJson(page, PSTR("restarts"), rel.restarts);
+    printJson(page, PSTR("acks"), rel.acks, "},");
+    const RateLimiter &limiter = _bridge->getRateLimiter();
+    printJson(page, PSTR("decimated"), limiter.decimated());
+    page.print_P(PSTR("\"rate_limits\":["));
+    first = true;
+    for (int i = 0; i < RATE_LIMIT_SLOTS; i++)
+    {
+        const RateLimitSlot &rs = limiter.at(i);
+        if (!rs.rule)
+            continue;
+        page.print_P(first ? PSTR("{") : PSTR(",{"));
+        first = false;
+        printJson(page, PSTR("msgid"), RATE_LIMIT_MSGID(rs.rule));
+        printJson(page, PSTR("hz"), RATE_LIMIT_HZ(rs.rule));
+        printJson(page, PSTR("passed"), rs.passed);
+        printJson(page, PSTR("decimated"), rs.decimated, "}");
+    }
+    page.print_P(PSTR("],"));
+    const QosQueue &qos = _bridge->getQos();
+    page.print_P(PSTR("\"qos\":{"));
+    printJson(page, PSTR("queued_bytes"), qos.queued());
+    for (int i = 0; i < QOS_CLASS_COUNT; i++)
+    {
+        const QosClassStats &cs = qos.getStats(i);
+        page.print_P(PSTR("\""));
+        page.print_P(kQosNames[i]);
+        page.print_P(PSTR("\":{"));
+        printJson(page, PSTR("frames"), cs.frames);
+        printJson(page, PSTR("queued"), cs.queued);
+        printJson(page, PSTR("dropped"), cs.dropped);
+        printJson(page, PSTR("drop_bytes"), cs.drop_bytes);
+        printJson(page, PSTR("high_water"), cs.high_water, i + 1 < QOS_CLASS_COUNT ? "}," : "}},");
+    }
+    printJson(page, PSTR("uptime"), (UINT32)millis(), "}");
+    page.end();
+}
+
+//---------------------------------------------------------------------------------
+//-- Scheduler task timings and missed deadlines; "?reset=1" starts over
+//   after reporting
+static void handle_getJScheduler()
+{
+    char message[768];
+    _scheduler->toJson(message, sizeof(message));
+    if (webServer.hasArg(kRESET) && webServer.arg(kRESET) == "1")
+        _scheduler->resetStats();
+    setNoCacheHeaders();
+    webServer.send(200, FPSTR(kAPPJSON), message);
+}
+
+#ifdef ENABLE_PROFILER
+//---------------------------------------------------------------------------------
+//-- loop() stage timings; "?reset=1" starts over after reporting
+static void handle_getJProfile()
+{
+    char message[1024];
+    Profile_toJson(message, sizeof(message));
+    if (webServer.hasArg(kRESET) && webServer.arg(kRESET) == "1")
+        Profile_reset();
+    setNoCacheHeaders();
+    webServer.send(200, FPSTR(kAPPJSON), message);
+}
+#endif
+
 
 //---------------------------------------------------------------------------------
 void handle_setParameters()
@@ -499,6 +1041,16 @@ void handle_setParameters()
         ok = true;
         setWifiUdpCport(webServer.arg(kCPORT).toInt());
     }
+    if (webServer.hasArg(kTCPPORT))
+    {
+        ok = true;
+        setWifiTcpPort(webServer.arg(kTCPPORT).toInt());
+    }
+    if (webServer.hasArg(kWSPORT))
+    {
+        ok = true;
+        setWifiWsPort(webServer.arg(kWSPORT).toInt());
+    }
     if (webServer.hasArg(kHPORT))
     {
         ok = true;
@@ -519,6 +1071,80 @@ void handle_setParameters()
         ok = true;
         setWifiMode(webServer.arg(kMODE).toInt());
     }
+    if (webServer.hasArg(kQTHRESHOLD))
+    {
+        ok = true;
+        setQueueThreshold(webServer.arg(kQTHRESHOLD).toInt());
+    }
+    if (webServer.hasArg(kQTIMEOUT))
+    {
+        ok = true;
+        setQueueTimeout(webServer.arg(kQTIMEOUT).toInt());
+    }
+    if (webServer.hasArg(kMAXCLIENTS))
+    {
+        ok = true;
+        setMaxClients(webServer.arg(kMAXCLIENTS).toInt());
+    }
+    if (webServer.hasArg(kCLIENTTIMEOUT))
+    {
+        ok = true;
+        setClientTimeout(webServer.arg(kCLIENTTIMEOUT).toInt());
+    }
+    if (webServer.hasArg(kSTATICHOST))
+    {
+        ok = true;
+        setStaticHostEnabled(webServer.arg(kSTATICHOST).toInt());
+    }
+    if (webServer.hasArg(kTXPOLICY))
+    {
+        ok = true;
+        setUartTxPolicy(webServer.arg(kTXPOLICY).toInt());
+    }
+    if (webServer.hasArg(kFLOWCTRL))
+    {
+        ok = true;
+        setUartFlowControl(webServer.arg(kFLOWCTRL).toInt());
+    }
+    if (webServer.hasArg(kAUTOBAUD))
+    {
+        ok = true;
+        setUartAutoBaud(webServer.arg(kAUTOBAUD).toInt());
+    }
+    if (webServer.hasArg(kCOMPRESS))
+    {
+        ok = true;
+        setUdpCompress(webServer.arg(kCOMPRESS).toInt());
+    }
+    if (webServer.hasArg(kFEC))
+    {
+        ok = true;
+        setUdpFec(webServer.arg(kFEC).toInt());
+    }
+    if (webServer.hasArg(kLINKHEADER))
+    {
+        ok = true;
+        setUdpLinkHeader(webServer.arg(kLINKHEADER).toInt());
+    }
+    if (webServer.hasArg(kRELIABLE))
+    {
+        ok = true;
+        setUdpReliable(webServer.arg(kRELIABLE).toInt());
+    }
+    //-- Rate limits apply right away, without a reboot
+    bool limits = false;
+    for (int i = 0; i < RATE_LIMIT_SLOTS; i++)
+    {
+        String name = kRATELIMIT;
+        name += (i + 1);
+        if (webServer.hasArg(name))
+        {
+            ok = limits = true;
+            setRateLimit(i, RateLimiter::parseRule(webServer.arg(name).c_str()));
+        }
+    }
+    if (limits)
+        _bridge->loadRateLimits();
     if (webServer.hasArg(kREBOOT))
     {
         ok = true;
@@ -576,8 +1202,10 @@ ESP8266Httpd::ESP8266Httpd()
 
 //---------------------------------------------------------------------------------
 //-- Initialize
-void ESP8266Httpd::begin()
+void ESP8266Httpd::begin(ESP8266Bridge *bridge, Scheduler *scheduler)
 {
+    _bridge = bridge;
+    _scheduler = scheduler;
     webServer.on("/", handle_root);
     webServer.on("/getparameters", handle_getParameters);
     webServer.on("/setparameters", handle_setParameters);
@@ -585,6 +1213,11 @@ void ESP8266Httpd::begin()
     webServer.on("/reboot", handle_reboot);
     webServer.on("/setup", handle_setup);
     webServer.on("/info.json", handle_getJSysInfo);
+    webServer.on("/stats.json", handle_getJStats);
+    webServer.on("/sched.json", handle_getJScheduler);
+#ifdef ENABLE_PROFILER
+    webServer.on("/profile.json", handle_getJProfile);
+#endif
     webServer.on("/update", handle_update);
     webServer.on("/upload", HTTP_POST, handle_upload, handle_upload_status);
     webServer.onNotFound(handle_notFound);
@@ -40,6 +40,8 @@
 
 #include "common.h"
 #include "parameters.h"
+#include "bridge.h"
+#include "scheduler.h"
 #include <ESP8266WiFi.h>
 #include <WiFiClient.h>
 #include <WiFiUdp.h>
@@ -47,7 +49,7 @@
 class ESP8266Httpd {
 public:
     ESP8266Httpd();
-    void    begin           ();
+    void    begin           (ESP8266Bridge *bridge, Scheduler *scheduler);
     void    checkUpdates    ();
 };
 
@@ -0,0 +1,188 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file link_header.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "link_header.h"
+
+//---------------------------------------------------------------------------------
+static inline void _put32(UINT8 *p, UINT32 v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+//---------------------------------------------------------------------------------
+static inline UINT32 _get32(const UINT8 *p)
+{
+    return p[0] | ((UINT32)p[1] << 8) | ((UINT32)p[2] << 16) | ((UINT32)p[3] << 24);
+}
+
+//---------------------------------------------------------------------------------
+//-- Earlier of two delays that include an unknown clock offset
+static inline UINT32 _earlier(UINT32 a, UINT32 b)
+{
+    return ((INT32)(a - b) < 0) ? a : b;
+}
+
+//---------------------------------------------------------------------------------
+LinkPeer::LinkPeer()
+{
+    reset();
+}
+
+//---------------------------------------------------------------------------------
+void LinkPeer::reset()
+{
+    _active = false;
+    _tx_seq = 0;
+    _rx_next = 0;
+    _rx_window = 0;
+    _peer_time = 0;
+    _peer_rx = 0;
+    _base_cur = 0;
+    _base_prev = 0;
+    _base_time = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+//---------------------------------------------------------------------------------
+bool LinkPeer::hasHeader(const UINT8 *in, UINT32 len)
+{
+    return len >= LINK_HEADER_LEN && in[0] == LINK_MAGIC;
+}
+
+//---------------------------------------------------------------------------------
+void LinkPeer::header(UINT8 *out, UINT32 now) const
+{
+    out[0] = LINK_MAGIC;
+    out[1] = _tx_seq & 0xFF;
+    out[2] = _tx_seq >> 8;
+    _put32(&out[3], now);
+    _put32(&out[7], _active ? _peer_time + (now - _peer_rx) : 0);
+}
+
+//---------------------------------------------------------------------------------
+bool LinkPeer::receive(const UINT8 *in, UINT32 len, UINT32 now)
+{
+    if (!hasHeader(in, len))
+        return false;
+    bool first = !_active;
+    _active = true;
+    UINT16 seq = in[1] | ((UINT16)in[2] << 8);
+    bool newest = true;
+    if (first || (INT16)(seq - _rx_next) > LINK_SEQ_RESYNC || (INT16)(seq - _rx_next) < -LINK_SEQ_RESYNC)
+    {
+        //-- First datagram, or the peer started over: nothing to compare with.
+        //   What came before was never counted as lost, so a late one from
+        //   there cannot be taken off it.
+        if (!first)
+            _stats.restarts++;
+        _rx_next = seq + 1;
+        _rx_window = 0xFFFFFFFF;
+        _base_cur = _base_prev = now - _get32(&in[3]);
+        _base_time = now;
+        _stats.received++;
+    }
+    else
+        newest = _sequence(seq);
+    _timing(_get32(&in[3]), _get32(&in[7]), now, newest);
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+bool LinkPeer::_sequence(UINT16 seq)
+{
+    INT16 ahead = (INT16)(seq - _rx_next);
+    if (ahead >= 0)
+    {
+        _stats.lost += ahead;
+        _rx_window = (ahead + 1 >= LINK_WINDOW) ? 1 : (_rx_window << (ahead + 1)) | 1;
+        _rx_next = seq + 1;
+        _stats.received++;
+        return true;
+    }
+    UINT16 back = -ahead - 1;
+    if (back >= LINK_WINDOW || (_rx_window & (1UL << back)))
+    {
+        _stats.duplicates++;
+        return false;
+    }
+    //-- Late, but not lost after all
+    _rx_window |= 1UL << back;
+    _stats.reordered++;
+    _stats.lost--;
+    _stats.received++;
+    return false;
+}
+
+//---------------------------------------------------------------------------------
+void LinkPeer::_timing(UINT32 time, UINT32 echo, UINT32 now, bool newest)
+{
+    //-- Only the newest datagram is echoed: a late or repeated one carries an
+    //   older time, and the echo would run backwards
+    if (newest)
+    {
+        _peer_time = time;
+        _peer_rx = now;
+    }
+    if (echo)
+    {
+        _stats.rtt_us = now - echo;
+        if (!_stats.rtt_min_us || _stats.rtt_us < _stats.rtt_min_us)
+            _stats.rtt_min_us = _stats.rtt_us;
+    }
+
+    //-- Delay relative to the fastest datagram of the last one or two
+    //   windows, so clock drift is followed
+    UINT32 delay = now - time;
+    if ((now - _base_time) >= LINK_BASE_WINDOW)
+    {
+        _base_prev = _base_cur;
+        _base_cur = delay;
+        _base_time = now;
+    }
+    _base_cur = _earlier(_base_cur, delay);
+    UINT32 latency = delay - _earlier(_base_cur, _base_prev) + _stats.rtt_min_us / 2;
+
+    if (_stats.received <= 1)
+        _stats.latency_us = latency;
+    else
+        _stats.latency_us += ((INT32)(latency - _stats.latency_us)) / 8;
+    if (latency > _stats.latency_max_us)
+        _stats.latency_max_us = latency;
+}
@@ -0,0 +1,113 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file link_header.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Optional header on every datagram between the bridge and the host side
+ * proxy (UDP_LINK_HEADER), in both directions, so each end can tell what
+ * the WiFi link lost, reordered or duplicated and how long it took. One
+ * LinkPeer per client on the bridge, one on the proxy.
+ *
+ * Header: LINK_MAGIC, sequence (16 bit), the sender's micros() and an echo
+ * of the peer's micros() from the last datagram received, advanced by how
+ * long it was held (0 until there was one); all little endian. The echo
+ * gives the round trip time. One-way latency is half of the smallest round
+ * trip plus how much longer than the fastest recent datagram this one
+ * took, as the two clocks are not synchronized.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef LINK_HEADER_H
+#define LINK_HEADER_H
+
+#include "common.h"
+
+#define LINK_MAGIC              0xEE    // Neither MAVLink, LZF_MAGIC nor FEC_MAGIC
+#define LINK_HEADER_LEN         11
+#define LINK_WINDOW             32      // Sequences a late datagram is still recognized in
+#define LINK_SEQ_RESYNC         512     // A bigger jump means the peer restarted
+#define LINK_BASE_WINDOW        10000000 // us the fastest delay is remembered for
+
+struct LinkStats
+{
+    UINT32  sent;
+    UINT32  received;
+    UINT32  lost;           // Sequences never seen (less those that turned up late)
+    UINT32  reordered;      // Arrived after a later sequence
+    UINT32  duplicates;     // Seen before, or too late (or from before the first) to tell
+    UINT32  restarts;       // The peer started its sequence over
+    UINT32  rtt_us;         // Last round trip
+    UINT32  rtt_min_us;
+    UINT32  latency_us;     // One-way, smoothed
+    UINT32  latency_max_us;
+};
+
+class LinkPeer
+{
+public:
+    LinkPeer();
+
+    void        reset       ();
+    //-- Whether the peer sends headers (and so expects them)
+    bool        active      () const { return _active; }
+    static bool hasHeader   (const UINT8 *in, UINT32 len);
+
+    //-- Writes the header of the next datagram to the peer, LINK_HEADER_LEN bytes
+    void        header      (UINT8 *out, UINT32 now) const;
+    //-- The datagram with that header went out
+    void        sent        () { _tx_seq++; _stats.sent++; }
+    //-- Takes the header at the start of a datagram from the peer; false if
+    //   there is none
+    bool        receive     (const UINT8 *in, UINT32 len, UINT32 now);
+
+    const LinkStats &getStats() const { return _stats; }
+
+private:
+    //-- True if seq is the newest datagram yet
+    bool        _sequence   (UINT16 seq);
+    void        _timing     (UINT32 time, UINT32 echo, UINT32 now, bool newest);
+
+private:
+    bool        _active;
+    UINT16      _tx_seq;
+    UINT16      _rx_next;   // Sequence expected next
+    UINT32      _rx_window; // Bit n: _rx_next - 1 - n was received
+    UINT32      _peer_time; // Its micros() in the newest datagram received
+    UINT32      _peer_rx;   // Our micros() when that arrived
+    UINT32      _base_cur;  // Fastest arrival minus send time, this window
+    UINT32      _base_prev; // and the one before
+    UINT32      _base_time; // micros() the window started
+    LinkStats   _stats;
+};
+
+#endif
@@ -0,0 +1,196 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file lzf.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Compressed stream: a control byte below 32 is followed by that many
+ * plus one literal bytes. Otherwise its top 3 bits are a match length
+ * minus 2 (7 means a length byte follows) and its low 5 bits, with the
+ * next byte, the distance back minus 1.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "lzf.h"
+
+#define LZF_HLOG                9
+#define LZF_MAX_LIT             (1 << 5)
+#define LZF_MAX_OFF             (1 << 13)
+#define LZF_MAX_REF             ((1 << 8) + (1 << 3))
+
+//-- Last position of each 3 byte sequence. Stale entries from an earlier
+//   buffer are harmless: a match is always checked byte by byte.
+static UINT16 _htab[1 << LZF_HLOG];
+
+//---------------------------------------------------------------------------------
+static inline UINT32 _hash(const UINT8 *p)
+{
+    UINT32 v = ((UINT32)p[0] << 16) | ((UINT32)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - LZF_HLOG);
+}
+
+//---------------------------------------------------------------------------------
+UINT32 Lzf_compress(const UINT8 *in, UINT32 in_len, UINT8 *out, UINT32 out_len)
+{
+    if (in_len == 0 || in_len > 0xFFFF || out_len < 2)
+        return 0;
+    UINT32 ip = 0;
+    UINT32 op = 1;      // out[0] is the control byte of the first literal run
+    UINT32 lit = 0;
+    while (ip + 2 < in_len)
+    {
+        UINT32 h = _hash(&in[ip]);
+        UINT32 ref = _htab[h];
+        _htab[h] = ip;
+        UINT32 off = ip - ref - 1;
+        if (ref < ip && off < LZF_MAX_OFF &&
+            in[ref] == in[ip] && in[ref + 1] == in[ip + 1] && in[ref + 2] == in[ip + 2])
+        {
+            //-- Close the literal run (or take back its unused control byte)
+            if (lit)
+                out[op - lit - 1] = lit - 1;
+            else
+                op--;
+            if (op + 3 > out_len)
+                return 0;
+            UINT32 len = 2;
+            UINT32 maxlen = in_len - ip - len;
+            if (maxlen > LZF_MAX_REF)
+                maxlen = LZF_MAX_REF;
+            do
+                len++;
+            while (len < maxlen && in[ref + len] == in[ip + len]);
+            ip += len;
+            len -= 2;
+            if (len < 7)
+                out[op++] = (off >> 8) + (len << 5);
+            else
+            {
+                out[op++] = (off >> 8) + (7 << 5);
+                out[op++] = len - 7;
+            }
+            out[op++] = off;
+            lit = 0;
+            op++;
+            continue;
+        }
+        if (op >= out_len)
+            return 0;
+        lit++;
+        out[op++] = in[ip++];
+        if (lit == LZF_MAX_LIT)
+        {
+            out[op - lit - 1] = lit - 1;
+            lit = 0;
+            op++;
+        }
+    }
+    while (ip < in_len)
+    {
+        if (op >= out_len)
+            return 0;
+        lit++;
+        out[op++] = in[ip++];
+        if (lit == LZF_MAX_LIT)
+        {
+            out[op - lit - 1] = lit - 1;
+            lit = 0;
+            op++;
+        }
+    }
+    if (lit)
+        out[op - lit - 1] = lit - 1;
+    else
+        op--;
+    return op;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 Lzf_decompress(const UINT8 *in, UINT32 in_len, UINT8 *out, UINT32 out_len)
+{
+    UINT32 ip = 0;
+    UINT32 op = 0;
+    while (ip < in_len)
+    {
+        UINT32 ctrl = in[ip++];
+        if (ctrl < LZF_MAX_LIT)
+        {
+            ctrl++;
+            if (ip + ctrl > in_len || op + ctrl > out_len)
+                return 0;
+            memcpy(&out[op], &in[ip], ctrl);
+            ip += ctrl;
+            op += ctrl;
+            continue;
+        }
+        UINT32 len = ctrl >> 5;
+        if (len == 7)
+        {
+            if (ip >= in_len)
+                return 0;
+            len += in[ip++];
+        }
+        if (ip >= in_len)
+            return 0;
+        UINT32 back = ((ctrl & 0x1F) << 8) + in[ip++] + 1;
+        len += 2;
+        if (back > op || op + len > out_len)
+            return 0;
+        //-- Byte by byte: the match may overlap what it produces
+        for (UINT32 i = 0; i < len; i++, op++)
+            out[op] = out[op - back];
+    }
+    return op;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 Lzf_unwrap(const UINT8 *in, UINT32 in_len, UINT8 *out, UINT32 out_len)
+{
+    if (in_len < LZF_HEADER_LEN || in[0] != LZF_MAGIC)
+        return 0;
+    UINT8 method = in[1];
+    UINT32 len = in[2] | (in[3] << 8);
+    if (len == 0 || len > out_len)
+        return 0;
+    in += LZF_HEADER_LEN;
+    in_len -= LZF_HEADER_LEN;
+    if (method == LZF_STORED)
+    {
+        if (in_len != len)
+            return 0;
+        memcpy(out, in, len);
+        return len;
+    }
+    if (method == LZF_COMPRESSED)
+        return Lzf_decompress(in, in_len, out, len) == len ? len : 0;
+    return 0;
+}
@@ -0,0 +1,67 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file lzf.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * LZF compression (the liblzf stream format) for downlink datagrams, and
+ * the envelope a compressed datagram travels in. The compressor needs a
+ * 1 KB hash table and no other memory; the decompressor is used by the
+ * host side proxy that hands plain MAVLink to the GCS.
+ *
+ * Envelope: LZF_MAGIC, method (LZF_STORED or LZF_COMPRESSED), original
+ * length (16 bit little endian), then the stored or compressed bytes.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef LZF_H
+#define LZF_H
+
+#include "common.h"
+
+#define LZF_MAGIC               0xEC    // Neither MAVLink v1 nor v2 start byte
+#define LZF_STORED              0x00
+#define LZF_COMPRESSED          0x01
+#define LZF_HEADER_LEN          4
+
+//-- Compresses in into out. Returns the compressed length, or 0 if it
+//   would not fit in out_len bytes (pass in_len - 1 to only accept a gain).
+UINT32 Lzf_compress(const UINT8 *in, UINT32 in_len, UINT8 *out, UINT32 out_len);
+
+//-- Returns the decompressed length, or 0 if in is corrupt or out is too small
+UINT32 Lzf_decompress(const UINT8 *in, UINT32 in_len, UINT8 *out, UINT32 out_len);
+
+//-- Contents of an envelope into out. Returns their length, or 0 if the
+//   datagram is not a valid envelope.
+UINT32 Lzf_unwrap(const UINT8 *in, UINT32 in_len, UINT8 *out, UINT32 out_len);
+
+#endif
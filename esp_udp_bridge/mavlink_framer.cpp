@@ -0,0 +1,312 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file mavlink_framer.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "mavlink_framer.h"
+
+struct CrcExtraEntry
+{
+    UINT16  msgid;
+    UINT8   extra;
+};
+
+//-- Sorted by message ID: everything routed (mavlink_router.cpp), classed
+//   (qos.cpp) or commonly rate limited, from the common dialect
+static const CrcExtraEntry kCrcExtra[] PROGMEM = {
+    {0, 50},        // HEARTBEAT
+    {1, 124},       // SYS_STATUS
+    {2, 137},       // SYSTEM_TIME
+    {4, 237},       // PING
+    {11, 89},       // SET_MODE
+    {20, 214},      // PARAM_REQUEST_READ
+    {21, 159},      // PARAM_REQUEST_LIST
+    {22, 220},      // PARAM_VALUE
+    {23, 168},      // PARAM_SET
+    {24, 24},       // GPS_RAW_INT
+    {27, 144},      // RAW_IMU
+    {30, 39},       // ATTITUDE
+    {33, 104},      // GLOBAL_POSITION_INT
+    {36, 222},      // SERVO_OUTPUT_RAW
+    {39, 254},      // MISSION_ITEM
+    {40, 230},      // MISSION_REQUEST
+    {41, 28},       // MISSION_SET_CURRENT
+    {42, 28},       // MISSION_CURRENT
+    {43, 132},      // MISSION_REQUEST_LIST
+    {44, 221},      // MISSION_COUNT
+    {45, 232},      // MISSION_CLEAR_ALL
+    {46, 11},       // MISSION_ITEM_REACHED
+    {47, 153},      // MISSION_ACK
+    {48, 41},       // SET_GPS_GLOBAL_ORIGIN
+    {51, 196},      // MISSION_REQUEST_INT
+    {65, 118},      // RC_CHANNELS
+    {66, 148},      // REQUEST_DATA_STREAM
+    {69, 243},      // MANUAL_CONTROL
+    {70, 124},      // RC_CHANNELS_OVERRIDE
+    {73, 38},       // MISSION_ITEM_INT
+    {74, 20},       // VFR_HUD
+    {75, 158},      // COMMAND_INT
+    {76, 152},      // COMMAND_LONG
+    {77, 143},      // COMMAND_ACK
+    {110, 84},      // FILE_TRANSFER_PROTOCOL
+    {117, 128},     // LOG_REQUEST_LIST
+    {119, 116},     // LOG_REQUEST_DATA
+    {121, 237},     // LOG_ERASE
+    {122, 203},     // LOG_REQUEST_END
+    {253, 83},      // STATUSTEXT
+};
+
+#define CRC_EXTRA_COUNT         (sizeof(kCrcExtra) / sizeof(kCrcExtra[0]))
+
+//---------------------------------------------------------------------------------
+static inline UINT16 _crcAccumulate(UINT16 crc, UINT8 data)
+{
+    UINT8 tmp = data ^ (UINT8)crc;
+    tmp ^= tmp << 4;
+    return (crc >> 8) ^ ((UINT16)tmp << 8) ^ ((UINT16)tmp << 3) ^ (tmp >> 4);
+}
+
+//---------------------------------------------------------------------------------
+UINT16 Mavlink_crc(const UINT8 *buffer, UINT32 len, UINT16 crc)
+{
+    for (UINT32 i = 0; i < len; i++)
+        crc = _crcAccumulate(crc, buffer[i]);
+    return crc;
+}
+
+//---------------------------------------------------------------------------------
+bool Mavlink_crcExtra(UINT32 msgid, UINT8 &extra)
+{
+    UINT32 lo = 0;
+    UINT32 hi = CRC_EXTRA_COUNT;
+    while (lo < hi)
+    {
+        UINT32 mid = (lo + hi) >> 1;
+        UINT16 id = pgm_read_word(&kCrcExtra[mid].msgid);
+        if (id == msgid)
+        {
+            extra = pgm_read_byte(&kCrcExtra[mid].extra);
+            return true;
+        }
+        if (id < msgid)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return false;
+}
+
+//---------------------------------------------------------------------------------
+MavlinkFramer::MavlinkFramer()
+{
+    reset();
+}
+
+//---------------------------------------------------------------------------------
+void MavlinkFramer::reset()
+{
+    _len = 0;
+    _expected = 0;
+    _skip = 0;
+    _out = _frame;
+    _out_len = 0;
+    _hdr = _frame;
+    _frame[0] = 0;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 MavlinkFramer::msgId() const
+{
+    if (isV2())
+        return (UINT32)_hdr[7] | ((UINT32)_hdr[8] << 8) | ((UINT32)_hdr[9] << 16);
+    return _hdr[5];
+}
+
+//---------------------------------------------------------------------------------
+//-- Length of the frame starting at header if it can be told from the first
+//   len bytes, 0 otherwise (too short, or flags we cannot delimit)
+UINT16 MavlinkFramer::_frameLength(const UINT8 *header, UINT32 len) const
+{
+    if (header[0] == MAVLINK_STX_V1)
+        return (len >= 2) ? MAVLINK_V1_HEADER_LEN + header[1] + MAVLINK_CHECKSUM_LEN : 0;
+    if (len < 3 || (header[2] & ~MAVLINK_IFLAG_SIGNED))
+        return 0;
+    UINT16 length = MAVLINK_V2_HEADER_LEN + header[1] + MAVLINK_CHECKSUM_LEN;
+    if (header[2] & MAVLINK_IFLAG_SIGNED)
+        length += MAVLINK_SIGNATURE_LEN;
+    return length;
+}
+
+//---------------------------------------------------------------------------------
+//-- The checksum covers the header after the start byte and the payload,
+//   then the message's CRC_EXTRA. Without a known CRC_EXTRA, solve for the
+//   one byte that would give the received checksum: the top byte of the
+//   result fixes the mixed byte (tmp ^ tmp >> 5), which then has to give
+//   the bottom byte as well.
+bool MavlinkFramer::_checkCrc(const UINT8 *frame, UINT16 length) const
+{
+    bool v2 = frame[0] == MAVLINK_STX_V2;
+    UINT16 end = (v2 ? MAVLINK_V2_HEADER_LEN : MAVLINK_V1_HEADER_LEN) + frame[1];
+    if (end + MAVLINK_CHECKSUM_LEN > length)
+        return false;
+    UINT16 crc = Mavlink_crc(&frame[1], end - 1);
+    UINT16 received = frame[end] | ((UINT16)frame[end + 1] << 8);
+    UINT32 msgid = v2 ? ((UINT32)frame[7] | ((UINT32)frame[8] << 8) | ((UINT32)frame[9] << 16)) : frame[5];
+    UINT8 extra;
+    if (Mavlink_crcExtra(msgid, extra))
+        return _crcAccumulate(crc, extra) == received;
+    UINT8 high = received >> 8;
+    UINT8 tmp = high ^ (high >> 5);
+    return (UINT16)((crc >> 8) ^ ((UINT16)tmp << 8) ^ ((UINT16)tmp << 3) ^ (tmp >> 4)) == received;
+}
+
+//---------------------------------------------------------------------------------
+//-- Looks at the bytes in _frame: true when they make a result (a frame, or
+//   raw bytes up to the next start byte), false when more are needed
+bool MavlinkFramer::_scan(UINT8 &result)
+{
+    if (_frame[0] != MAVLINK_STX_V1 && _frame[0] != MAVLINK_STX_V2)
+    {
+        _resync(result);
+        return true;
+    }
+    if (_expected == 0)
+    {
+        if (_len < (_frame[0] == MAVLINK_STX_V1 ? 2 : 3))
+            return false;
+        //-- Unknown incompatibility flags: not a frame we can delimit, so
+        //   let the bytes through as they are
+        _expected = _frameLength(_frame, _len);
+        if (_expected == 0)
+        {
+            _resync(result);
+            return true;
+        }
+    }
+    if (_len < _expected)
+        return false;
+    if (!_checkCrc(_frame, _expected))
+    {
+        _resync(result);
+        return true;
+    }
+    result = FRAMER_FRAME;
+    _out = _frame;
+    _out_len = _expected;
+    _hdr = _frame;
+    _skip = _expected;
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+//-- Not a frame after all: the start byte and anything up to the next one
+//   are raw, the rest is parsed again on the next call
+void MavlinkFramer::_resync(UINT8 &result)
+{
+    UINT16 k = 1;
+    while (k < _len && _frame[k] != MAVLINK_STX_V1 && _frame[k] != MAVLINK_STX_V2)
+        k++;
+    result = FRAMER_RAW;
+    _out = _frame;
+    _out_len = k;
+    _skip = k;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 MavlinkFramer::parse(const UINT8 *buffer, UINT32 len, UINT8 &result)
+{
+    UINT32 i = 0;
+    result = FRAMER_NONE;
+    _out_len = 0;
+
+    //-- Let go of what the last call handed out of _frame; bytes left behind
+    //   a bad checksum are parsed before any new input
+    if (_skip)
+    {
+        _len -= _skip;
+        memmove(_frame, &_frame[_skip], _len);
+        _skip = 0;
+        _expected = 0;
+        if (_len > 0 && _scan(result))
+            return 0;
+    }
+
+    if (len == 0)
+        return 0;
+
+    //-- Outside a frame: everything up to the next start byte is passed through
+    if (_len == 0)
+    {
+        while (i < len && i < 0xFFFF && buffer[i] != MAVLINK_STX_V1 && buffer[i] != MAVLINK_STX_V2)
+            i++;
+        if (i > 0)
+        {
+            result = FRAMER_RAW;
+            _out = buffer;
+            _out_len = i;
+            return i;
+        }
+
+        //-- A frame that is complete in the input is handed out in place
+        UINT16 length = _frameLength(buffer, len);
+        if (length != 0 && length <= len)
+        {
+            if (_checkCrc(buffer, length))
+            {
+                result = FRAMER_FRAME;
+                _out = buffer;
+                _out_len = length;
+                _hdr = buffer;
+                return length;
+            }
+            //-- A false start: raw up to the next start byte
+            i = 1;
+            while (i < len && i < 0xFFFF && buffer[i] != MAVLINK_STX_V1 && buffer[i] != MAVLINK_STX_V2)
+                i++;
+            result = FRAMER_RAW;
+            _out = buffer;
+            _out_len = i;
+            return i;
+        }
+    }
+
+    while (i < len)
+    {
+        _frame[_len++] = buffer[i++];
+        if (_scan(result))
+            return i;
+    }
+    return i;
+}
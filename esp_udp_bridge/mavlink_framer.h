@@ -0,0 +1,115 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file mavlink_framer.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Incremental MAVLink v1/v2 frame delimiter, so whole frames can be packed
+ * into datagrams and routed. A frame must pass its checksum: exactly, with
+ * the CRC_EXTRA of the messages the bridge acts on (kCrcExtra), and for any
+ * other message (or dialect) the checksum must be one that some CRC_EXTRA
+ * byte produces, which still turns away 255 in 256 false starts. On a bad
+ * checksum the start byte is passed on as raw data and parsing resumes
+ * with the byte after it.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef MAVLINK_FRAMER_H
+#define MAVLINK_FRAMER_H
+
+#include "common.h"
+
+#define MAVLINK_STX_V1              0xFE
+#define MAVLINK_STX_V2              0xFD
+#define MAVLINK_V1_HEADER_LEN       6
+#define MAVLINK_V2_HEADER_LEN       10
+#define MAVLINK_CHECKSUM_LEN        2
+#define MAVLINK_SIGNATURE_LEN       13
+#define MAVLINK_IFLAG_SIGNED        0x01
+#define MAVLINK_MAX_PAYLOAD_LEN     255
+#define MAVLINK_MAX_FRAME_LEN       (MAVLINK_V2_HEADER_LEN + MAVLINK_MAX_PAYLOAD_LEN + MAVLINK_CHECKSUM_LEN + MAVLINK_SIGNATURE_LEN)
+#define MAVLINK_CRC_INIT            0xFFFF
+
+//-- X.25 (CRC-16/MCRF4XX) as MAVLink uses it, continued from crc
+UINT16 Mavlink_crc(const UINT8 *buffer, UINT32 len, UINT16 crc = MAVLINK_CRC_INIT);
+//-- CRC_EXTRA of a message the bridge knows, false for any other
+bool   Mavlink_crcExtra(UINT32 msgid, UINT8 &extra);
+
+enum
+{
+    FRAMER_NONE = 0,    // Bytes consumed into a frame that is not complete yet
+    FRAMER_FRAME,       // A whole frame is available
+    FRAMER_RAW          // Bytes that are not part of any frame
+};
+
+class MavlinkFramer
+{
+public:
+    MavlinkFramer();
+
+    void        reset       ();
+    //-- Consumes bytes until a frame completes or a run of non-MAVLink bytes
+    //   ends. Returns the number of bytes consumed; result is one of FRAMER_*.
+    //   For FRAMER_FRAME and FRAMER_RAW the bytes are in data()/length(),
+    //   valid until the next call. Raw runs, and frames that arrive whole
+    //   in one input buffer, point into the input and are not copied.
+    UINT32      parse       (const UINT8 *buffer, UINT32 len, UINT8 &result);
+
+    const UINT8 *data       () const { return _out; }
+    UINT16      length      () const { return _out_len; }
+    bool        pending     () const { return _len > _skip; }
+
+    //-- Header fields of the last complete frame
+    bool        isV2        () const { return _hdr[0] == MAVLINK_STX_V2; }
+    UINT8       payloadLen  () const { return _hdr[1]; }
+    UINT8       sysId       () const { return isV2() ? _hdr[5] : _hdr[3]; }
+    UINT8       compId      () const { return isV2() ? _hdr[6] : _hdr[4]; }
+    UINT32      msgId       () const;
+    const UINT8 *payload    () const { return &_hdr[isV2() ? MAVLINK_V2_HEADER_LEN : MAVLINK_V1_HEADER_LEN]; }
+
+private:
+    UINT16      _frameLength(const UINT8 *header, UINT32 len) const;
+    bool        _checkCrc   (const UINT8 *frame, UINT16 length) const;
+    bool        _scan       (UINT8 &result);
+    void        _resync     (UINT8 &result);
+
+private:
+    UINT8       _frame[MAVLINK_MAX_FRAME_LEN];
+    const UINT8 *_hdr;      // Last complete frame, in _frame or in the input
+    UINT16      _len;       // Bytes of the current frame received so far
+    UINT16      _expected;  // Total frame length, 0 until known
+    UINT16      _skip;      // Bytes at the front of _frame handed out by the last call
+    const UINT8 *_out;
+    UINT16      _out_len;
+};
+
+#endif
@@ -0,0 +1,133 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file mavlink_router.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "mavlink_router.h"
+
+//-- Offset of target_system in the payload of messages that have one,
+//   sorted by message ID (from the MAVLink common message set)
+struct MavlinkTarget
+{
+    UINT16 msgid;
+    UINT8  offset;
+};
+
+static const MavlinkTarget kTargets[] PROGMEM = {
+    {5, 0},     // CHANGE_OPERATOR_CONTROL
+    {11, 4},    // SET_MODE
+    {20, 2},    // PARAM_REQUEST_READ
+    {21, 0},    // PARAM_REQUEST_LIST
+    {23, 4},    // PARAM_SET
+    {37, 4},    // MISSION_REQUEST_PARTIAL_LIST
+    {38, 4},    // MISSION_WRITE_PARTIAL_LIST
+    {39, 32},   // MISSION_ITEM
+    {40, 2},    // MISSION_REQUEST
+    {41, 2},    // MISSION_SET_CURRENT
+    {43, 0},    // MISSION_REQUEST_LIST
+    {44, 2},    // MISSION_COUNT
+    {45, 0},    // MISSION_CLEAR_ALL
+    {47, 0},    // MISSION_ACK
+    {48, 12},   // SET_GPS_GLOBAL_ORIGIN
+    {51, 2},    // MISSION_REQUEST_INT
+    {54, 24},   // SAFETY_SET_ALLOWED_AREA
+    {66, 2},    // REQUEST_DATA_STREAM
+    {69, 10},   // MANUAL_CONTROL
+    {70, 16},   // RC_CHANNELS_OVERRIDE
+    {73, 32},   // MISSION_ITEM_INT
+    {75, 30},   // COMMAND_INT
+    {76, 30},   // COMMAND_LONG
+    {77, 8},    // COMMAND_ACK (extension field)
+    {82, 36},   // SET_ATTITUDE_TARGET
+    {84, 50},   // SET_POSITION_TARGET_LOCAL_NED
+    {86, 50},   // SET_POSITION_TARGET_GLOBAL_INT
+    {110, 1},   // FILE_TRANSFER_PROTOCOL
+    {117, 4},   // LOG_REQUEST_LIST
+    {119, 10},  // LOG_REQUEST_DATA
+    {121, 0},   // LOG_ERASE
+    {122, 0},   // LOG_REQUEST_END
+    {123, 0},   // GPS_INJECT_DATA
+    {183, 0},   // AUTOPILOT_VERSION_REQUEST
+    {248, 3},   // V2_EXTENSION
+    {268, 2},   // LOGGING_ACK
+};
+
+#define MAVLINK_TARGET_COUNT    (sizeof(kTargets) / sizeof(kTargets[0]))
+
+//---------------------------------------------------------------------------------
+MavlinkRouter::MavlinkRouter()
+{
+    reset();
+}
+
+//---------------------------------------------------------------------------------
+void MavlinkRouter::reset()
+{
+    memset(_clients, 0, sizeof(_clients));
+    memset(_serial, 0, sizeof(_serial));
+}
+
+//---------------------------------------------------------------------------------
+void MavlinkRouter::forgetClients(UINT8 slots)
+{
+    UINT8 keep = ~slots;
+    for (UINT32 i = 0; i < MAVLINK_SYSID_COUNT; i++)
+        _clients[i] &= keep;
+}
+
+//---------------------------------------------------------------------------------
+UINT8 MavlinkRouter::targetSystem(const MavlinkFramer &framer)
+{
+    UINT32 msgid = framer.msgId();
+    UINT32 lo = 0;
+    UINT32 hi = MAVLINK_TARGET_COUNT;
+    while (lo < hi)
+    {
+        UINT32 mid = (lo + hi) >> 1;
+        UINT16 id = pgm_read_word(&kTargets[mid].msgid);
+        if (id == msgid)
+        {
+            UINT8 offset = pgm_read_byte(&kTargets[mid].offset);
+            //-- MAVLink 2 trims trailing zeros from the payload, a missing
+            //   target field is a zero (broadcast) target
+            return (offset < framer.payloadLen()) ? framer.payload()[offset] : 0;
+        }
+        if (id < msgid)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file mavlink_router.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Learns which MAVLink systems sit behind each UDP client and behind the
+ * UART, so messages addressed to one system (target_system) only go where
+ * that system is. Everything else is broadcast.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef MAVLINK_ROUTER_H
+#define MAVLINK_ROUTER_H
+
+#include "common.h"
+#include "mavlink_framer.h"
+
+#define MAVLINK_SYSID_COUNT     256
+
+class MavlinkRouter
+{
+public:
+    MavlinkRouter();
+
+    void        reset           ();
+
+    //-- Learning, from frames received on each side
+    void        learnClient     (UINT8 sysid, UINT8 slot) { _clients[sysid] |= 1 << slot; }
+    void        learnSerial     (UINT8 sysid) { _serial[sysid >> 3] |= 1 << (sysid & 7); }
+    //-- Forgets the systems behind freed client slots
+    void        forgetClients   (UINT8 slots);
+
+    //-- Client slots a system was seen behind (0 if none)
+    UINT8       clientsFor      (UINT8 sysid) const { return _clients[sysid]; }
+    bool        onSerial        (UINT8 sysid) const { return _serial[sysid >> 3] & (1 << (sysid & 7)); }
+
+    //-- target_system of the last frame of the framer, 0 for broadcast
+    //   messages and messages without a target
+    static UINT8 targetSystem   (const MavlinkFramer &framer);
+
+private:
+    UINT8       _clients[MAVLINK_SYSID_COUNT];      // Slot mask per system ID
+    UINT8       _serial[MAVLINK_SYSID_COUNT / 8];   // Systems seen on the UART
+};
+
+#endif
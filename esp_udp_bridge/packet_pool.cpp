@@ -0,0 +1,95 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file packet_pool.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "packet_pool.h"
+
+PacketPool packetPool;
+
+//---------------------------------------------------------------------------------
+PacketPool::PacketPool()
+    : _free(-1), _ready(false)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+//---------------------------------------------------------------------------------
+void PacketPool::begin()
+{
+    if (_ready)
+        return;
+    for (INT8 i = 0; i < PACKET_POOL_SIZE; i++)
+    {
+        _buffers[i].refs = 0;
+        _buffers[i].next = (i + 1 < PACKET_POOL_SIZE) ? i + 1 : -1;
+    }
+    _free = 0;
+    _ready = true;
+}
+
+//---------------------------------------------------------------------------------
+PacketBuffer *PacketPool::alloc()
+{
+    if (_free < 0)
+    {
+        _stats.exhausted++;
+        return NULL;
+    }
+    PacketBuffer *buffer = &_buffers[_free];
+    _free = buffer->next;
+    buffer->len = 0;
+    buffer->refs = 1;
+    _stats.allocs++;
+    if (++_stats.in_use > _stats.high_water)
+        _stats.high_water = _stats.in_use;
+    return buffer;
+}
+
+//---------------------------------------------------------------------------------
+void PacketPool::release(PacketBuffer *buffer)
+{
+    //-- Already free: putting it on the free list again would hand it out twice
+    if (buffer->refs == 0)
+    {
+        _stats.bad_releases++;
+        return;
+    }
+    if (--buffer->refs > 0)
+        return;
+    buffer->next = _free;
+    _free = (INT8)(buffer - _buffers);
+    _stats.in_use--;
+}
@@ -0,0 +1,96 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file packet_pool.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Fixed pool of datagram sized, reference counted buffers. The slab is
+ * static and the free list is built once by begin(); alloc() and release()
+ * are O(1). A buffer stays allocated until its last holder releases it, so
+ * the same bytes can be queued for several sends without copying them.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include "common.h"
+
+#if PACKET_POOL_SIZE > 127
+#error "PACKET_POOL_SIZE must fit the INT8 free list"
+#endif
+
+struct PacketBuffer
+{
+    UINT8   data[PACKET_BUFFER_SIZE];
+    UINT16  len;
+    UINT8   refs;
+    INT8    next;       // Free list link
+};
+
+struct PacketPoolStats
+{
+    UINT32  allocs;
+    UINT32  exhausted;  // alloc() calls that found no free buffer
+    UINT32  bad_releases; // release() of a buffer that was already free
+    UINT8   in_use;
+    UINT8   high_water; // Most buffers in use at once
+};
+
+class PacketPool
+{
+public:
+    PacketPool();
+
+    //-- Builds the free list; later calls do nothing
+    void            begin       ();
+    //-- An empty buffer with one reference, or NULL if none is free
+    PacketBuffer    *alloc      ();
+    //-- One more holder
+    void            retain      (PacketBuffer *buffer) { buffer->refs++; }
+    //-- Drops a reference, the last one puts the buffer back. Releasing a
+    //   free buffer is counted and otherwise ignored.
+    void            release     (PacketBuffer *buffer);
+
+    static UINT8    size        () { return PACKET_POOL_SIZE; }
+    const PacketPoolStats &getStats() const { return _stats; }
+
+private:
+    PacketBuffer    _buffers[PACKET_POOL_SIZE];
+    INT8            _free;      // First free buffer, -1 if none
+    bool            _ready;
+    PacketPoolStats _stats;
+};
+
+extern PacketPool packetPool;
+
+#endif
@@ -0,0 +1,150 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file page_writer.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "page_writer.h"
+
+//---------------------------------------------------------------------------------
+PageWriter::PageWriter(ESP8266WebServer &server, PageStats &stats)
+    : _server(server), _stats(stats), _len(0), _start(0), _heap_start(0), _heap_min(0)
+{
+}
+
+//---------------------------------------------------------------------------------
+void PageWriter::begin(const char *contentType)
+{
+    _start = micros();
+    _heap_start = _heap_min = ESP.getFreeHeap();
+    _stats.bytes = 0;
+    _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _server.send(200, contentType, "");
+}
+
+//---------------------------------------------------------------------------------
+void PageWriter::end()
+{
+    _flush();
+    _server.sendContent("");
+    _stats.render_us = micros() - _start;
+    _stats.heap_used = _heap_start - _heap_min;
+}
+
+//---------------------------------------------------------------------------------
+void PageWriter::print_P(PGM_P text)
+{
+    UINT32 len = strlen_P(text);
+    while (len > 0)
+    {
+        UINT32 n = PAGE_BUFFER_SIZE - _len;
+        if (n > len)
+            n = len;
+        memcpy_P(&_buffer[_len], text, n);
+        _len += n;
+        text += n;
+        len -= n;
+        if (_len == PAGE_BUFFER_SIZE)
+            _flush();
+    }
+}
+
+//---------------------------------------------------------------------------------
+void PageWriter::print(const char *text)
+{
+    _write(text, strlen(text));
+}
+
+//---------------------------------------------------------------------------------
+void PageWriter::print(UINT32 value)
+{
+    char str[12];
+    _write(str, snprintf(str, sizeof(str), "%u", value));
+}
+
+//---------------------------------------------------------------------------------
+void PageWriter::printIP(UINT32 ip)
+{
+    //-- Network byte order, first octet in the low byte
+    char str[16];
+    _write(str, snprintf(str, sizeof(str), "%u.%u.%u.%u",
+                         ip & 0xFF, (ip >> 8) & 0xFF, (ip >> 16) & 0xFF, ip >> 24));
+}
+
+//---------------------------------------------------------------------------------
+void PageWriter::printEscaped(const char *text, UINT32 maxLen)
+{
+    for (UINT32 i = 0; i < maxLen && text[i]; i++)
+    {
+        switch (text[i])
+        {
+        case '&':  print("&amp;");  break;
+        case '<':  print("&lt;");   break;
+        case '>':  print("&gt;");   break;
+        case '\'': print("&#39;");  break;
+        case '"':  print("&quot;"); break;
+        default:   _write(&text[i], 1); break;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------
+void PageWriter::_write(const char *data, UINT32 len)
+{
+    while (len > 0)
+    {
+        UINT32 n = PAGE_BUFFER_SIZE - _len;
+        if (n > len)
+            n = len;
+        memcpy(&_buffer[_len], data, n);
+        _len += n;
+        data += n;
+        len -= n;
+        if (_len == PAGE_BUFFER_SIZE)
+            _flush();
+    }
+}
+
+//---------------------------------------------------------------------------------
+void PageWriter::_flush()
+{
+    if (_len == 0)
+        return;
+    _server.sendContent(_buffer, _len);
+    _stats.bytes += _len;
+    _len = 0;
+    UINT32 heap = ESP.getFreeHeap();
+    if (heap < _heap_min)
+        _heap_min = heap;
+}
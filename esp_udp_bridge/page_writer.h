@@ -0,0 +1,88 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file page_writer.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Streams an HTML page with chunked transfer encoding through a small
+ * fixed buffer, so pages never have to be built on the heap.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef PAGE_WRITER_H
+#define PAGE_WRITER_H
+
+#include "common.h"
+#include <ESP8266WebServer.h>
+
+#define PAGE_BUFFER_SIZE        256
+
+//-- Render cost of the last request for each page
+struct PageStats
+{
+    UINT32 render_us;
+    UINT32 heap_used;   // Free heap at the start minus the lowest seen while sending
+    UINT32 bytes;
+};
+
+class PageWriter
+{
+public:
+    PageWriter(ESP8266WebServer &server, PageStats &stats);
+
+    //-- Sends the headers (set any extra ones before)
+    void        begin           (const char *contentType);
+    //-- Sends what is left and the terminating chunk
+    void        end             ();
+
+    void        print_P         (PGM_P text);
+    void        print           (const char *text);
+    void        print           (UINT32 value);
+    void        printIP         (UINT32 ip);
+    //-- At most maxLen characters, with HTML special characters escaped
+    void        printEscaped    (const char *text, UINT32 maxLen);
+
+private:
+    void        _write          (const char *data, UINT32 len);
+    void        _flush          ();
+
+private:
+    ESP8266WebServer &_server;
+    PageStats   &_stats;
+    char        _buffer[PAGE_BUFFER_SIZE];
+    UINT16      _len;
+    UINT32      _start;
+    UINT32      _heap_start;
+    UINT32      _heap_min;
+};
+
+#endif
@@ -38,7 +38,7 @@
 #include "parameters.h"
 
 //-- Reserved space for EEPROM persistence. A change in this will cause all values to reset to defaults.
-#define EEPROM_SPACE 32 * sizeof(UINT32)
+#define EEPROM_SPACE 48 * sizeof(UINT32)
 #define EEPROM_CRC_ADD EEPROM_SPACE - (sizeof(UINT32) << 1)
 
 static UINT32 _flash_left;
@@ -61,6 +61,21 @@ static UINT32 _wifi_ipsta;
 static UINT32 _wifi_gatewaysta;
 static UINT32 _wifi_subnetsta;
 static UINT32 _uart_baud_rate;
+static UINT16 _queue_threshold;
+static UINT16 _queue_timeout;
+static UINT8 _max_clients;
+static UINT16 _client_timeout;
+static UINT8 _static_host;
+static UINT8 _uart_tx_policy;
+static UINT8 _uart_flow_control;
+static UINT8 _uart_autobaud;
+static UINT32 _rate_limits[RATE_LIMIT_SLOTS];
+static UINT8 _udp_compress;
+static UINT8 _udp_fec;
+static UINT8 _udp_link_header;
+static UINT8 _udp_reliable;
+static UINT16 _wifi_tcp_port;
+static UINT16 _wifi_ws_port;
 
 String _wifi_ip_address;
 
@@ -95,7 +110,31 @@ struct ParameterFields Parameters[] = {
     {"WIFI_IPSTA", &_wifi_ipsta, ID_IPSTA, sizeof(UINT32), PARAM_TYPE_UINT32, false},
     {"WIFI_GATEWAYSTA", &_wifi_gatewaysta, ID_GATEWAYSTA, sizeof(UINT32), PARAM_TYPE_UINT32, false},
     {"WIFI_SUBNET_STA", &_wifi_subnetsta, ID_SUBNETSTA, sizeof(UINT32), PARAM_TYPE_UINT32, false},
-    {"UART_BAUDRATE", &_uart_baud_rate, ID_UART, sizeof(UINT32), PARAM_TYPE_UINT32, false}};
+    {"UART_BAUDRATE", &_uart_baud_rate, ID_UART, sizeof(UINT32), PARAM_TYPE_UINT32, false},
+    {"QUEUE_THRESHOLD", &_queue_threshold, ID_QTHRESHOLD, sizeof(UINT16), PARAM_TYPE_UINT16, false},
+    {"QUEUE_TIMEOUT", &_queue_timeout, ID_QTIMEOUT, sizeof(UINT16), PARAM_TYPE_UINT16, false},
+    {"MAX_CLIENTS", &_max_clients, ID_MAXCLIENTS, sizeof(UINT8), PARAM_TYPE_UINT8, false},
+    {"CLIENT_TIMEOUT", &_client_timeout, ID_CLIENTTIMEOUT, sizeof(UINT16), PARAM_TYPE_UINT16, false},
+    {"UDP_STATIC_HOST", &_static_host, ID_STATICHOST, sizeof(UINT8), PARAM_TYPE_UINT8, false},
+    {"UART_TX_POLICY", &_uart_tx_policy, ID_UARTTXPOLICY, sizeof(UINT8), PARAM_TYPE_UINT8, false},
+    {"UART_FLOW_CTRL", &_uart_flow_control, ID_UARTFLOWCTRL, sizeof(UINT8), PARAM_TYPE_UINT8, false},
+    {"UART_AUTOBAUD", &_uart_autobaud, ID_UARTAUTOBAUD, sizeof(UINT8), PARAM_TYPE_UINT8, false},
+    {"RATE_LIMIT1", &_rate_limits[0], ID_RATELIMIT1, sizeof(UINT32), PARAM_TYPE_UINT32, false},
+    {"RATE_LIMIT2", &_rate_limits[1], ID_RATELIMIT1 + 1, sizeof(UINT32), PARAM_TYPE_UINT32, false},
+    {"RATE_LIMIT3", &_rate_limits[2], ID_RATELIMIT1 + 2, sizeof(UINT32), PARAM_TYPE_UINT32, false},
+    {"RATE_LIMIT4", &_rate_limits[3], ID_RATELIMIT1 + 3, sizeof(UINT32), PARAM_TYPE_UINT32, false},
+    {"RATE_LIMIT5", &_rate_limits[4], ID_RATELIMIT1 + 4, sizeof(UINT32), PARAM_TYPE_UINT32, false},
+    {"RATE_LIMIT6", &_rate_limits[5], ID_RATELIMIT1 + 5, sizeof(UINT32), PARAM_TYPE_UINT32, false},
+    {"RATE_LIMIT7", &_rate_limits[6], ID_RATELIMIT1 + 6, sizeof(UINT32), PARAM_TYPE_UINT32, false},
+    {"RATE_LIMIT8", &_rate_limits[7], ID_RATELIMIT8, sizeof(UINT32), PARAM_TYPE_UINT32, false},
+    {"UDP_COMPRESS", &_udp_compress, ID_UDPCOMPRESS, sizeof(UINT8), PARAM_TYPE_UINT8, false},
+    {"UDP_FEC", &_udp_fec, ID_UDPFEC, sizeof(UINT8), PARAM_TYPE_UINT8, false},
+    {"UDP_LINK_HEADER", &_udp_link_header, ID_UDPLINKHEADER, sizeof(UINT8), PARAM_TYPE_UINT8, false},
+    {"UDP_RELIABLE", &_udp_reliable, ID_UDPRELIABLE, sizeof(UINT8), PARAM_TYPE_UINT8, false},
+    {"WIFI_TCP_PORT", &_wifi_tcp_port, ID_TCPPORT, sizeof(UINT16), PARAM_TYPE_UINT16, false},
+    {"WIFI_WS_PORT", &_wifi_ws_port, ID_WSPORT, sizeof(UINT16), PARAM_TYPE_UINT16, false}};
+
+static_assert(sizeof(Parameters) / sizeof(Parameters[0]) == ID_COUNT, "One Parameters[] entry per ID");
 
 //---------------------------------------------------------------------------------
 //-- Initialize
@@ -132,6 +171,29 @@ UINT32 getWifiStaIP() { return _wifi_ipsta; }
 UINT32 getWifiStaGateway() { return _wifi_gatewaysta; }
 UINT32 getWifiStaSubnet() { return _wifi_subnetsta; }
 UINT32 getUartBaudRate() { return _uart_baud_rate; }
+UINT16 getQueueThreshold() { return _queue_threshold; }
+UINT16 getQueueTimeout() { return _queue_timeout; }
+UINT8 getMaxClients() { return _max_clients; }
+UINT16 getClientTimeout() { return _client_timeout; }
+UINT8 getStaticHostEnabled() { return _static_host; }
+UINT8 getUartTxPolicy() { return _uart_tx_policy; }
+UINT8 getUartFlowControl() { return _uart_flow_control; }
+UINT8 getUartAutoBaud() { return _uart_autobaud; }
+UINT32 getRateLimit(UINT8 slot) { return slot < RATE_LIMIT_SLOTS ? _rate_limits[slot] : 0; }
+UINT8 getUdpCompress() { return _udp_compress; }
+UINT8 getUdpFec() { return _udp_fec; }
+UINT8 getUdpLinkHeader() { return _udp_link_header; }
+UINT8 getUdpReliable() { return _udp_reliable; }
+UINT16 getWifiTcpPort() { return _wifi_tcp_port; }
+UINT16 getWifiWsPort() { return _wifi_ws_port; }
+
+//---------------------------------------------------------------------------------
+//-- Cut to fit, and always terminated
+static void _copyString(char *dst, const char *src, UINT32 size)
+{
+    strncpy(dst, src, size - 1);
+    dst[size - 1] = 0;
+}
 
 //---------------------------------------------------------------------------------
 //-- Reset all to defaults
@@ -144,13 +206,28 @@ void resetToDefaults()
     _wifi_udp_hport = DEFAULT_UDP_HPORT;
     _wifi_udp_cport = DEFAULT_UDP_CPORT;
     _uart_baud_rate = DEFAULT_UART_SPEED;
+    _queue_threshold = DEFAULT_QUEUE_THRESHOLD;
+    _queue_timeout = DEFAULT_QUEUE_TIMEOUT;
+    _max_clients = DEFAULT_MAX_CLIENTS;
+    _client_timeout = DEFAULT_CLIENT_TIMEOUT;
+    _static_host = 0;
+    _uart_tx_policy = DEFAULT_UART_TX_POLICY;
+    _uart_flow_control = 0;
+    _uart_autobaud = 0;
+    memset(_rate_limits, 0, sizeof(_rate_limits));
+    _udp_compress = 0;
+    _udp_fec = 0;
+    _udp_link_header = 0;
+    _udp_reliable = 0;
+    _wifi_tcp_port = DEFAULT_TCP_PORT;
+    _wifi_ws_port = DEFAULT_WS_PORT;
     _wifi_ipsta = 0;
     _wifi_gatewaysta = 0;
     _wifi_subnetsta = 0;
-    strncpy(_wifi_ssid, kDEFAULT_SSID, sizeof(_wifi_ssid));
-    strncpy(_wifi_password, kDEFAULT_PASSWORD, sizeof(_wifi_password));
-    strncpy(_wifi_ssidsta, kDEFAULT_SSID, sizeof(_wifi_ssidsta));
-    strncpy(_wifi_passwordsta, kDEFAULT_PASSWORD, sizeof(_wifi_passwordsta));
+    _copyString(_wifi_ssid, kDEFAULT_SSID, sizeof(_wifi_ssid));
+    _copyString(_wifi_password, kDEFAULT_PASSWORD, sizeof(_wifi_password));
+    _copyString(_wifi_ssidsta, kDEFAULT_SSID, sizeof(_wifi_ssidsta));
+    _copyString(_wifi_passwordsta, kDEFAULT_PASSWORD, sizeof(_wifi_passwordsta));
     Eeprom_deinit();
 }
 
@@ -187,27 +264,25 @@ void setWifiUdpCport(UINT16 port)
 //---------------------------------------------------------------------------------
 void setWifiSsid(const char *ssid)
 {
-    strncpy(_wifi_ssid, ssid, sizeof(_wifi_ssid));
-        Serial.println("ssid change");
-    Serial.println(ssid);
+    _copyString(_wifi_ssid, ssid, sizeof(_wifi_ssid));
 }
 
 //---------------------------------------------------------------------------------
 void setWifiPassword(const char *pwd)
 {
-    strncpy(_wifi_password, pwd, sizeof(_wifi_password));
+    _copyString(_wifi_password, pwd, sizeof(_wifi_password));
 }
 
 //---------------------------------------------------------------------------------
 void setWifiStaSsid(const char *ssid)
 {
-    strncpy(_wifi_ssidsta, ssid, sizeof(_wifi_ssidsta));
+    _copyString(_wifi_ssidsta, ssid, sizeof(_wifi_ssidsta));
 }
 
 //---------------------------------------------------------------------------------
 void setWifiStaPassword(const char *pwd)
 {
-    strncpy(_wifi_passwordsta, pwd, sizeof(_wifi_passwordsta));
+    _copyString(_wifi_passwordsta, pwd, sizeof(_wifi_passwordsta));
 }
 
 //---------------------------------------------------------------------------------
@@ -234,6 +309,144 @@ void setUartBaudRate(UINT32 baud)
     _uart_baud_rate = baud;
 }
 
+//---------------------------------------------------------------------------------
+void setQueueThreshold(UINT16 bytes)
+{
+    _queue_threshold = bytes;
+}
+
+//---------------------------------------------------------------------------------
+void setQueueTimeout(UINT16 ms)
+{
+    _queue_timeout = ms;
+}
+
+//---------------------------------------------------------------------------------
+void setMaxClients(UINT8 clients)
+{
+    _max_clients = clients;
+}
+
+//---------------------------------------------------------------------------------
+void setClientTimeout(UINT16 seconds)
+{
+    _client_timeout = seconds;
+}
+
+//---------------------------------------------------------------------------------
+void setStaticHostEnabled(UINT8 enabled)
+{
+    _static_host = enabled;
+}
+
+//---------------------------------------------------------------------------------
+void setUartTxPolicy(UINT8 policy)
+{
+    _uart_tx_policy = policy;
+}
+
+//---------------------------------------------------------------------------------
+void setUartFlowControl(UINT8 enabled)
+{
+    _uart_flow_control = enabled;
+}
+
+//---------------------------------------------------------------------------------
+void setUartAutoBaud(UINT8 enabled)
+{
+    _uart_autobaud = enabled;
+}
+
+//---------------------------------------------------------------------------------
+//-- A RATE_LIMIT_RULE(), 0 clears the slot
+void setRateLimit(UINT8 slot, UINT32 rule)
+{
+    if (slot < RATE_LIMIT_SLOTS)
+        _rate_limits[slot] = RATE_LIMIT_HZ(rule) ? rule : 0;
+}
+
+//---------------------------------------------------------------------------------
+void setUdpCompress(UINT8 enabled)
+{
+    _udp_compress = enabled;
+}
+
+//---------------------------------------------------------------------------------
+void setUdpFec(UINT8 group_size)
+{
+    _udp_fec = group_size;
+}
+
+//---------------------------------------------------------------------------------
+void setUdpLinkHeader(UINT8 enabled)
+{
+    _udp_link_header = enabled;
+}
+
+//---------------------------------------------------------------------------------
+void setUdpReliable(UINT8 enabled)
+{
+    _udp_reliable = enabled;
+}
+
+//---------------------------------------------------------------------------------
+//-- 0 turns the TCP listener off
+void setWifiTcpPort(UINT16 port)
+{
+    _wifi_tcp_port = port;
+}
+
+//---------------------------------------------------------------------------------
+//-- 0 turns the WebSocket listener off
+void setWifiWsPort(UINT16 port)
+{
+    _wifi_ws_port = port;
+}
+
+//---------------------------------------------------------------------------------
+//-- A save only holds the parameters its firmware knew of (the rest keep
+//   their defaults), but its bytes may still be damaged, so replace
+//   anything out of range with its default
+static void _sanitizeParams()
+{
+    if (_queue_threshold == 0)
+        _queue_threshold = DEFAULT_QUEUE_THRESHOLD;
+    if (_queue_timeout > MAX_QUEUE_TIMEOUT)
+        _queue_timeout = DEFAULT_QUEUE_TIMEOUT;
+    if (_max_clients == 0 || _max_clients > MAX_UDP_CLIENTS)
+        _max_clients = DEFAULT_MAX_CLIENTS;
+    if (_client_timeout == 0 || _client_timeout > MAX_CLIENT_TIMEOUT)
+        _client_timeout = DEFAULT_CLIENT_TIMEOUT;
+    if (_static_host > 1)
+        _static_host = 0;
+    if (_uart_tx_policy > UART_TX_DROP_FRAME)
+        _uart_tx_policy = DEFAULT_UART_TX_POLICY;
+    if (_uart_flow_control > 1)
+        _uart_flow_control = 0;
+    if (_uart_autobaud > 1)
+        _uart_autobaud = 0;
+    if (_udp_compress > 1)
+        _udp_compress = 0;
+    if (_udp_fec > FEC_GROUP_MAX)
+        _udp_fec = 0;
+    if (_udp_link_header > 1)
+        _udp_link_header = 0;
+    if (_udp_reliable > 1)
+        _udp_reliable = 0;
+    if (_wifi_tcp_port == 0xFFFF)
+        _wifi_tcp_port = DEFAULT_TCP_PORT;
+    if (_wifi_ws_port == 0xFFFF)
+        _wifi_ws_port = DEFAULT_WS_PORT;
+    if (_uart_baud_rate == 0 || _uart_baud_rate > MAX_UART_SPEED)
+        _uart_baud_rate = DEFAULT_UART_SPEED;
+    //-- Unwritten EEPROM reads as 0xFF
+    for (int i = 0; i < RATE_LIMIT_SLOTS; i++)
+    {
+        if (_rate_limits[i] == 0xFFFFFFFF || !RATE_LIMIT_HZ(_rate_limits[i]))
+            _rate_limits[i] = 0;
+    }
+}
+
 // -------- EEPROM ----------------------------------
 
 //---------------------------------------------------------------------------------
@@ -248,11 +461,109 @@ void Eeprom_begin()
 }
 
 //---------------------------------------------------------------------------------
-//-- Saves all parameters to EEPROM
+//-- CRC-32 lookup table, 256 entries
+static const UINT32 crc_table[] PROGMEM = {
+    0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3,
+    0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988, 0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91,
+    0x1db71064, 0x6ab020f2, 0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
+    0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9, 0xfa0f3d63, 0x8d080df5,
+    0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172, 0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b,
+    0x35b5a8fa, 0x42b2986c, 0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
+    0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423, 0xcfba9599, 0xb8bda50f,
+    0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924, 0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d,
+    0x76dc4190, 0x01db7106, 0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
+    0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d, 0x91646c97, 0xe6635c01,
+    0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e, 0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457,
+    0x65b0d9c6, 0x12b7e950, 0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
+    0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7, 0xa4d1c46d, 0xd3d6f4fb,
+    0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0, 0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9,
+    0x5005713c, 0x270241aa, 0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
+    0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81, 0xb7bd5c3b, 0xc0ba6cad,
+    0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a, 0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683,
+    0xe3630b12, 0x94643b84, 0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
+    0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb, 0x196c3671, 0x6e6b06e7,
+    0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc, 0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5,
+    0xd6d6a3e8, 0xa1d1937e, 0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
+    0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55, 0x316e8eef, 0x4669be79,
+    0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236, 0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f,
+    0xc5ba3bbe, 0xb2bd0b28, 0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
+    0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f, 0x72076785, 0x05005713,
+    0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38, 0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21,
+    0x86d3d2d4, 0xf1d4e242, 0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
+    0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69, 0x616bffd3, 0x166ccf45,
+    0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2, 0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db,
+    0xaed16a4a, 0xd9d65adc, 0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
+    0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693, 0x54de5729, 0x23d967bf,
+    0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d};
+
+//---------------------------------------------------------------------------------
+//-- CRC of the first size bytes
+static UINT32 _eepromCrc(UINT32 size)
+{
+    UINT32 crc = 0;
+    for (int i = 0; i < (int)size; i++)
+    {
+        crc = pgm_read_dword(&crc_table[(crc ^ EEPROM.read(i)) & 0xff]) ^ (crc >> 8);
+    }
+    return crc;
+}
+
+//---------------------------------------------------------------------------------
+//-- Bytes taken by the first count parameters
+static UINT32 _paramBytes(int count)
+{
+    UINT32 size = 0;
+    for (int i = 0; i < count; i++)
+    {
+        size += Parameters[i].length;
+    }
+    return size;
+}
+
+//---------------------------------------------------------------------------------
+//-- How many parameters the EEPROM holds, 0 if it holds no valid save.
+//   Saves made before the layout word tell by their CRC: it only matches
+//   over the bytes of the parameters their firmware had.
+static int _savedParamCount()
+{
+    UINT32 layout = 0;
+    UINT32 saved_crc = 0;
+    EEPROM.get(EEPROM_LAYOUT_ADD, layout);
+    EEPROM.get(EEPROM_CRC_ADD, saved_crc);
+    if ((layout >> 16) == EEPROM_LAYOUT_TAG)
+    {
+        int count = layout & 0xFFFF;
+        if (count > ID_COUNT || _eepromCrc(_paramBytes(count)) != saved_crc)
+            return 0;
+        return count;
+    }
+    for (int count = ID_COUNT; count > 0; count--)
+    {
+        if (_eepromCrc(_paramBytes(count)) == saved_crc)
+            return count;
+    }
+    //-- From before the EEPROM space grew to EEPROM_SPACE
+    EEPROM.get(EEPROM_LEGACY_CRC_ADD, saved_crc);
+    for (int count = ID_COUNT; count > 0; count--)
+    {
+        UINT32 size = _paramBytes(count);
+        if (size <= EEPROM_LEGACY_CRC_ADD && _eepromCrc(size) == saved_crc)
+            return count;
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------------
+//-- Loads the parameters the EEPROM holds; the others are left as they are
 void Eeprom_loadAllParams()
 {
     UINT32 address = 0;
-    for (int i = 0; i < ID_COUNT; i++)
+    int count = _savedParamCount();
+#ifdef DEBUG
+    Serial1.print("Parameters in EEPROM: ");
+    Serial1.println(count);
+#endif
+    for (int i = 0; i < count; i++)
     {
         UINT8 *ptr = (UINT8 *)Parameters[i].value;
         for (int j = 0; j < Parameters[i].length; j++, address++, ptr++)
@@ -274,6 +585,7 @@ void Eeprom_loadAllParams()
 #ifdef DEBUG
     Serial1.println("");
 #endif
+    _sanitizeParams();
     //-- Version if hardwired
     _sw_version = ESP_UDP_BRIDGE_VERSION;
     _flash_left = ESP.getFreeSketchSpace();
@@ -308,7 +620,9 @@ void Eeprom_saveAllParams()
         }
     }
     UINT32 saved_crc = _getEepromCrc();
+    UINT32 layout = ((UINT32)EEPROM_LAYOUT_TAG << 16) | ID_COUNT;
     EEPROM.put(EEPROM_CRC_ADD, saved_crc);
+    EEPROM.put(EEPROM_LAYOUT_ADD, layout);
     EEPROM.commit();
 #ifdef DEBUG
     Serial1.print("Saved CRC: ");
@@ -355,17 +669,5 @@ void Eeprom_deinit()
 //-- Computes EEPROM CRC
 UINT32 _getEepromCrc()
 {
-    UINT32 crc = 0;
-    UINT32 size = 0;
-    //-- Get size of all parameter data
-    for (int i = 0; i < ID_COUNT; i++)
-    {
-        size += Parameters[i].length;
-    }
-    //-- Computer CRC
-    for (int i = 0; i < (int)size; i++)
-    {
-        crc = crc_table[(crc ^ EEPROM.read(i)) & 0xff] ^ (crc >> 8);
-    }
-    return crc;
+    return _eepromCrc(_paramBytes(ID_COUNT));
 }
@@ -0,0 +1,94 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file profiler.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+ProfileStage Profile_stages[PROFILE_COUNT];
+UINT32 Profile_shift = 6;
+UINT32 Profile_last;
+
+static const char *kStageNames[PROFILE_COUNT] = {
+    "loop",
+    "udp_read",
+    "serial_read",
+    "tcp_read",
+    "ws_read",
+    "httpd",
+    "housekeeping"
+};
+
+//---------------------------------------------------------------------------------
+//-- Initialize
+void Profile_begin()
+{
+    UINT32 mhz = ESP.getCpuFreqMHz();
+    Profile_shift = 0;
+    while ((2U << Profile_shift) <= mhz)
+        Profile_shift++;
+    Profile_reset();
+    Profile_last = ESP.getCycleCount();
+}
+
+//---------------------------------------------------------------------------------
+void Profile_reset()
+{
+    memset(Profile_stages, 0, sizeof(Profile_stages));
+}
+
+//---------------------------------------------------------------------------------
+int Profile_toJson(char *buffer, int size)
+{
+    UINT32 mhz = ESP.getCpuFreqMHz();
+    int len = snprintf(buffer, size, "{\"cpu_mhz\":%u,\"tick_ns\":%u", mhz, ((1U << Profile_shift) * 1000) / mhz);
+    for (int i = 0; i < PROFILE_COUNT && len < size; i++)
+    {
+        const ProfileStage &s = Profile_stages[i];
+        len += snprintf(&buffer[len], size - len, ",\"%s\":{\"count\":%u,\"avg_us\":%u,\"max_us\":%u,\"hist\":[",
+                        kStageNames[i], s.count, s.count ? (UINT32)(s.total / s.count) / mhz : 0, s.max / mhz);
+        for (int b = 0; b < PROFILE_BUCKETS && len < size; b++)
+            len += snprintf(&buffer[len], size - len, b ? ",%u" : "%u", s.hist[b]);
+        if (len < size)
+            len += snprintf(&buffer[len], size - len, "]}");
+    }
+    if (len < size)
+        len += snprintf(&buffer[len], size - len, "}");
+    return (len < size) ? len : size - 1;
+}
+
+#endif
@@ -0,0 +1,111 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file profiler.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Times each stage of loop() with the CPU cycle counter into log2
+ * histograms. Compiles to nothing unless ENABLE_PROFILER is defined.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "common.h"
+
+enum
+{
+    PROFILE_LOOP = 0,       // Start of one loop() to the next (includes the SDK)
+    PROFILE_UDP_READ,
+    PROFILE_SERIAL_READ,
+    PROFILE_TCP_READ,
+    PROFILE_WS_READ,
+    PROFILE_HTTPD,
+    PROFILE_HOUSEKEEPING,
+    PROFILE_COUNT
+};
+
+//-- Bucket i holds samples of [2^i, 2^(i+1)) ticks, the last one everything
+//   longer. A tick is the power of two of CPU cycles closest below a
+//   microsecond (64 cycles, 0.8us at 80MHz).
+#define PROFILE_BUCKETS         20
+
+#ifdef ENABLE_PROFILER
+
+struct ProfileStage
+{
+    UINT32 count;
+    UINT32 max;                     // Cycles
+    UINT64 total;                   // Cycles
+    UINT32 hist[PROFILE_BUCKETS];
+};
+
+extern ProfileStage Profile_stages[PROFILE_COUNT];
+extern UINT32 Profile_shift;       // log2 of the cycles in one tick
+extern UINT32 Profile_last;        // Cycle count at the start of the last loop()
+
+//---------------------------------------------------------------------------------
+//-- Records the cycles since start against a stage, returns the current count
+inline UINT32 Profile_record(UINT8 stage, UINT32 start)
+{
+    UINT32 now = ESP.getCycleCount();
+    UINT32 cycles = now - start;
+    ProfileStage &s = Profile_stages[stage];
+    s.count++;
+    s.total += cycles;
+    if (cycles > s.max)
+        s.max = cycles;
+    UINT32 ticks = cycles >> Profile_shift;
+    UINT32 bucket = ticks ? 31 - __builtin_clz(ticks) : 0;
+    s.hist[bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS - 1]++;
+    return now;
+}
+
+void Profile_begin();
+void Profile_reset();
+//-- Writes the stages as JSON, returns the length
+int Profile_toJson(char *buffer, int size);
+
+#define PROFILE_LOOP_START()    Profile_last = Profile_record(PROFILE_LOOP, Profile_last)
+#define PROFILE_START()         UINT32 _prof_t = ESP.getCycleCount()
+#define PROFILE_MARK(stage)     _prof_t = Profile_record(stage, _prof_t)
+
+#else
+
+#define PROFILE_LOOP_START()    do { } while(0)
+#define PROFILE_START()         do { } while(0)
+#define PROFILE_MARK(stage)     do { } while(0)
+
+#endif
+
+#endif
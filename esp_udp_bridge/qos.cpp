@@ -0,0 +1,191 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file qos.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "qos.h"
+
+#define QOS_RECORD_HEADER       4       // Length (2), client slots, frame flag
+
+//-- Classes of the messages that are not QOS_NORMAL, sorted by message ID
+//   (from the MAVLink common message set)
+struct QosEntry
+{
+    UINT16 msgid;
+    UINT8  cls;
+};
+
+static const QosEntry kClasses[] PROGMEM = {
+    {0, QOS_CRITICAL},      // HEARTBEAT
+    {1, QOS_HIGH},          // SYS_STATUS
+    {22, QOS_BULK},         // PARAM_VALUE
+    {24, QOS_HIGH},         // GPS_RAW_INT
+    {26, QOS_BULK},         // SCALED_IMU
+    {27, QOS_BULK},         // RAW_IMU
+    {28, QOS_BULK},         // RAW_PRESSURE
+    {29, QOS_BULK},         // SCALED_PRESSURE
+    {30, QOS_HIGH},         // ATTITUDE
+    {32, QOS_HIGH},         // LOCAL_POSITION_NED
+    {33, QOS_HIGH},         // GLOBAL_POSITION_INT
+    {35, QOS_BULK},         // RC_CHANNELS_RAW
+    {36, QOS_BULK},         // SERVO_OUTPUT_RAW
+    {42, QOS_HIGH},         // MISSION_CURRENT
+    {46, QOS_HIGH},         // MISSION_ITEM_REACHED
+    {47, QOS_HIGH},         // MISSION_ACK
+    {65, QOS_BULK},         // RC_CHANNELS
+    {74, QOS_HIGH},         // VFR_HUD
+    {77, QOS_CRITICAL},     // COMMAND_ACK
+    {105, QOS_BULK},        // HIGHRES_IMU
+    {110, QOS_BULK},        // FILE_TRANSFER_PROTOCOL
+    {116, QOS_BULK},        // SCALED_IMU2
+    {118, QOS_BULK},        // LOG_ENTRY
+    {120, QOS_BULK},        // LOG_DATA
+    {129, QOS_BULK},        // SCALED_IMU3
+    {130, QOS_BULK},        // DATA_TRANSMISSION_HANDSHAKE
+    {131, QOS_BULK},        // ENCAPSULATED_DATA
+    {147, QOS_HIGH},        // BATTERY_STATUS
+    {242, QOS_HIGH},        // HOME_POSITION
+    {245, QOS_HIGH},        // EXTENDED_SYS_STATE
+    {253, QOS_CRITICAL},    // STATUSTEXT
+};
+
+#define QOS_ENTRY_COUNT         (sizeof(kClasses) / sizeof(kClasses[0]))
+
+//---------------------------------------------------------------------------------
+QosQueue::QosQueue()
+{
+    reset();
+}
+
+//---------------------------------------------------------------------------------
+void QosQueue::reset()
+{
+    for (UINT8 i = 0; i < QOS_CLASS_COUNT; i++)
+        _rings[i].reset();
+    _queued = 0;
+    memset(_stats, 0, sizeof(_stats));
+}
+
+//---------------------------------------------------------------------------------
+UINT8 QosQueue::classify(UINT32 msgid)
+{
+    UINT8 cls = QOS_NORMAL;
+    UINT32 lo = 0;
+    UINT32 hi = QOS_ENTRY_COUNT;
+    while (lo < hi)
+    {
+        UINT32 mid = (lo + hi) >> 1;
+        UINT16 id = pgm_read_word(&kClasses[mid].msgid);
+        if (id == msgid)
+        {
+            cls = pgm_read_byte(&kClasses[mid].cls);
+            break;
+        }
+        if (id < msgid)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    _stats[cls].frames++;
+    return cls;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 QosQueue::push(UINT8 cls, const UINT8 *buffer, UINT16 len, UINT8 clients, bool frame)
+{
+    UINT32 need = QOS_RECORD_HEADER + len;
+    UINT32 dropped = 0;
+    if (len > QOS_RECORD_MAX)
+        return len;
+    //-- Room in the shared budget comes from the lowest class below this
+    //   one, room in this class's ring from its own oldest data
+    for (UINT8 victim = QOS_CLASS_COUNT - 1; _queued + need > QOS_QUEUE_LIMIT && victim > cls; )
+    {
+        if (_rings[victim].empty())
+            victim--;
+        else
+            dropped += _dropOldest(victim);
+    }
+    while ((_queued + need > QOS_QUEUE_LIMIT || _rings[cls].space() < need) && !_rings[cls].empty())
+        dropped += _dropOldest(cls);
+    if (_queued + need > QOS_QUEUE_LIMIT || _rings[cls].space() < need)
+    {
+        _stats[cls].dropped += frame;
+        _stats[cls].drop_bytes += len;
+        return dropped + len;
+    }
+
+    UINT8 header[QOS_RECORD_HEADER] = { (UINT8)(len & 0xFF), (UINT8)(len >> 8), clients, frame };
+    _rings[cls].write(header, sizeof(header));
+    _rings[cls].write(buffer, len);
+    _queued += need;
+    _stats[cls].queued += frame;
+    if (_rings[cls].used() > _stats[cls].high_water)
+        _stats[cls].high_water = _rings[cls].used();
+    return dropped;
+}
+
+//---------------------------------------------------------------------------------
+UINT16 QosQueue::pop(UINT8 *buffer, UINT8 &clients, bool &frame)
+{
+    for (UINT8 cls = 0; cls < QOS_CLASS_COUNT; cls++)
+    {
+        if (_rings[cls].empty())
+            continue;
+        UINT8 header[QOS_RECORD_HEADER];
+        _rings[cls].read(header, sizeof(header));
+        UINT16 len = header[0] | (header[1] << 8);
+        clients = header[2];
+        frame = header[3] != 0;
+        _rings[cls].read(buffer, len);
+        _queued -= QOS_RECORD_HEADER + len;
+        return len;
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------------
+//-- Drops the oldest record of a class, returns its length
+UINT32 QosQueue::_dropOldest(UINT8 cls)
+{
+    UINT8 header[QOS_RECORD_HEADER];
+    _rings[cls].read(header, sizeof(header));
+    UINT16 len = header[0] | (header[1] << 8);
+    _rings[cls].discard(len);
+    _queued -= QOS_RECORD_HEADER + len;
+    _stats[cls].dropped += header[3];
+    _stats[cls].drop_bytes += len;
+    return len;
+}
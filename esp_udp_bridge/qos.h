@@ -0,0 +1,108 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file qos.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Priority classes for the downlink. While the WiFi link keeps up, frames
+ * go straight into the outgoing datagram; once sends start failing they
+ * wait in one queue per class and leave highest class first, and when the
+ * queues are full the lowest classes are dropped first. Message IDs map to
+ * classes through a table; unlisted messages are QOS_NORMAL.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef QOS_H
+#define QOS_H
+
+#include "common.h"
+#include "mavlink_framer.h"
+#include "spsc_ring.h"
+
+#define QOS_QUEUE_SIZE          1024    // Per class, must be a power of two
+#define QOS_QUEUE_LIMIT         2048    // Bytes waiting across all classes
+#define QOS_RECORD_MAX          MAVLINK_MAX_FRAME_LEN
+#define QOS_BACKOFF             5       // ms between send attempts while the link is congested
+#define QOS_RETRIES             20      // Attempts at a datagram before it is dropped
+
+enum
+{
+    QOS_CRITICAL = 0,       // HEARTBEAT, COMMAND_ACK, STATUSTEXT
+    QOS_HIGH,               // Position, attitude, system and mission state
+    QOS_NORMAL,             // Everything else, and bytes that are not MAVLink
+    QOS_BULK,               // Parameter, log and file transfers, raw sensors
+    QOS_CLASS_COUNT
+};
+
+struct QosClassStats
+{
+    UINT32  frames;         // Frames classified
+    UINT32  queued;         // Frames that had to wait for the link
+    UINT32  dropped;        // Frames dropped to make room
+    UINT32  drop_bytes;
+    UINT16  high_water;     // Most bytes waiting
+};
+
+class QosQueue
+{
+public:
+    QosQueue();
+
+    void        reset       ();
+
+    //-- Class of a message ID (counted in the class statistics)
+    UINT8       classify    (UINT32 msgid);
+
+    bool        empty       () const { return _queued == 0; }
+    UINT16      queued      () const { return _queued; }
+
+    //-- Queues up to QOS_RECORD_MAX bytes for the given client slots. The
+    //   oldest waiting data of the lowest class below cls makes room first,
+    //   then cls's own. Returns the bytes dropped (the new ones if nothing
+    //   could make room).
+    UINT32      push        (UINT8 cls, const UINT8 *buffer, UINT16 len, UINT8 clients, bool frame);
+    //-- Oldest record of the highest waiting class into buffer (at least
+    //   QOS_RECORD_MAX bytes), 0 if nothing waits
+    UINT16      pop         (UINT8 *buffer, UINT8 &clients, bool &frame);
+
+    const QosClassStats &getStats(UINT8 cls) const { return _stats[cls]; }
+
+private:
+    UINT32      _dropOldest (UINT8 cls);
+
+private:
+    SpscRing<QOS_QUEUE_SIZE> _rings[QOS_CLASS_COUNT];
+    UINT16      _queued;    // Record bytes in all rings
+    QosClassStats _stats[QOS_CLASS_COUNT];
+};
+
+#endif
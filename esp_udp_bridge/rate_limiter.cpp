@@ -0,0 +1,137 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file rate_limiter.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "rate_limiter.h"
+
+#define RATE_LIMIT_TOKEN        1000    // One frame, in thousandths
+#define RATE_LIMIT_FULL         (RATE_LIMIT_BURST * RATE_LIMIT_TOKEN)
+
+//---------------------------------------------------------------------------------
+RateLimiter::RateLimiter()
+{
+    reset();
+}
+
+//---------------------------------------------------------------------------------
+void RateLimiter::reset()
+{
+    memset(_index, 0, sizeof(_index));
+    memset(_slots, 0, sizeof(_slots));
+    _decimated = 0;
+}
+
+//---------------------------------------------------------------------------------
+void RateLimiter::setRule(UINT8 slot, UINT32 rule)
+{
+    if (slot >= RATE_LIMIT_SLOTS)
+        return;
+    if (!RATE_LIMIT_HZ(rule))
+        rule = 0;
+    RateLimitSlot &s = _slots[slot];
+    if (s.rule != rule)
+    {
+        memset(&s, 0, sizeof(s));
+        s.rule = rule;
+        s.tokens = RATE_LIMIT_FULL;
+    }
+    //-- Rebuild the index; with duplicate rules the last slot wins
+    memset(_index, 0, sizeof(_index));
+    for (UINT8 i = 0; i < RATE_LIMIT_SLOTS; i++)
+    {
+        UINT32 msgid = RATE_LIMIT_MSGID(_slots[i].rule);
+        if (!_slots[i].rule || msgid >= RATE_LIMIT_INDEX_SIZE)
+            continue;
+        UINT8 shift = (msgid & 1) << 2;
+        _index[msgid >> 1] = (_index[msgid >> 1] & ~(0x0F << shift)) | ((i + 1) << shift);
+    }
+}
+
+//---------------------------------------------------------------------------------
+INT8 RateLimiter::_slotFor(UINT32 msgid) const
+{
+    if (msgid < RATE_LIMIT_INDEX_SIZE)
+        return (INT8)((_index[msgid >> 1] >> ((msgid & 1) << 2)) & 0x0F) - 1;
+    for (INT8 i = RATE_LIMIT_SLOTS - 1; i >= 0; i--)
+    {
+        if (_slots[i].rule && RATE_LIMIT_MSGID(_slots[i].rule) == msgid)
+            return i;
+    }
+    return -1;
+}
+
+//---------------------------------------------------------------------------------
+bool RateLimiter::allow(UINT32 msgid, UINT32 now)
+{
+    INT8 slot = _slotFor(msgid);
+    if (slot < 0)
+        return true;
+    RateLimitSlot &s = _slots[slot];
+    //-- Refill at the configured rate (ms * Hz = thousandths of a frame). A
+    //   rule is at least 1 Hz, so RATE_LIMIT_FULL ms fill the bucket.
+    UINT32 elapsed = now - s.last;
+    s.last = now;
+    if (elapsed >= RATE_LIMIT_FULL)
+        s.tokens = RATE_LIMIT_FULL;
+    else
+    {
+        UINT32 tokens = s.tokens + elapsed * RATE_LIMIT_HZ(s.rule);
+        s.tokens = (tokens > RATE_LIMIT_FULL) ? RATE_LIMIT_FULL : tokens;
+    }
+    if (s.tokens < RATE_LIMIT_TOKEN)
+    {
+        s.decimated++;
+        _decimated++;
+        return false;
+    }
+    s.tokens -= RATE_LIMIT_TOKEN;
+    s.passed++;
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 RateLimiter::parseRule(const char *text)
+{
+    char *end;
+    UINT32 msgid = strtoul(text, &end, 10);
+    if (end == text || *end != ':' || msgid > RATE_LIMIT_MSGID(0xFFFFFFFF))
+        return 0;
+    text = end + 1;
+    UINT32 hz = strtoul(text, &end, 10);
+    if (end == text || *end || hz == 0 || hz > 255)
+        return 0;
+    return RATE_LIMIT_RULE(msgid, hz);
+}
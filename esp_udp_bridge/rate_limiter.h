@@ -0,0 +1,93 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file rate_limiter.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Token bucket per MAVLink message ID, for autopilots that stream some
+ * messages faster than the WiFi link (or the GCS) needs them. Up to
+ * RATE_LIMIT_SLOTS rules come from the RATE_LIMIT parameters; frames of
+ * other messages always pass. The rule of a message is found through a
+ * table indexed by message ID, half a byte per ID.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include "common.h"
+
+#define RATE_LIMIT_INDEX_SIZE   512     // Message IDs found by index, higher ones by search
+#define RATE_LIMIT_BURST        2       // Frames that may pass back to back
+
+#if RATE_LIMIT_SLOTS > 15
+#error "RATE_LIMIT_SLOTS must fit the 4 bit index"
+#endif
+
+struct RateLimitSlot
+{
+    UINT32  rule;           // RATE_LIMIT_RULE(), 0 if unused
+    UINT32  last;           // millis() of the last refill
+    UINT16  tokens;         // Thousandths of a frame
+    UINT32  passed;
+    UINT32  decimated;
+};
+
+class RateLimiter
+{
+public:
+    RateLimiter();
+
+    //-- Removes all rules and clears the counters
+    void        reset       ();
+    //-- Sets (or with 0, clears) the rule of a slot
+    void        setRule     (UINT8 slot, UINT32 rule);
+
+    //-- Whether a frame of msgid may pass now; frames that may not are counted
+    bool        allow       (UINT32 msgid, UINT32 now);
+
+    const RateLimitSlot &at (UINT8 slot) const { return _slots[slot]; }
+    UINT32      decimated   () const { return _decimated; }
+
+    //-- "msgid:Hz" to a rule, 0 if empty or not valid
+    static UINT32 parseRule (const char *text);
+
+private:
+    INT8        _slotFor    (UINT32 msgid) const;
+
+private:
+    UINT8       _index[RATE_LIMIT_INDEX_SIZE / 2]; // Slot + 1 per message ID, 0 for none
+    RateLimitSlot _slots[RATE_LIMIT_SLOTS];
+    UINT32      _decimated;
+};
+
+#endif
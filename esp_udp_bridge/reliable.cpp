@@ -0,0 +1,270 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file reliable.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "reliable.h"
+
+//---------------------------------------------------------------------------------
+RelReceiver::RelReceiver()
+{
+    reset();
+}
+
+//---------------------------------------------------------------------------------
+void RelReceiver::reset()
+{
+    _active = false;
+    _next = 0;
+    _mask = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+//---------------------------------------------------------------------------------
+bool RelReceiver::isData(const UINT8 *in, UINT32 len)
+{
+    return len >= REL_HEADER_LEN && in[0] == REL_MAGIC && in[1] == REL_DATA;
+}
+
+//---------------------------------------------------------------------------------
+bool RelReceiver::receive(const UINT8 *in)
+{
+    UINT16 seq  = in[2] | ((UINT16)in[3] << 8);
+    UINT16 base = in[4] | ((UINT16)in[5] << 8);
+    //-- The proxy holds at most REL_WINDOW below what it sends, and nothing
+    //   below what was acknowledged: a base further back is a new proxy, or
+    //   a late original of a datagram that was already retransmitted. Only
+    //   a sequence far from ours tells the two apart.
+    INT16 lag = (INT16)(_next - base);
+    INT16 jump = (INT16)(seq - _next);
+    bool far = jump > REL_SEQ_RESYNC || jump < -REL_SEQ_RESYNC;
+    if (!_active || (far && (lag > REL_WINDOW || lag < -REL_SEQ_RESYNC)))
+    {
+        if (_active)
+            _stats.restarts++;
+        _active = true;
+        _next = base;
+        _mask = 0;
+    }
+    //-- The proxy gave up on these
+    while ((INT16)(base - _next) > 0)
+    {
+        _slide();
+        _stats.skipped++;
+    }
+    INT16 ahead = (INT16)(seq - _next);
+    if (ahead < 0)
+    {
+        _stats.duplicates++;
+        return false;
+    }
+    while (ahead > REL_WINDOW)
+    {
+        _slide();
+        _stats.skipped++;
+        ahead = (INT16)(seq - _next);
+    }
+    if (ahead == 0)
+    {
+        _slide();
+        _stats.received++;
+        return true;
+    }
+    UINT32 bit = 1UL << (ahead - 1);
+    if (_mask & bit)
+    {
+        _stats.duplicates++;
+        return false;
+    }
+    _mask |= bit;
+    _stats.received++;
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+void RelReceiver::ack(UINT8 *out)
+{
+    out[0] = REL_MAGIC;
+    out[1] = REL_ACK;
+    out[2] = _next & 0xFF;
+    out[3] = _next >> 8;
+    out[4] = _mask;
+    out[5] = _mask >> 8;
+    out[6] = _mask >> 16;
+    out[7] = _mask >> 24;
+    _stats.acks++;
+}
+
+//---------------------------------------------------------------------------------
+//-- _next is done with: move past it, and past whatever after it was received
+void RelReceiver::_slide()
+{
+    UINT64 bits = ((UINT64)_mask << 1) | 1;
+    while (bits & 1)
+    {
+        bits >>= 1;
+        _next++;
+    }
+    _mask = (UINT32)(bits >> 1);
+}
+
+//---------------------------------------------------------------------------------
+RelSender::RelSender()
+{
+    reset();
+}
+
+//---------------------------------------------------------------------------------
+void RelSender::reset(UINT16 first)
+{
+    for (UINT8 i = 0; i < REL_WINDOW; i++)
+        _slots[i].used = false;
+    _next_seq = first;
+    _oldest = first;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+//---------------------------------------------------------------------------------
+bool RelSender::isAck(const UINT8 *in, UINT32 len)
+{
+    return len >= REL_ACK_LEN && in[0] == REL_MAGIC && in[1] == REL_ACK;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 RelSender::send(const UINT8 *in, UINT32 len, UINT32 now, const UINT8 *&out)
+{
+    if ((UINT16)(_next_seq - _oldest) >= REL_WINDOW)
+        _release(_oldest, true);
+    Slot &s = _slots[_next_seq % REL_WINDOW];
+    s.used = true;
+    s.fast = false;
+    s.retries = 0;
+    s.len = REL_HEADER_LEN + len;
+    s.first_us = now;
+    s.sent_us = now;
+    s.data[0] = REL_MAGIC;
+    s.data[1] = REL_DATA;
+    s.data[2] = _next_seq & 0xFF;
+    s.data[3] = _next_seq >> 8;
+    s.data[4] = _oldest & 0xFF;
+    s.data[5] = _oldest >> 8;
+    memcpy(&s.data[REL_HEADER_LEN], in, len);
+    _next_seq++;
+    _stats.sent++;
+    out = s.data;
+    return s.len;
+}
+
+//---------------------------------------------------------------------------------
+void RelSender::ack(const UINT8 *in, UINT32 now)
+{
+    UINT16 next = in[2] | ((UINT16)in[3] << 8);
+    UINT32 mask = in[4] | ((UINT32)in[5] << 8) | ((UINT32)in[6] << 16) | ((UINT32)in[7] << 24);
+    UINT16 highest = next - 1;
+    for (UINT8 i = 0; i < 32; i++)
+    {
+        if (mask & (1UL << i))
+            highest = next + 1 + i;
+    }
+    for (UINT16 seq = _oldest; seq != _next_seq; seq++)
+    {
+        Slot &s = _slots[seq % REL_WINDOW];
+        if (!s.used)
+            continue;
+        INT16 off = (INT16)(seq - next);
+        if (off < 0 || (off > 0 && off <= 32 && (mask & (1UL << (off - 1)))))
+        {
+            if (s.retries == 0)
+            {
+                //-- Round trip only from datagrams sent once (Karn)
+                UINT32 sample = now - s.sent_us;
+                _stats.srtt_us = _stats.srtt_us ? _stats.srtt_us + ((INT32)(sample - _stats.srtt_us)) / 8 : sample;
+            }
+            else
+            {
+                UINT32 recovery = now - s.first_us;
+                _stats.recovered++;
+                _stats.recovery_us += recovery;
+                if (recovery > _stats.recovery_max_us)
+                    _stats.recovery_max_us = recovery;
+            }
+            _stats.acked++;
+            _release(seq, false);
+        }
+        //-- A hole below what arrived: lost, unless it was just sent again
+        else if ((INT16)(seq - highest) < 0 && (now - s.sent_us) >= _stats.srtt_us)
+            s.fast = true;
+    }
+}
+
+//---------------------------------------------------------------------------------
+UINT32 RelSender::poll(UINT32 now, const UINT8 *&out)
+{
+    UINT32 rto = 2 * _stats.srtt_us;
+    if (rto < REL_MIN_RTO)
+        rto = REL_MIN_RTO;
+    for (UINT16 seq = _oldest; seq != _next_seq; seq++)
+    {
+        Slot &s = _slots[seq % REL_WINDOW];
+        if (!s.used || (!s.fast && (now - s.sent_us) < rto))
+            continue;
+        if (s.retries >= REL_MAX_RETRIES)
+        {
+            _release(seq, true);
+            continue;
+        }
+        if (s.fast)
+            _stats.fast++;
+        s.fast = false;
+        s.retries++;
+        s.sent_us = now;
+        s.data[4] = _oldest & 0xFF;
+        s.data[5] = _oldest >> 8;
+        _stats.retransmits++;
+        out = s.data;
+        return s.len;
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------------
+void RelSender::_release(UINT16 seq, bool abandoned)
+{
+    _slots[seq % REL_WINDOW].used = false;
+    if (abandoned)
+        _stats.abandoned++;
+    while (_oldest != _next_seq && !_slots[_oldest % REL_WINDOW].used)
+        _oldest++;
+}
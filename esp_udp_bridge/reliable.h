@@ -0,0 +1,162 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file reliable.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Reliable delivery of the uplink (commands, mission items, parameter
+ * sets) between the host side proxy and the bridge (UDP_RELIABLE). The
+ * proxy numbers each datagram and keeps it until the bridge acknowledges
+ * it; the bridge answers every pass that received datagrams with the first
+ * sequence it is missing and a bitmap of the REL_WINDOW after it (selective
+ * ACK). A hole below an acknowledged datagram is sent again at once, so a
+ * loss costs about one round trip instead of a MAVLink retry timeout.
+ * Datagrams are handed to the UART as they arrive, only duplicates are held
+ * back: MAVLink needs no ordering and a lost one should not delay the rest.
+ *
+ * Data: REL_MAGIC, REL_DATA, sequence (16 bit), oldest sequence the proxy
+ * still holds (16 bit). ACK: REL_MAGIC, REL_ACK, first missing sequence
+ * (16 bit), bitmap (32 bit, bit n: first + 1 + n was received); all little
+ * endian. The oldest sequence tells the bridge where the stream starts when
+ * it joins late, what the proxy gave up on, and when the proxy restarted.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef RELIABLE_H
+#define RELIABLE_H
+
+#include "common.h"
+
+#define REL_MAGIC               0xEB    // Neither MAVLink nor another bridge header
+#define REL_DATA                0x00
+#define REL_ACK                 0x01
+#define REL_HEADER_LEN          6
+#define REL_ACK_LEN             8
+#define REL_WINDOW              32      // Datagrams in flight, and the bitmap size
+#define REL_SEQ_RESYNC          512     // A bigger jump means the proxy restarted
+#define REL_MIN_RTO             10000   // us before an unacknowledged datagram is sent again
+#define REL_MAX_RETRIES         8
+
+struct RelReceiverStats
+{
+    UINT32  received;       // New datagrams, handed on
+    UINT32  duplicates;     // Retransmissions of datagrams already handed on
+    UINT32  skipped;        // Sequences the proxy gave up on
+    UINT32  restarts;
+    UINT32  acks;
+};
+
+//-- Bridge side, one per client
+class RelReceiver
+{
+public:
+    RelReceiver();
+
+    void        reset       ();
+    bool        active      () const { return _active; }
+    static bool isData      (const UINT8 *in, UINT32 len);
+
+    //-- Takes the sequence of a data datagram; false for a duplicate
+    bool        receive     (const UINT8 *in);
+    //-- Writes the ACK for everything received so far, REL_ACK_LEN bytes
+    void        ack         (UINT8 *out);
+
+    const RelReceiverStats &getStats() const { return _stats; }
+
+private:
+    void        _slide      ();
+
+private:
+    bool        _active;
+    UINT16      _next;      // First sequence not received
+    UINT32      _mask;      // Bit n: _next + 1 + n received
+    RelReceiverStats _stats;
+};
+
+struct RelSenderStats
+{
+    UINT32  sent;
+    UINT32  acked;
+    UINT32  retransmits;
+    UINT32  fast;           // Retransmits for a hole below an acknowledged datagram
+    UINT32  recovered;      // Acknowledged after a retransmit
+    UINT32  abandoned;      // Out of retries, or pushed out of a full window
+    UINT64  recovery_us;    // First send to ACK of the recovered ones
+    UINT32  recovery_max_us;
+    UINT32  srtt_us;        // Smoothed round trip
+};
+
+//-- Proxy side
+class RelSender
+{
+public:
+    RelSender();
+
+    //-- A proxy that starts over should pick a first sequence far from where
+    //   it stopped, or the bridge takes its datagrams for duplicates
+    void        reset       (UINT16 first = 0);
+    static bool isAck       (const UINT8 *in, UINT32 len);
+    bool        pending     () const { return _oldest != _next_seq; }
+
+    //-- Wraps a datagram (len <= PACKET_BUFFER_SIZE) and keeps it until it is
+    //   acknowledged. A full window gives up on the oldest. Returns the bytes
+    //   to send, pointed to by out.
+    UINT32      send        (const UINT8 *in, UINT32 len, UINT32 now, const UINT8 *&out);
+    //-- Takes an ACK from the bridge
+    void        ack         (const UINT8 *in, UINT32 now);
+    //-- A datagram due to be sent again, or 0. Call until there is none.
+    UINT32      poll        (UINT32 now, const UINT8 *&out);
+
+    const RelSenderStats &getStats() const { return _stats; }
+
+private:
+    struct Slot
+    {
+        bool    used;
+        bool    fast;       // Due now: a later one was acknowledged
+        UINT8   retries;
+        UINT16  len;
+        UINT32  first_us;
+        UINT32  sent_us;
+        UINT8   data[REL_HEADER_LEN + PACKET_BUFFER_SIZE];
+    };
+
+    void        _release    (UINT16 seq, bool abandoned);
+
+private:
+    Slot        _slots[REL_WINDOW];     // By sequence % REL_WINDOW
+    UINT16      _next_seq;
+    UINT16      _oldest;                // Oldest not acknowledged
+    RelSenderStats _stats;
+};
+
+#endif
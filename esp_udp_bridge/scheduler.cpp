@@ -0,0 +1,147 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file scheduler.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "scheduler.h"
+
+//---------------------------------------------------------------------------------
+Scheduler::Scheduler()
+    : _count(0), _next(0), _io_period(0xFFFFFFFF), _io_start(0)
+{
+    memset(_tasks, 0, sizeof(_tasks));
+}
+
+//---------------------------------------------------------------------------------
+bool Scheduler::addTask(const char *name, TaskFunction function, UINT8 type, UINT32 period_us, UINT32 budget_us)
+{
+    if (_count == SCHED_MAX_TASKS)
+        return false;
+    SchedulerTask &task = _tasks[_count++];
+    task.name = name;
+    task.function = function;
+    task.type = type;
+    task.period_us = period_us;
+    task.budget_us = budget_us;
+    task.last_start = micros();
+    if (type == TASK_IO && period_us < _io_period)
+        _io_period = period_us;
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+void Scheduler::run()
+{
+    //-- Bridge I/O first, every pass
+    _io_start = micros();
+    for (UINT8 i = 0; i < _count; i++)
+    {
+        SchedulerTask &task = _tasks[i];
+        if (task.type != TASK_IO)
+            continue;
+        UINT32 now = micros();
+        if (now - task.last_start > task.period_us)
+            task.missed++;
+        _runTask(task, now);
+    }
+
+    //-- Then the first background task that is due and fits before the next
+    //   I/O deadline. One that has waited a whole extra period runs anyway.
+    UINT32 now = micros();
+    UINT32 used = now - _io_start;
+    UINT32 slack = (used < _io_period) ? _io_period - used : 0;
+    for (UINT8 n = 0; n < _count; n++)
+    {
+        UINT8 i = (_next + n) % _count;
+        SchedulerTask &task = _tasks[i];
+        if (task.type != TASK_BACKGROUND)
+            continue;
+        UINT32 waited = now - task.last_start;
+        if (waited < task.period_us)
+            continue;
+        if (task.budget_us > slack)
+        {
+            if (waited < 2 * task.period_us)
+                continue;
+            task.missed++;
+        }
+        _runTask(task, now);
+        _next = (i + 1) % _count;
+        break;
+    }
+}
+
+//---------------------------------------------------------------------------------
+void Scheduler::_runTask(SchedulerTask &task, UINT32 now)
+{
+    task.last_start = now;
+    task.function();
+    UINT32 elapsed = micros() - now;
+    task.runs++;
+    if (elapsed > task.budget_us)
+        task.overruns++;
+    if (elapsed > task.max_us)
+        task.max_us = elapsed;
+}
+
+//---------------------------------------------------------------------------------
+void Scheduler::resetStats()
+{
+    for (UINT8 i = 0; i < _count; i++)
+    {
+        _tasks[i].runs = 0;
+        _tasks[i].missed = 0;
+        _tasks[i].overruns = 0;
+        _tasks[i].max_us = 0;
+    }
+}
+
+//---------------------------------------------------------------------------------
+int Scheduler::toJson(char *buffer, int size) const
+{
+    int len = snprintf(buffer, size, "{\"io_period_us\":%u,\"tasks\":[", _io_period);
+    for (UINT8 i = 0; i < _count && len < size; i++)
+    {
+        const SchedulerTask &t = _tasks[i];
+        len += snprintf(&buffer[len], size - len,
+                        "%s{\"name\":\"%s\",\"period_us\":%u,\"budget_us\":%u,\"runs\":%u,"
+                        "\"missed\":%u,\"overruns\":%u,\"max_us\":%u}",
+                        i ? "," : "", t.name, t.period_us, t.budget_us, t.runs,
+                        t.missed, t.overruns, t.max_us);
+    }
+    if (len < size)
+        len += snprintf(&buffer[len], size - len, "]}");
+    return (len < size) ? len : size - 1;
+}
@@ -0,0 +1,103 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file scheduler.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Cooperative scheduler run from loop(). I/O tasks run on every pass and
+ * must start at least once per period; background tasks (web server,
+ * housekeeping) only run in the slack left before the next I/O deadline,
+ * unless they have been held off for a whole extra period.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "common.h"
+
+#define SCHED_MAX_TASKS         8
+
+enum
+{
+    TASK_IO = 0,            // Runs every pass, period is its deadline
+    TASK_BACKGROUND         // Runs once per period, when it fits in the slack
+};
+
+typedef void (*TaskFunction)();
+
+struct SchedulerTask
+{
+    const char  *name;
+    TaskFunction function;
+    UINT8       type;
+    UINT32      period_us;
+    UINT32      budget_us;
+    UINT32      last_start; // micros()
+    //-- Statistics
+    UINT32      runs;
+    UINT32      missed;     // Started later than its deadline
+    UINT32      overruns;   // Ran longer than its budget
+    UINT32      max_us;
+};
+
+class Scheduler
+{
+public:
+    Scheduler();
+
+    //-- Tasks run in the order added within their type. Returns false if full.
+    bool        addTask     (const char *name, TaskFunction function, UINT8 type, UINT32 period_us, UINT32 budget_us);
+    //-- One pass: every I/O task, then at most one background task
+    void        run         ();
+    void        resetStats  ();
+
+    UINT8       count       () const { return _count; }
+    const SchedulerTask &at (UINT8 index) const { return _tasks[index]; }
+    //-- Shortest I/O period, the time the bridge can go without service
+    UINT32      ioPeriod    () const { return _io_period; }
+
+    //-- Writes the task statistics as JSON, returns the length
+    int         toJson      (char *buffer, int size) const;
+
+private:
+    void        _runTask    (SchedulerTask &task, UINT32 now);
+
+private:
+    SchedulerTask _tasks[SCHED_MAX_TASKS];
+    UINT8       _count;
+    UINT8       _next;      // Background task to look at first (round robin)
+    UINT32      _io_period;
+    UINT32      _io_start;  // Start of the last I/O pass
+};
+
+#endif
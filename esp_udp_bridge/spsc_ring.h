@@ -0,0 +1,180 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file spsc_ring.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Lock-free single producer, single consumer byte ring. The size is fixed
+ * at compile time and must be a power of two. Besides copying read() and
+ * write(), each side can work in place on the contiguous span at its index
+ * (writeSpan()/commit() and readSpan()/consume()), so data can be received
+ * straight into the ring and parsed or sent straight out of it.
+ *
+ * Only the producer writes the head and only the consumer writes the tail;
+ * each index is published with release and read with acquire ordering, so
+ * the two sides may run in different contexts (loop() and an interrupt, or
+ * two host threads).
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include "common.h"
+
+template <UINT32 SIZE>
+class SpscRing
+{
+    static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    SpscRing() : _head(0), _tail(0) {}
+
+    static UINT32 capacity      () { return SIZE; }
+
+    //-- Either side may ask; the answer is a lower bound for its own use
+    UINT32  used                () const { return _load(_head) - _load(_tail); }
+    UINT32  space               () const { return SIZE - used(); }
+    bool    empty               () const { return used() == 0; }
+
+    //-- Empties the ring. Only when neither side is using it.
+    void    reset               () { _head = _tail = 0; }
+
+    //---------------------------------------------------------------------------
+    //-- Producer
+
+    //-- Contiguous free room at the head; fill up to len bytes then commit()
+    UINT8 *writeSpan(UINT32 &len)
+    {
+        UINT32 head = _head;
+        UINT32 offset = head & MASK;
+        len = SIZE - (head - _load(_tail));
+        if (len > SIZE - offset)
+            len = SIZE - offset;
+        return &_buffer[offset];
+    }
+
+    //-- Publishes len bytes written into the last writeSpan()
+    void commit(UINT32 len)
+    {
+        _store(_head, _head + len);
+    }
+
+    //-- Copies in as much as fits, returns the number of bytes written
+    UINT32 write(const UINT8 *buffer, UINT32 len)
+    {
+        UINT32 written = 0;
+        while (written < len)
+        {
+            UINT32 room;
+            UINT8 *span = writeSpan(room);
+            if (room == 0)
+                break;
+            if (room > len - written)
+                room = len - written;
+            memcpy(span, &buffer[written], room);
+            commit(room);
+            written += room;
+        }
+        return written;
+    }
+
+    //---------------------------------------------------------------------------
+    //-- Consumer
+
+    //-- Contiguous unread bytes at the tail; use up to len bytes then consume()
+    const UINT8 *readSpan(UINT32 &len) const
+    {
+        UINT32 tail = _tail;
+        UINT32 offset = tail & MASK;
+        len = _load(_head) - tail;
+        if (len > SIZE - offset)
+            len = SIZE - offset;
+        return &_buffer[offset];
+    }
+
+    //-- Releases len bytes of the last readSpan() back to the producer
+    void consume(UINT32 len)
+    {
+        _store(_tail, _tail + len);
+    }
+
+    //-- Drops up to len unread bytes, returns the number dropped
+    UINT32 discard(UINT32 len)
+    {
+        UINT32 done = 0;
+        while (done < len)
+        {
+            UINT32 avail;
+            readSpan(avail);
+            if (avail == 0)
+                break;
+            if (avail > len - done)
+                avail = len - done;
+            consume(avail);
+            done += avail;
+        }
+        return done;
+    }
+
+    //-- Copies out up to len bytes, returns the number of bytes read
+    UINT32 read(UINT8 *buffer, UINT32 len)
+    {
+        UINT32 done = 0;
+        while (done < len)
+        {
+            UINT32 avail;
+            const UINT8 *span = readSpan(avail);
+            if (avail == 0)
+                break;
+            if (avail > len - done)
+                avail = len - done;
+            memcpy(&buffer[done], span, avail);
+            consume(avail);
+            done += avail;
+        }
+        return done;
+    }
+
+private:
+    enum { MASK = SIZE - 1 };
+
+    static UINT32 _load(const UINT32 &index) { return __atomic_load_n(&index, __ATOMIC_ACQUIRE); }
+    static void _store(UINT32 &index, UINT32 value) { __atomic_store_n(&index, value, __ATOMIC_RELEASE); }
+
+private:
+    UINT8   _buffer[SIZE];
+    UINT32  _head;  // Free running write index, producer only
+    UINT32  _tail;  // Free running read index, consumer only
+};
+
+#endif
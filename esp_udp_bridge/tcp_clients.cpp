@@ -0,0 +1,225 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file tcp_clients.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "tcp_clients.h"
+
+#include <new>
+
+//---------------------------------------------------------------------------------
+TcpClientTable::TcpClientTable()
+    : _tcp(NULL), _queues(NULL), _mask(0)
+{
+    memset(_clients, 0, sizeof(_clients));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+//---------------------------------------------------------------------------------
+void TcpClientTable::begin(BridgeTcp *tcp, UINT16 port)
+{
+    for (UINT8 i = 0; i < TCP_MAX_CLIENTS; i++)
+    {
+        if (_mask & (1 << i))
+            close(i);
+    }
+    memset(&_stats, 0, sizeof(_stats));
+    _tcp = NULL;
+    if (!tcp || !port)
+        return;
+    //-- Taken once and kept: the port only changes with a reboot, and a
+    //   second begin() must not fragment the heap
+    if (!_queues)
+        _queues = new (std::nothrow) SpscRing<TCP_TX_QUEUE_SIZE>[TCP_MAX_CLIENTS];
+    if (_queues && tcp->begin(port))
+        _tcp = tcp;
+}
+
+//---------------------------------------------------------------------------------
+UINT8 TcpClientTable::poll(UINT32 now)
+{
+    for (UINT8 i = 0; i < TCP_MAX_CLIENTS; i++)
+    {
+        if ((_mask & (1 << i)) && !_tcp->connected(i))
+        {
+            close(i);
+            _stats.closed++;
+        }
+    }
+    UINT8 fresh = 0;
+    while (true)
+    {
+        UINT8 slot = 0;
+        while (slot < TCP_MAX_CLIENTS && (_mask & (1 << slot)))
+            slot++;
+        if (slot == TCP_MAX_CLIENTS)
+        {
+            while (_tcp->reject())
+                _stats.rejected++;
+            break;
+        }
+        if (!_tcp->accept(slot))
+            break;
+        TcpClient &c = _clients[slot];
+        memset(&c, 0, sizeof(c));
+        c.ip = _tcp->remoteIP(slot);
+        c.port = _tcp->remotePort(slot);
+        c.progress = now;
+        _queues[slot].reset();
+        _mask |= 1 << slot;
+        fresh |= 1 << slot;
+        _stats.accepted++;
+    }
+    return fresh;
+}
+
+//---------------------------------------------------------------------------------
+//-- A client that keeps up gets the datagram straight from the shared
+//   buffer. Otherwise it goes behind what is already queued, in one piece
+//   or not at all.
+UINT8 TcpClientTable::send(UINT8 clients, const UINT8 *head, UINT32 head_len, const UINT8 *buffer, UINT32 len, UINT32 now)
+{
+    UINT8 taken = 0;
+    clients &= _mask;
+    for (UINT8 i = 0; i < TCP_MAX_CLIENTS; i++)
+    {
+        if (!(clients & (1 << i)))
+            continue;
+        TcpClient &c = _clients[i];
+        SpscRing<TCP_TX_QUEUE_SIZE> &queue = _queues[i];
+        UINT32 head_done = 0;
+        UINT32 done = 0;
+        if (queue.empty())
+        {
+            UINT32 room = _tcp->availableForWrite(i);
+            head_done = _write(i, head, head_len, room);
+            if (head_done == head_len)
+                done = _write(i, buffer, len, room);
+            c.direct += head_done + done;
+            c.progress = now;
+            if (head_done == head_len && done == len)
+            {
+                taken++;
+                continue;
+            }
+        }
+        else if (queue.space() < head_len + len)
+        {
+            c.trimmed += head_len + len;
+            continue;
+        }
+        queue.write(&head[head_done], head_len - head_done);
+        queue.write(&buffer[done], len - done);
+        if (queue.used() > c.queue_high_water)
+            c.queue_high_water = queue.used();
+        taken++;
+    }
+    return taken;
+}
+
+//---------------------------------------------------------------------------------
+void TcpClientTable::flush(UINT32 now)
+{
+    for (UINT8 i = 0; i < TCP_MAX_CLIENTS; i++)
+    {
+        if (!(_mask & (1 << i)))
+            continue;
+        _drain(i, now);
+        if (!_queues[i].empty() && (now - _clients[i].progress) >= TCP_STALL_TIMEOUT)
+        {
+            close(i);
+            _stats.stalled++;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------
+UINT32 TcpClientTable::read(UINT8 slot, UINT8 *buffer, UINT32 len)
+{
+    UINT32 n = _tcp->read(slot, buffer, len);
+    _clients[slot].bytes_in += n;
+    return n;
+}
+
+//---------------------------------------------------------------------------------
+//-- As much of the queue as the socket takes
+void TcpClientTable::_drain(UINT8 slot, UINT32 now)
+{
+    SpscRing<TCP_TX_QUEUE_SIZE> &queue = _queues[slot];
+    TcpClient &c = _clients[slot];
+    UINT32 room = _tcp->availableForWrite(slot);
+    while (room > 0)
+    {
+        UINT32 len;
+        const UINT8 *span = queue.readSpan(len);
+        if (len == 0)
+            break;
+        if (len > room)
+            len = room;
+        UINT32 written = _tcp->write(slot, span, len);
+        queue.consume(written);
+        c.bytes_out += written;
+        if (written)
+            c.progress = now;
+        if (written < len)
+            break;
+        room -= written;
+    }
+    if (queue.empty())
+        c.progress = now;
+}
+
+//---------------------------------------------------------------------------------
+//-- What the socket takes of len bytes, at most room
+UINT32 TcpClientTable::_write(UINT8 slot, const UINT8 *buffer, UINT32 len, UINT32 &room)
+{
+    if (len > room)
+        len = room;
+    if (len == 0)
+        return 0;
+    UINT32 written = _tcp->write(slot, buffer, len);
+    _clients[slot].bytes_out += written;
+    room = (written < len) ? 0 : room - written;
+    return written;
+}
+
+//---------------------------------------------------------------------------------
+void TcpClientTable::close(UINT8 slot)
+{
+    _tcp->close(slot);
+    _queues[slot].reset();
+    _mask &= ~(1 << slot);
+}
@@ -0,0 +1,120 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file tcp_clients.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * GCS clients connected over TCP (WIFI_TCP_PORT). The downlink is written
+ * to each one straight from the datagram buffer while it keeps up; what
+ * the socket does not take waits in a bounded queue per client. A datagram
+ * that does not fit is dropped whole (trimmed), so the stream never holds
+ * part of a frame, and a client that takes nothing for TCP_STALL_TIMEOUT
+ * is dropped, so one slow client never holds up the bridge or the others.
+ * The queues are only allocated once a port is set.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef TCP_CLIENTS_H
+#define TCP_CLIENTS_H
+
+#include "common.h"
+#include "spsc_ring.h"
+#include "transport.h"
+
+//-- A partly written datagram always fits the queue of an idle client
+static_assert(TCP_TX_QUEUE_SIZE >= PACKET_BUFFER_SIZE, "TCP_TX_QUEUE_SIZE must hold a whole datagram");
+#if TCP_MAX_CLIENTS > 8
+#error "TCP_MAX_CLIENTS must fit in a UINT8 slot mask"
+#endif
+
+struct TcpClient
+{
+    UINT32  ip;
+    UINT16  port;
+    UINT16  queue_high_water;
+    UINT32  bytes_in;
+    UINT32  bytes_out;
+    UINT32  direct;     // Bytes written straight from the datagram, not queued
+    UINT32  trimmed;    // Bytes of datagrams dropped as the queue was full
+    UINT32  progress;   // millis() when the client last took bytes or had none waiting
+};
+
+struct TcpStats
+{
+    UINT32  accepted;
+    UINT32  rejected;   // All slots were taken
+    UINT32  closed;     // By the client
+    UINT32  stalled;    // Dropped for not reading
+};
+
+class TcpClientTable
+{
+public:
+    TcpClientTable();
+
+    //-- tcp == NULL, port 0, a port that cannot be opened or no memory for
+    //   the queues leaves TCP off
+    void            begin       (BridgeTcp *tcp, UINT16 port);
+    bool            enabled     () const { return _tcp != NULL; }
+    //-- Takes new connections and lets go of closed ones, returns the mask
+    //   of slots that got a new client
+    UINT8           poll        (UINT32 now);
+    //-- The same bytes to every client
+    UINT8           send        (const UINT8 *buffer, UINT32 len, UINT32 now) { return send(_mask, NULL, 0, buffer, len, now); }
+    //-- A header and the bytes behind it to the clients in the mask, as one
+    //   piece: both are written or queued, or neither. Returns how many
+    //   clients took them.
+    UINT8           send        (UINT8 clients, const UINT8 *head, UINT32 head_len, const UINT8 *buffer, UINT32 len, UINT32 now);
+    //-- Writes out what is queued, and drops clients that stalled
+    void            flush       (UINT32 now);
+    UINT32          read        (UINT8 slot, UINT8 *buffer, UINT32 len);
+    void            close       (UINT8 slot);
+
+    UINT8           mask        () const { return _mask; }
+    const TcpClient &at         (UINT8 slot) const { return _clients[slot]; }
+    UINT32          queued      (UINT8 slot) const { return _queues ? _queues[slot].used() : 0; }
+    const TcpStats &getStats    () const { return _stats; }
+
+private:
+    void            _drain      (UINT8 slot, UINT32 now);
+    UINT32          _write      (UINT8 slot, const UINT8 *buffer, UINT32 len, UINT32 &room);
+
+private:
+    BridgeTcp      *_tcp;
+    TcpClient       _clients[TCP_MAX_CLIENTS];
+    SpscRing<TCP_TX_QUEUE_SIZE> *_queues; // TCP_MAX_CLIENTS of them, from the first begin() with a port
+    UINT8           _mask;      // Slots in use
+    TcpStats        _stats;
+};
+
+#endif
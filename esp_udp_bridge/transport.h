@@ -0,0 +1,113 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file transport.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Thin interfaces the bridge core talks to instead of the ESP8266 APIs,
+ * so the forwarding logic also builds and runs on a host.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "common.h"
+
+//-- Serial link to the UAS
+class BridgeSerial
+{
+public:
+    virtual ~BridgeSerial() {}
+
+    virtual void    begin               (UINT32 baudRate) = 0;
+    virtual UINT32  available           () = 0;
+    virtual UINT32  read                (UINT8 *buffer, UINT32 len) = 0;
+    virtual UINT32  availableForWrite   () = 0;
+    virtual UINT32  write               (const UINT8 *buffer, UINT32 len) = 0;
+    //-- True if framing or parity errors were seen since the last call
+    virtual bool    hasRxError          () = 0;
+    //-- Hardware RTS/CTS, when the port has it
+    virtual void    setFlowControl      (bool enable) = 0;
+    //-- Rate measured from the width of received pulses, 0 if not (yet) known
+    virtual UINT32  detectBaudRate      () = 0;
+    //-- True if received bytes were lost since the last call
+    virtual bool    hasOverrun          () = 0;
+    //-- millis() when the oldest unread byte arrived (now if not known)
+    virtual UINT32  rxTime              () = 0;
+};
+
+//-- UDP socket towards the GCS. Addresses are IPv4 in network byte order,
+//   the same value IPAddress converts to.
+class BridgeUdp
+{
+public:
+    virtual ~BridgeUdp() {}
+
+    virtual bool    begin               (UINT16 port) = 0;
+    //-- Size of the next datagram (making it current), 0 if there is none
+    virtual UINT32  parsePacket         () = 0;
+    //-- Reads from the current datagram, 0 once it is consumed
+    virtual UINT32  read                (UINT8 *buffer, UINT32 len) = 0;
+    virtual UINT32  remoteIP            () = 0;
+    virtual UINT16  remotePort          () = 0;
+    virtual UINT32  sendTo              (UINT32 ip, UINT16 port, const UINT8 *buffer, UINT32 len) = 0;
+    //-- One datagram of header and buffer, so a per recipient header needs
+    //   no copy of the payload. Returns the bytes sent, both parts included.
+    virtual UINT32  sendTo              (UINT32 ip, UINT16 port, const UINT8 *header, UINT32 header_len, const UINT8 *buffer, UINT32 len) = 0;
+};
+
+//-- TCP listener towards the GCS. Connections are kept in slots chosen by
+//   the caller (0 .. TCP_MAX_CLIENTS - 1), and no call may block.
+class BridgeTcp
+{
+public:
+    virtual ~BridgeTcp() {}
+
+    virtual bool    begin               (UINT16 port) = 0;
+    //-- Takes a pending connection into slot, with Nagle off; false if none
+    virtual bool    accept              (UINT8 slot) = 0;
+    //-- Closes a pending connection (all slots taken); false if none
+    virtual bool    reject              () = 0;
+    virtual bool    connected           (UINT8 slot) = 0;
+    //-- Reads what has arrived, 0 if nothing
+    virtual UINT32  read                (UINT8 slot, UINT8 *buffer, UINT32 len) = 0;
+    //-- Bytes write() takes right now
+    virtual UINT32  availableForWrite   (UINT8 slot) = 0;
+    //-- Returns the bytes taken, which may be fewer than len
+    virtual UINT32  write               (UINT8 slot, const UINT8 *buffer, UINT32 len) = 0;
+    virtual void    close               (UINT8 slot) = 0;
+    virtual UINT32  remoteIP            (UINT8 slot) = 0;
+    virtual UINT16  remotePort          (UINT8 slot) = 0;
+};
+
+#endif
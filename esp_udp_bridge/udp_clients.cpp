@@ -0,0 +1,141 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file udp_clients.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "udp_clients.h"
+
+//---------------------------------------------------------------------------------
+UdpClientTable::UdpClientTable()
+    : _mask(0), _count(0), _max(MAX_UDP_CLIENTS), _timeout(DEFAULT_CLIENT_TIMEOUT * 1000), _rejected(0)
+{
+    memset(_clients, 0, sizeof(_clients));
+}
+
+//---------------------------------------------------------------------------------
+void UdpClientTable::begin(UINT8 maxClients, UINT32 timeoutMs)
+{
+    _max = (maxClients == 0 || maxClients > MAX_UDP_CLIENTS) ? MAX_UDP_CLIENTS : maxClients;
+    _timeout = timeoutMs;
+    _mask = 0;
+    _count = 0;
+    _rejected = 0;
+}
+
+//---------------------------------------------------------------------------------
+void UdpClientTable::setStatic(UINT32 ip, UINT16 port)
+{
+    for (UINT8 i = 0; i < MAX_UDP_CLIENTS; i++)
+    {
+        if ((_mask & (1 << i)) && _clients[i].fixed)
+        {
+            _mask &= ~(1 << i);
+            _count--;
+        }
+    }
+    if (ip == 0 || port == 0)
+        return;
+    //-- The static entry always gets a slot, even if the table is full
+    INT8 slot = _alloc();
+    if (slot < 0)
+    {
+        slot = MAX_UDP_CLIENTS - 1;
+        _mask &= ~(1 << slot);
+        _count--;
+    }
+    UdpClient &c = _clients[slot];
+    c.ip = ip;
+    c.port = port;
+    c.fixed = true;
+    c.last_seen = 0;
+    _mask |= 1 << slot;
+    _count++;
+}
+
+//---------------------------------------------------------------------------------
+INT8 UdpClientTable::touch(UINT32 ip, UINT16 port, UINT32 now)
+{
+    for (UINT8 i = 0; i < MAX_UDP_CLIENTS; i++)
+    {
+        if ((_mask & (1 << i)) && _clients[i].ip == ip && _clients[i].port == port)
+        {
+            _clients[i].last_seen = now;
+            return i;
+        }
+    }
+    INT8 slot = (_count < _max) ? _alloc() : -1;
+    if (slot < 0)
+    {
+        _rejected++;
+        return -1;
+    }
+    UdpClient &c = _clients[slot];
+    c.ip = ip;
+    c.port = port;
+    c.fixed = false;
+    c.last_seen = now;
+    _mask |= 1 << slot;
+    _count++;
+    return slot;
+}
+
+//---------------------------------------------------------------------------------
+UINT8 UdpClientTable::expire(UINT32 now)
+{
+    UINT8 freed = 0;
+    for (UINT8 i = 0; i < MAX_UDP_CLIENTS; i++)
+    {
+        if ((_mask & (1 << i)) && !_clients[i].fixed && (now - _clients[i].last_seen) > _timeout)
+            freed |= 1 << i;
+    }
+    if (freed)
+    {
+        _mask &= ~freed;
+        for (UINT8 m = freed; m; m &= m - 1)
+            _count--;
+    }
+    return freed;
+}
+
+//---------------------------------------------------------------------------------
+INT8 UdpClientTable::_alloc()
+{
+    for (UINT8 i = 0; i < MAX_UDP_CLIENTS; i++)
+    {
+        if (!(_mask & (1 << i)))
+            return i;
+    }
+    return -1;
+}
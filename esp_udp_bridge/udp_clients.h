@@ -0,0 +1,93 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file udp_clients.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Table of GCS endpoints (IP:port) the downlink is sent to. Endpoints are
+ * learned from incoming datagrams and expire when they go quiet; an
+ * optional static entry never expires.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef UDP_CLIENTS_H
+#define UDP_CLIENTS_H
+
+#include "common.h"
+
+//-- Clients are addressed by a bit per slot (see MavlinkRouter)
+#if MAX_UDP_CLIENTS > 8
+#error "MAX_UDP_CLIENTS must fit in a UINT8 slot mask"
+#endif
+
+#define UDP_CLIENTS_ALL         0xFF
+
+struct UdpClient
+{
+    UINT32  ip;
+    UINT16  port;
+    bool    fixed;
+    UINT32  last_seen;  // millis()
+};
+
+class UdpClientTable
+{
+public:
+    UdpClientTable();
+
+    void            begin       (UINT8 maxClients, UINT32 timeoutMs);
+    //-- Adds the never expiring destination; ip == 0 removes it
+    void            setStatic   (UINT32 ip, UINT16 port);
+    //-- Learns or refreshes a client, returns its slot or -1 if the table is full
+    INT8            touch       (UINT32 ip, UINT16 port, UINT32 now);
+    //-- Drops silent clients, returns the mask of slots that were freed
+    UINT8           expire      (UINT32 now);
+
+    //-- Slots stay put for the lifetime of a client, so they can be kept in masks
+    UINT8           mask        () const { return _mask; }
+    UINT8           count       () const { return _count; }
+    const UdpClient &at         (UINT8 slot) const { return _clients[slot]; }
+    UINT32          rejected    () const { return _rejected; }
+
+private:
+    INT8            _alloc      ();
+
+private:
+    UdpClient       _clients[MAX_UDP_CLIENTS];
+    UINT8           _mask;      // Slots in use
+    UINT8           _count;
+    UINT8           _max;
+    UINT32          _timeout;
+    UINT32          _rejected;
+};
+
+#endif
@@ -0,0 +1,494 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file ws_clients.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * RFC 6455, the parts a bridge needs: the upgrade handshake and
+ * unfragmented server frames. Client frames must be masked; fragmented
+ * data frames are fine, as the payload is a byte stream anyway.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "ws_clients.h"
+
+#include <ctype.h>
+#include <new>
+
+#define WS_OP_CONTINUATION      0x0
+#define WS_OP_TEXT              0x1
+#define WS_OP_BINARY            0x2
+#define WS_OP_CLOSE             0x8
+#define WS_OP_PING              0x9
+#define WS_OP_PONG              0xA
+#define WS_FIN                  0x80
+#define WS_MASKED               0x80
+#define WS_CLOSE_PROTOCOL       1002
+#define WS_CLOSE_TOO_BIG        1009
+
+#define WS_REQ_LINE             0x01    // Request line read
+#define WS_REQ_PATH             0x02    // ... and it was a GET for WS_PATH
+#define WS_REQ_UPGRADE          0x04
+#define WS_REQ_KEY              0x08
+#define WS_REQ_ALL              0x0F
+
+static const char kGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+static const char kBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+//---------------------------------------------------------------------------------
+static inline UINT32 _rol(UINT32 v, UINT8 n)
+{
+    return (v << n) | (v >> (32 - n));
+}
+
+//---------------------------------------------------------------------------------
+//-- One SHA-1 round over a 64 byte block, with the message schedule kept in
+//   16 words
+static void _sha1Block(UINT32 *h, const UINT8 *block)
+{
+    UINT32 w[16];
+    for (UINT8 i = 0; i < 16; i++)
+        w[i] = ((UINT32)block[i * 4] << 24) | ((UINT32)block[i * 4 + 1] << 16) | ((UINT32)block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    UINT32 a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (UINT8 i = 0; i < 80; i++)
+    {
+        if (i >= 16)
+            w[i & 15] = _rol(w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15], 1);
+        UINT32 f, k;
+        if (i < 20)
+        {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        }
+        else if (i < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        }
+        else if (i < 60)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        UINT32 t = _rol(a, 5) + f + e + k + w[i & 15];
+        e = d;
+        d = c;
+        c = _rol(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+//---------------------------------------------------------------------------------
+//-- Sec-WebSocket-Accept: base64 of the SHA-1 of the key and the GUID, which
+//   always make 60 bytes, so two blocks. Writes 28 characters.
+static void _acceptKey(const char *key, char *out)
+{
+    UINT8 message[128];
+    memset(message, 0, sizeof(message));
+    memcpy(message, key, WS_KEY_LEN);
+    memcpy(&message[WS_KEY_LEN], kGuid, sizeof(kGuid) - 1);
+    message[60] = 0x80;
+    message[126] = (60 * 8) >> 8;
+    message[127] = (60 * 8) & 0xFF;
+    UINT32 h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    _sha1Block(h, message);
+    _sha1Block(h, &message[64]);
+    UINT8 digest[21];
+    for (UINT8 i = 0; i < 20; i++)
+        digest[i] = h[i / 4] >> (24 - (i % 4) * 8);
+    digest[20] = 0;
+    for (UINT8 i = 0; i < 21; i += 3)
+    {
+        UINT32 v = ((UINT32)digest[i] << 16) | ((UINT32)digest[i + 1] << 8) | digest[i + 2];
+        *out++ = kBase64[(v >> 18) & 0x3F];
+        *out++ = kBase64[(v >> 12) & 0x3F];
+        *out++ = kBase64[(v >> 6) & 0x3F];
+        *out++ = (i + 2 < 20) ? kBase64[v & 0x3F] : '=';
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- Past a case-insensitive prefix given in lower case, or NULL
+static const char *_match(const char *s, const char *lower)
+{
+    while (*lower)
+    {
+        if (tolower((unsigned char)*s++) != *lower++)
+            return NULL;
+    }
+    return s;
+}
+
+//---------------------------------------------------------------------------------
+//-- The value of a header line with that name, or NULL
+static const char *_value(const char *line, const char *name)
+{
+    line = _match(line, name);
+    if (!line || *line++ != ':')
+        return NULL;
+    while (*line == ' ' || *line == '\t')
+        line++;
+    return line;
+}
+
+//---------------------------------------------------------------------------------
+//-- Frame header bytes needed, given the ones read so far
+static inline UINT8 _headLen(const UINT8 *head, UINT8 have)
+{
+    if (have < 2)
+        return 2;
+    UINT8 len7 = head[1] & 0x7F;
+    return 2 + (len7 == 126 ? 2 : (len7 == 127 ? 8 : 0)) + ((head[1] & WS_MASKED) ? 4 : 0);
+}
+
+//---------------------------------------------------------------------------------
+WsClientTable::WsClientTable()
+    : _slots(NULL), _open(0), _now(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+//---------------------------------------------------------------------------------
+void WsClientTable::begin(BridgeTcp *tcp, UINT16 port)
+{
+    if (tcp && port && !_slots)
+        _slots = new (std::nothrow) Conn[TCP_MAX_CLIENTS];
+    _conns.begin(_slots ? tcp : NULL, port);
+    _open = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+//---------------------------------------------------------------------------------
+UINT8 WsClientTable::poll(UINT32 now)
+{
+    _now = now;
+    UINT8 fresh = _conns.poll(now);
+    for (UINT8 i = 0; i < TCP_MAX_CLIENTS; i++)
+    {
+        if (!(fresh & (1 << i)))
+            continue;
+        memset(&_slots[i], 0, sizeof(_slots[i]));
+        _slots[i].since = now;
+        _open &= ~(1 << i);
+    }
+    return fresh;
+}
+
+//---------------------------------------------------------------------------------
+UINT8 WsClientTable::send(const UINT8 *buffer, UINT32 len, UINT32 now)
+{
+    _now = now;
+    UINT8 clients = _open & _conns.mask();
+    if (!clients)
+        return 0;
+    _stats.messages_out++;
+    return _frame(clients, WS_OP_BINARY, buffer, len);
+}
+
+//---------------------------------------------------------------------------------
+void WsClientTable::flush(UINT32 now)
+{
+    _now = now;
+    _conns.flush(now);
+    for (UINT8 i = 0; i < TCP_MAX_CLIENTS; i++)
+    {
+        if (!(_conns.mask() & (1 << i)))
+            continue;
+        if (_slots[i].state == WS_HTTP && (now - _slots[i].since) >= WS_HANDSHAKE_TIMEOUT)
+        {
+            _stats.bad_requests++;
+            _conns.close(i);
+        }
+        else if (_slots[i].state == WS_CLOSING && _conns.queued(i) == 0)
+            _conns.close(i);
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- The request and control frames give nothing to hand on, so keep reading
+//   until there is payload, up to len bytes in all
+UINT32 WsClientTable::read(UINT8 slot, UINT8 *buffer, UINT32 len)
+{
+    UINT32 out = 0;
+    UINT32 total = 0;
+    while (out == 0 && total < len && (_conns.mask() & (1 << slot)))
+    {
+        UINT32 n = _conns.read(slot, buffer, len - total);
+        if (n == 0)
+            break;
+        total += n;
+        UINT32 in = 0;
+        if (_slots[slot].state == WS_HTTP)
+            in = _request(slot, buffer, n);
+        if (_slots[slot].state == WS_OPEN)
+            out = _frames(slot, buffer, in, n);
+    }
+    return out;
+}
+
+//---------------------------------------------------------------------------------
+//-- Reads the upgrade request line by line, returns the bytes it took
+UINT32 WsClientTable::_request(UINT8 slot, const UINT8 *in, UINT32 len)
+{
+    Conn &c = _slots[slot];
+    for (UINT32 i = 0; i < len; i++)
+    {
+        char ch = in[i];
+        if (ch == '\r')
+            continue;
+        if (ch != '\n')
+        {
+            if (c.line_len < WS_LINE_SIZE - 1)
+                c.line[c.line_len++] = ch;
+            continue;
+        }
+        c.line[c.line_len] = 0;
+        if (c.line_len == 0)
+        {
+            _upgrade(slot);
+            return i + 1;
+        }
+        _header(c);
+        c.line_len = 0;
+    }
+    return len;
+}
+
+//---------------------------------------------------------------------------------
+void WsClientTable::_header(Conn &c)
+{
+    const char *value;
+    if (!(c.request & WS_REQ_LINE))
+    {
+        c.request |= WS_REQ_LINE;
+        const char *rest = _match(c.line, "get " WS_PATH);
+        if (rest && (*rest == ' ' || *rest == '?'))
+            c.request |= WS_REQ_PATH;
+    }
+    else if ((value = _value(c.line, "upgrade")) != NULL && _match(value, "websocket"))
+    {
+        c.request |= WS_REQ_UPGRADE;
+    }
+    else if ((value = _value(c.line, "sec-websocket-key")) != NULL && strlen(value) == WS_KEY_LEN)
+    {
+        memcpy(c.key, value, WS_KEY_LEN);
+        c.request |= WS_REQ_KEY;
+    }
+}
+
+//---------------------------------------------------------------------------------
+void WsClientTable::_upgrade(UINT8 slot)
+{
+    Conn &c = _slots[slot];
+    if (c.request != WS_REQ_ALL)
+    {
+        static const char kBadRequest[] = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+        _stats.bad_requests++;
+        _conns.send(1 << slot, NULL, 0, (const UINT8 *)kBadRequest, sizeof(kBadRequest) - 1, _now);
+        _hangUp(slot);
+        return;
+    }
+    static const char kSwitching[] = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ";
+    char response[sizeof(kSwitching) + 32];
+    UINT32 len = sizeof(kSwitching) - 1;
+    memcpy(response, kSwitching, len);
+    _acceptKey(c.key, &response[len]);
+    len += 28;
+    memcpy(&response[len], "\r\n\r\n", 4);
+    len += 4;
+    _conns.send(1 << slot, NULL, 0, (const UINT8 *)response, len, _now);
+    c.state = WS_OPEN;
+    c.head_len = 0;
+    _open |= 1 << slot;
+    _stats.upgraded++;
+}
+
+//---------------------------------------------------------------------------------
+//-- Parses frames from buffer[in] on and moves the unmasked payload of data
+//   frames to the start of buffer (it never gets ahead of the input). Returns
+//   the payload bytes.
+UINT32 WsClientTable::_frames(UINT8 slot, UINT8 *buffer, UINT32 in, UINT32 len)
+{
+    Conn &c = _slots[slot];
+    UINT32 out = 0;
+    while (in < len)
+    {
+        if (c.head_len < _headLen(c.head, c.head_len))
+        {
+            c.head[c.head_len++] = buffer[in++];
+            if (c.head_len == _headLen(c.head, c.head_len) && !_frameStart(slot))
+                return out;
+            continue;
+        }
+        UINT32 n = len - in;
+        if (n > c.remaining)
+            n = c.remaining;
+        const UINT8 *key = &c.head[c.head_len - 4];
+        UINT8 opcode = c.head[0] & 0x0F;
+        if (opcode & 0x08)
+        {
+            for (UINT32 i = 0; i < n; i++)
+                c.control[c.control_len++] = buffer[in++] ^ key[c.key_pos++ & 3];
+        }
+        else
+        {
+            for (UINT32 i = 0; i < n; i++)
+                buffer[out++] = buffer[in++] ^ key[c.key_pos++ & 3];
+        }
+        c.remaining -= n;
+        if (c.remaining == 0)
+        {
+            c.head_len = 0;
+            if (opcode & 0x08)
+            {
+                _control(slot, opcode);
+                if (c.state != WS_OPEN)
+                    return out;
+            }
+        }
+    }
+    return out;
+}
+
+//---------------------------------------------------------------------------------
+//-- A whole frame header is in: check it and set up for the payload. False
+//   when the connection is closing.
+bool WsClientTable::_frameStart(UINT8 slot)
+{
+    Conn &c = _slots[slot];
+    UINT8 opcode = c.head[0] & 0x0F;
+    UINT8 len7 = c.head[1] & 0x7F;
+    UINT32 len = len7;
+    if (len7 == 126)
+        len = ((UINT32)c.head[2] << 8) | c.head[3];
+    else if (len7 == 127)
+    {
+        if (c.head[2] | c.head[3] | c.head[4] | c.head[5])
+        {
+            _fail(slot, WS_CLOSE_TOO_BIG);
+            return false;
+        }
+        len = ((UINT32)c.head[6] << 24) | ((UINT32)c.head[7] << 16) | ((UINT32)c.head[8] << 8) | c.head[9];
+    }
+    bool control = (opcode & 0x08) != 0;
+    bool known = opcode <= WS_OP_BINARY || (opcode >= WS_OP_CLOSE && opcode <= WS_OP_PONG);
+    if (!known || (c.head[0] & 0x70) || !(c.head[1] & WS_MASKED) ||
+        (control && (len > WS_CONTROL_MAX || !(c.head[0] & WS_FIN))))
+    {
+        _fail(slot, WS_CLOSE_PROTOCOL);
+        return false;
+    }
+    if (!control)
+        _stats.messages_in++;
+    c.remaining = len;
+    c.key_pos = 0;
+    c.control_len = 0;
+    if (len == 0)
+    {
+        c.head_len = 0;
+        if (control)
+            _control(slot, opcode);
+    }
+    return c.state == WS_OPEN;
+}
+
+//---------------------------------------------------------------------------------
+void WsClientTable::_control(UINT8 slot, UINT8 opcode)
+{
+    Conn &c = _slots[slot];
+    if (opcode == WS_OP_PING)
+    {
+        _stats.pings++;
+        _frame(1 << slot, WS_OP_PONG, c.control, c.control_len);
+    }
+    else if (opcode == WS_OP_CLOSE)
+    {
+        //-- Echo the status code, then hang up
+        _stats.closes++;
+        _frame(1 << slot, WS_OP_CLOSE, c.control, c.control_len < 2 ? c.control_len : 2);
+        _hangUp(slot);
+    }
+}
+
+//---------------------------------------------------------------------------------
+void WsClientTable::_fail(UINT8 slot, UINT16 code)
+{
+    UINT8 status[2] = {(UINT8)(code >> 8), (UINT8)code};
+    _stats.protocol_errors++;
+    _frame(1 << slot, WS_OP_CLOSE, status, sizeof(status));
+    _hangUp(slot);
+}
+
+//---------------------------------------------------------------------------------
+//-- Closing at once would throw away a Close still waiting behind queued
+//   messages. No more data either way: what the client sends from now on is
+//   read and dropped, and flush() closes once the queue is out (or the
+//   connection stalls).
+void WsClientTable::_hangUp(UINT8 slot)
+{
+    _slots[slot].state = WS_CLOSING;
+    _open &= ~(1 << slot);
+    if (_conns.queued(slot) == 0)
+        _conns.close(slot);
+}
+
+//---------------------------------------------------------------------------------
+//-- An unfragmented server frame: the header goes in front of the caller's
+//   buffer on the wire, not into it
+UINT8 WsClientTable::_frame(UINT8 clients, UINT8 opcode, const UINT8 *buffer, UINT32 len)
+{
+    UINT8 head[WS_HEADER_MAX];
+    UINT32 head_len = 2;
+    head[0] = WS_FIN | opcode;
+    if (len < 126)
+        head[1] = len;
+    else
+    {
+        head[1] = 126;
+        head[2] = len >> 8;
+        head[3] = len & 0xFF;
+        head_len = 4;
+    }
+    return _conns.send(clients, head, head_len, buffer, len, _now);
+}
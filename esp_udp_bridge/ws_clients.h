@@ -0,0 +1,143 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file ws_clients.h
+ * ESP8266 Wifi AP, UART/UDP Bridge
+ *
+ * Browser clients on a binary WebSocket (WIFI_WS_PORT, path WS_PATH). The
+ * connections are a TcpClientTable of their own, so a WebSocket client gets
+ * the same treatment as a TCP one: the downlink is written straight from
+ * the datagram buffer, behind a 2 to 4 byte frame header, and a client that
+ * falls behind has whole messages trimmed and is dropped when it stalls.
+ * Every downlink datagram is one binary message. Data frames from the
+ * client are unmasked in the read buffer and handed on as a byte stream,
+ * so a MAVLink frame may span messages; ping, pong and close are answered
+ * here.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef WS_CLIENTS_H
+#define WS_CLIENTS_H
+
+#include "common.h"
+#include "tcp_clients.h"
+
+#define WS_HEADER_MAX           4       // Server frames, up to 65535 bytes of payload
+#define WS_LINE_SIZE            96      // Request line or header kept; longer ones are cut
+#define WS_KEY_LEN              24      // Sec-WebSocket-Key, base64 of 16 bytes
+#define WS_CONTROL_MAX          125
+
+static_assert(TCP_TX_QUEUE_SIZE >= WS_HEADER_MAX + PACKET_BUFFER_SIZE, "TCP_TX_QUEUE_SIZE must hold a whole message");
+
+struct WsStats
+{
+    UINT32  upgraded;
+    UINT32  bad_requests;       // Not a WebSocket upgrade for WS_PATH, or too slow to send one
+    UINT32  protocol_errors;
+    UINT32  closes;             // Close frames from clients
+    UINT32  pings;
+    UINT32  messages_in;        // Data frames
+    UINT32  messages_out;       // Downlink datagrams, to all clients
+};
+
+class WsClientTable
+{
+public:
+    WsClientTable();
+
+    //-- tcp == NULL, port 0, a port that cannot be opened or no memory for
+    //   the connections leaves WebSockets off
+    void            begin       (BridgeTcp *tcp, UINT16 port);
+    bool            enabled     () const { return _conns.enabled(); }
+    //-- Takes new connections, returns the mask of slots that got one
+    UINT8           poll        (UINT32 now);
+    //-- One binary message to every client past the handshake, returns how
+    //   many took it
+    UINT8           send        (const UINT8 *buffer, UINT32 len, UINT32 now);
+    //-- Writes out what is queued, drops stalled clients and slow handshakes,
+    //   and closes connections that are done sending their Close
+    void            flush       (UINT32 now);
+    //-- Reads up to len bytes from the connection and returns the payload of
+    //   data frames among them, unmasked in place at the start of buffer
+    UINT32          read        (UINT8 slot, UINT8 *buffer, UINT32 len);
+
+    UINT8           mask        () const { return _conns.mask(); }
+    bool            open        (UINT8 slot) const { return (_open & _conns.mask() & (1 << slot)) != 0; }
+    const TcpClientTable &connections() const { return _conns; }
+    const WsStats  &getStats    () const { return _stats; }
+
+private:
+    enum
+    {
+        WS_HTTP = 0,            // Reading the upgrade request
+        WS_OPEN,
+        WS_CLOSING              // Sending what is queued, then closing
+    };
+
+    struct Conn
+    {
+        UINT8   state;
+        UINT8   request;        // WS_REQ_* seen so far
+        UINT8   line_len;
+        UINT8   head_len;       // Frame header bytes read
+        UINT8   head[14];
+        UINT8   control_len;
+        UINT8   key_pos;
+        UINT32  remaining;      // Payload bytes of the frame still to come
+        UINT32  since;          // millis() at accept
+        char    key[WS_KEY_LEN];
+        union
+        {
+            char    line[WS_LINE_SIZE];             // While in WS_HTTP
+            UINT8   control[WS_CONTROL_MAX];        // Once open
+        };
+    };
+
+    UINT32          _request    (UINT8 slot, const UINT8 *in, UINT32 len);
+    void            _header     (Conn &c);
+    void            _upgrade    (UINT8 slot);
+    UINT32          _frames     (UINT8 slot, UINT8 *buffer, UINT32 in, UINT32 len);
+    bool            _frameStart (UINT8 slot);
+    void            _control    (UINT8 slot, UINT8 opcode);
+    void            _fail       (UINT8 slot, UINT16 code);
+    void            _hangUp     (UINT8 slot);
+    UINT8           _frame      (UINT8 clients, UINT8 opcode, const UINT8 *buffer, UINT32 len);
+
+private:
+    TcpClientTable  _conns;
+    Conn           *_slots;     // TCP_MAX_CLIENTS of them, from the first begin() with a port
+    UINT8           _open;      // Slots past the handshake
+    UINT32          _now;
+    WsStats         _stats;
+};
+
+#endif
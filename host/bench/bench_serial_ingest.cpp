@@ -0,0 +1,152 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file bench_serial_ingest.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Feeds a MAVLink v2 stream into the serial side of the bridge at UART
+ * line rate (virtual time) and reports how many bytes per second reach
+ * UDP, how many the receive buffer overran, and the host CPU cost per
+ * byte of the ingestion path.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "common.h"
+#include "parameters.h"
+#include "bridge.h"
+#include "sim_transport.h"
+
+#include <chrono>
+#include <vector>
+
+//-- Simulated time between two loop() passes (WiFi stack, HTTP, ...)
+#define LOOP_PERIOD_US      500
+#define RUN_SECONDS         10
+
+//---------------------------------------------------------------------------------
+//-- A MAVLink v2 like stream: frames of varying payload length, with zeros
+static std::vector<UINT8> make_stream(UINT32 len)
+{
+    std::vector<UINT8> s;
+    UINT32 seed = 12345;
+    UINT8 seq = 0;
+    while (s.size() < len)
+    {
+        seed = seed * 1103515245 + 12345;
+        UINT8 plen = 8 + (seed >> 16) % 60;
+        size_t start = s.size();
+        s.push_back(MAVLINK_STX_V2);
+        s.push_back(plen);
+        s.push_back(0);
+        s.push_back(0);
+        s.push_back(seq++);
+        s.push_back(1);
+        s.push_back(1);
+        s.push_back(plen & 0x7F);
+        s.push_back(0);
+        s.push_back(0);
+        for (UINT32 i = 0; i < (UINT32)plen; i++)
+            s.push_back((i & 3) ? (UINT8)(seed >> (i & 15)) : 0);
+        //-- A valid checksum, or the framer passes the frame on as raw bytes
+        UINT8 extra = 0;
+        Mavlink_crcExtra(plen & 0x7F, extra);
+        UINT16 crc = Mavlink_crc(&s[start + 1], s.size() - start - 1);
+        crc = Mavlink_crc(&extra, 1, crc);
+        s.push_back(crc & 0xFF);
+        s.push_back(crc >> 8);
+    }
+    s.resize(len);
+    return s;
+}
+
+//---------------------------------------------------------------------------------
+static void run(UINT32 baud)
+{
+    SimSerial serial;
+    SimUdp udp;
+    ESP8266Bridge bridge(&serial, &udp);
+
+    HostClock_setVirtual(true);
+    resetToDefaults();
+    bridge.begin(0, DEFAULT_UDP_HPORT, DEFAULT_UDP_CPORT, baud);
+    //-- One uplink datagram registers the simulated GCS as a client
+    const UINT8 hello[] = "bench";
+    udp.inject(hello, sizeof(hello));
+    bridge.udp_readMessageRaw();
+
+    UINT32 bytes_per_sec = baud / 10;
+    UINT64 total = (UINT64)bytes_per_sec * RUN_SECONDS;
+    std::vector<UINT8> stream = make_stream(total);
+
+    UINT64 fed = 0;
+    UINT64 credit = 0;
+    std::chrono::nanoseconds cpu(0);
+    while (fed < total)
+    {
+        HostClock_advance(LOOP_PERIOD_US);
+        credit += (UINT64)LOOP_PERIOD_US * bytes_per_sec;
+        UINT64 n = credit / 1000000ULL;
+        credit -= n * 1000000ULL;
+        if (n > total - fed)
+            n = total - fed;
+        serial.feed(&stream[fed], n);
+        fed += n;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bridge.serial_readMessageRaw();
+        cpu += std::chrono::steady_clock::now() - start;
+    }
+    //-- Let the queue timeout send the tail
+    for (int i = 0; i < 100; i++)
+    {
+        HostClock_advance(LOOP_PERIOD_US);
+        bridge.serial_readMessageRaw();
+    }
+
+    double ns_per_byte = (double)cpu.count() / (double)(udp.bytes ? udp.bytes : 1);
+    printf("%u,%u,%.0f,%llu,%llu,%.2f,%.0f\n",
+           baud, bytes_per_sec,
+           (double)udp.bytes / RUN_SECONDS,
+           (unsigned long long)serial.overrun,
+           (unsigned long long)udp.datagrams,
+           ns_per_byte,
+           1e9 / ns_per_byte);
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    printf("baud,line_bytes_per_s,ingested_bytes_per_s,overrun_bytes,datagrams,host_ns_per_byte,host_max_bytes_per_s\n");
+    run(460800);
+    run(921600);
+    return 0;
+}
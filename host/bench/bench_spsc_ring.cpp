@@ -0,0 +1,137 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file bench_spsc_ring.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Host throughput of SpscRing for the ways the bridge uses it: copying in
+ * and out at UART read and datagram sizes, working in place on spans, and
+ * a producer and consumer on two threads.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "spsc_ring.h"
+
+#include <chrono>
+#include <thread>
+
+#define RING_SIZE       2048
+#define BENCH_BYTES     (256ULL * 1024 * 1024)
+
+static SpscRing<RING_SIZE> ring;
+static UINT8 chunk[RING_SIZE];
+static volatile UINT32 sink;
+
+//---------------------------------------------------------------------------------
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//---------------------------------------------------------------------------------
+static void report(const char *mode, UINT32 size, double seconds)
+{
+    printf("%s,%u,%.1f,%.2f\n", mode, size,
+           (double)BENCH_BYTES / seconds / 1e6,
+           seconds * 1e9 / (double)BENCH_BYTES);
+}
+
+//---------------------------------------------------------------------------------
+//-- write() then read(): two copies per byte
+static void bench_copy(UINT32 size)
+{
+    ring.reset();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (UINT64 done = 0; done < BENCH_BYTES; done += size)
+    {
+        ring.write(chunk, size);
+        ring.read(chunk, size);
+    }
+    report("copy", size, seconds_since(start));
+}
+
+//---------------------------------------------------------------------------------
+//-- Producer fills the write span, consumer looks at the read span in place
+static void bench_span(UINT32 size)
+{
+    ring.reset();
+    UINT32 sum = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    UINT32 len;
+    for (UINT64 done = 0; done < BENCH_BYTES; done += len)
+    {
+        UINT8 *wspan = ring.writeSpan(len);
+        if (len > size)
+            len = size;
+        memset(wspan, (int)done, len);
+        ring.commit(len);
+        const UINT8 *rspan = ring.readSpan(len);
+        sum += rspan[0] + rspan[len - 1];
+        ring.consume(len);
+    }
+    sink = sum;
+    report("span", size, seconds_since(start));
+}
+
+//---------------------------------------------------------------------------------
+//-- Producer and consumer on their own threads, copying chunks in and out
+static void bench_threads(UINT32 size)
+{
+    ring.reset();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::thread producer([size]() {
+        static UINT8 in[RING_SIZE];
+        for (UINT64 sent = 0; sent < BENCH_BYTES; )
+            sent += ring.write(in, size);
+    });
+    for (UINT64 received = 0; received < BENCH_BYTES; )
+        received += ring.read(chunk, size);
+    producer.join();
+    report("threads", size, seconds_since(start));
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    static const UINT32 sizes[] = { 1, 64, 256, 1472 };
+    printf("mode,chunk_bytes,mb_per_s,ns_per_byte\n");
+    for (UINT32 i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        bench_copy(sizes[i]);
+    for (UINT32 i = 1; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        bench_span(sizes[i]);
+    //-- With one core the two sides only take turns
+    if (std::thread::hardware_concurrency() < 2)
+        return 0;
+    for (UINT32 i = 1; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        bench_threads(sizes[i]);
+    return 0;
+}
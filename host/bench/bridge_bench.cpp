@@ -0,0 +1,678 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file bridge_bench.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * End-to-end throughput and latency benchmark. It plays both the GCS (UDP
+ * or TCP) and the autopilot (serial port) and sends timestamped MAVLink v2
+ * frames through the bridge:
+ *
+ *   up    GCS -> bridge -> serial   one-way latency
+ *   down  serial -> bridge -> GCS   one-way latency
+ *   rtt   GCS -> bridge -> serial, echoed back -> bridge -> GCS
+ *
+ * The bridge is either real hardware (serial device + ESP address) or the
+ * host bridge, started once per transport and baud rate with --spawn.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "common.h"
+#include "mavlink_framer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define BENCH_MSGID             0x4E42      // Outside the common MAVLink ranges
+#define BENCH_SYSID             0xBE
+#define BENCH_MAGIC             0x48434E42  // "BNCH"
+#define BENCH_HEADER_LEN        19          // magic, seq, direction, run, send time
+#define BENCH_DRAIN_NS          500000000ULL
+#define BENCH_KEEPALIVE_NS      1000000000ULL   // Keeps the bench in the bridge's client table
+#define BENCH_LINK              "/tmp/esp_udp_bridge_bench"
+
+enum
+{
+    DIR_UP = 0,
+    DIR_DOWN,
+    DIR_RTT,
+    DIR_COUNT
+};
+
+static const char *kDirNames[DIR_COUNT] = {"up", "down", "rtt"};
+
+enum
+{
+    GCS_UDP = 0,
+    GCS_TCP,
+    GCS_COUNT
+};
+
+static const char *kTransportNames[GCS_COUNT] = {"udp", "tcp"};
+
+//-- The GCS end of the bridge, over one transport
+struct Gcs
+{
+    UINT8 transport;
+    int fd;
+    struct sockaddr_in bridge;
+};
+
+struct Options
+{
+    const char *serial;
+    const char *host;
+    UINT16 port;
+    UINT16 tcp_port;
+    const char *spawn;
+    std::vector<UINT8> transports;
+    std::vector<UINT32> bauds;
+    std::vector<UINT32> sizes;
+    std::vector<UINT32> rates;
+    std::vector<UINT8> dirs;
+    double duration;
+    bool json;
+};
+
+struct Result
+{
+    UINT16 run;
+    UINT8 transport;
+    UINT32 baud;
+    UINT32 size;
+    UINT32 rate;
+    UINT8 dir;
+    UINT64 sent;
+    UINT64 received;
+    UINT64 duplicates;
+    UINT64 bytes;
+    double seconds;
+    std::vector<double> latency_us;
+};
+
+//---------------------------------------------------------------------------------
+static UINT64 now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//---------------------------------------------------------------------------------
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --serial <dev>      Serial port wired to the bridge UART\n"
+            "  --host <ip>         Bridge address (default 127.0.0.1)\n"
+            "  --port <port>       Bridge UDP port (default %u)\n"
+            "  --tcp-port <port>   Bridge TCP port, WIFI_TCP_PORT (default 5760)\n"
+            "  --transport <list>  udp and/or tcp (default udp)\n"
+            "  --spawn <binary>    Start esp_udp_bridge_host for every transport and baud rate\n"
+            "  --baud <list>       Baud rates, comma separated (default 115200)\n"
+            "  --size <list>       MAVLink payload sizes, %u..255 (default 32,128,255)\n"
+            "  --rate <list>       Offered frames per second (default 50,200)\n"
+            "  --mode <list>       up, down and/or rtt (default up,down,rtt)\n"
+            "  --duration <s>      Seconds per point (default 3)\n"
+            "  --json              JSON instead of CSV\n",
+            name, DEFAULT_UDP_CPORT, BENCH_HEADER_LEN);
+}
+
+//---------------------------------------------------------------------------------
+static std::vector<UINT32> parse_list(const char *arg)
+{
+    std::vector<UINT32> list;
+    std::string s(arg);
+    size_t pos = 0;
+    while (pos <= s.size())
+    {
+        size_t end = s.find(',', pos);
+        if (end == std::string::npos)
+            end = s.size();
+        if (end > pos)
+            list.push_back(strtoul(s.substr(pos, end - pos).c_str(), NULL, 10));
+        pos = end + 1;
+    }
+    return list;
+}
+
+//---------------------------------------------------------------------------------
+static speed_t baud_constant(UINT32 baud)
+{
+    switch (baud)
+    {
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+    default: return B115200;
+    }
+}
+
+//---------------------------------------------------------------------------------
+static int open_serial(const char *path, UINT32 baud)
+{
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+        return -1;
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        cfsetspeed(&tio, baud_constant(baud));
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+//---------------------------------------------------------------------------------
+static void write_all(int fd, const UINT8 *buffer, UINT32 len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, buffer, len);
+        if (n > 0)
+        {
+            buffer += n;
+            len -= n;
+        }
+        else if (n < 0 && errno == EAGAIN)
+        {
+            struct pollfd p = {fd, POLLOUT, 0};
+            poll(&p, 1, 10);
+        }
+        else if (n < 0 && errno != EINTR)
+            return;
+    }
+}
+
+//---------------------------------------------------------------------------------
+static pid_t spawn_bridge(const char *binary, UINT16 port, UINT16 tcp_port, UINT32 baud)
+{
+    char port_arg[16];
+    char tcp_arg[16];
+    char baud_arg[16];
+    snprintf(port_arg, sizeof(port_arg), "%u", port);
+    snprintf(tcp_arg, sizeof(tcp_arg), "%u", tcp_port);
+    snprintf(baud_arg, sizeof(baud_arg), "%u", baud);
+    unlink(BENCH_LINK);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        if (tcp_port)
+            execl(binary, binary, "--port", port_arg, "--tcp-port", tcp_arg, "--baud", baud_arg, "--link", BENCH_LINK, (char *)NULL);
+        else
+            execl(binary, binary, "--port", port_arg, "--baud", baud_arg, "--link", BENCH_LINK, (char *)NULL);
+        _exit(127);
+    }
+    //-- Wait for the pty link to show up
+    struct stat st;
+    for (int i = 0; i < 200 && lstat(BENCH_LINK, &st) != 0; i++)
+        usleep(10000);
+    return pid;
+}
+
+//---------------------------------------------------------------------------------
+//-- Non-blocking socket to the bridge. TCP connects right away, with Nagle
+//   off like the bridge end; a spawned bridge may need a moment to listen.
+static bool open_gcs(Gcs &gcs, const Options &opt, UINT8 transport)
+{
+    gcs.transport = transport;
+    memset(&gcs.bridge, 0, sizeof(gcs.bridge));
+    gcs.bridge.sin_family = AF_INET;
+    gcs.bridge.sin_port = htons(transport == GCS_TCP ? opt.tcp_port : opt.port);
+    inet_pton(AF_INET, opt.host, &gcs.bridge.sin_addr);
+    if (transport == GCS_UDP)
+    {
+        gcs.fd = socket(AF_INET, SOCK_DGRAM, 0);
+    }
+    else
+    {
+        gcs.fd = -1;
+        for (int i = 0; i < 200 && gcs.fd < 0; i++)
+        {
+            gcs.fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (connect(gcs.fd, (const struct sockaddr *)&gcs.bridge, sizeof(gcs.bridge)) < 0)
+            {
+                close(gcs.fd);
+                gcs.fd = -1;
+                usleep(10000);
+            }
+        }
+        if (gcs.fd < 0)
+            return false;
+        int one = 1;
+        setsockopt(gcs.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    fcntl(gcs.fd, F_SETFL, fcntl(gcs.fd, F_GETFL) | O_NONBLOCK);
+    return gcs.fd >= 0;
+}
+
+//---------------------------------------------------------------------------------
+static void gcs_send(const Gcs &gcs, const void *buffer, UINT32 len)
+{
+    if (gcs.transport == GCS_TCP)
+        write_all(gcs.fd, (const UINT8 *)buffer, len);
+    else
+        sendto(gcs.fd, buffer, len, 0, (const struct sockaddr *)&gcs.bridge, sizeof(gcs.bridge));
+}
+
+//---------------------------------------------------------------------------------
+//-- One timestamped MAVLink v2 frame. BENCH_MSGID is not a message the
+//   bridge knows, so any CRC_EXTRA passes; 0 is used.
+static UINT32 make_frame(UINT8 *frame, UINT16 run, UINT8 dir, UINT32 seq, UINT32 size)
+{
+    UINT64 t = now_ns();
+    UINT32 magic = BENCH_MAGIC;
+    frame[0] = MAVLINK_STX_V2;
+    frame[1] = size;
+    frame[2] = 0;
+    frame[3] = 0;
+    frame[4] = (UINT8)seq;
+    frame[5] = BENCH_SYSID;
+    frame[6] = dir;
+    frame[7] = BENCH_MSGID & 0xFF;
+    frame[8] = (BENCH_MSGID >> 8) & 0xFF;
+    frame[9] = 0;
+    UINT8 *payload = &frame[MAVLINK_V2_HEADER_LEN];
+    memcpy(&payload[0], &magic, 4);
+    memcpy(&payload[4], &seq, 4);
+    payload[8] = dir;
+    memcpy(&payload[9], &run, 2);
+    memcpy(&payload[11], &t, 8);
+    for (UINT32 i = BENCH_HEADER_LEN; i < size; i++)
+        payload[i] = (UINT8)(seq + i);
+    const UINT8 extra = 0;
+    UINT16 crc = Mavlink_crc(&frame[1], MAVLINK_V2_HEADER_LEN - 1 + size);
+    crc = Mavlink_crc(&extra, 1, crc);
+    frame[MAVLINK_V2_HEADER_LEN + size] = crc & 0xFF;
+    frame[MAVLINK_V2_HEADER_LEN + size + 1] = crc >> 8;
+    return MAVLINK_V2_HEADER_LEN + size + MAVLINK_CHECKSUM_LEN;
+}
+
+//---------------------------------------------------------------------------------
+//-- Account for one received frame if it is one of ours
+static bool take_frame(MavlinkFramer &framer, UINT16 &run, UINT8 &dir, UINT32 &seq, UINT64 &sent_ns)
+{
+    if (framer.length() < MAVLINK_V2_HEADER_LEN || !framer.isV2() || framer.msgId() != BENCH_MSGID ||
+        framer.sysId() != BENCH_SYSID || framer.payloadLen() < BENCH_HEADER_LEN)
+        return false;
+    const UINT8 *payload = framer.payload();
+    UINT32 magic;
+    memcpy(&magic, &payload[0], 4);
+    if (magic != BENCH_MAGIC)
+        return false;
+    memcpy(&seq, &payload[4], 4);
+    dir = payload[8];
+    memcpy(&run, &payload[9], 2);
+    memcpy(&sent_ns, &payload[11], 8);
+    return dir < DIR_COUNT;
+}
+
+//---------------------------------------------------------------------------------
+static void record(Result &r, std::vector<bool> &seen, UINT32 seq, UINT64 sent_ns, UINT32 len)
+{
+    if (seq >= seen.size())
+        return;
+    if (seen[seq])
+    {
+        r.duplicates++;
+        return;
+    }
+    seen[seq] = true;
+    r.received++;
+    r.bytes += len;
+    r.latency_us.push_back((now_ns() - sent_ns) / 1000.0);
+}
+
+//---------------------------------------------------------------------------------
+static bool run_point(const Options &opt, int serial_fd, const Gcs &gcs, Result &r)
+{
+    UINT8 frame[MAVLINK_MAX_FRAME_LEN];
+    UINT8 buf[2048];
+    MavlinkFramer serial_framer;
+    MavlinkFramer gcs_framer;
+
+    //-- Tell the bridge where the GCS is (UDP), then throw away anything
+    //   stale. A TCP stream is drained at frame boundaries by the framer.
+    const char hello[] = "bench";
+    if (gcs.transport == GCS_UDP)
+        gcs_send(gcs, hello, sizeof(hello));
+    UINT64 settle = now_ns() + 200000000ULL;
+    while (now_ns() < settle)
+    {
+        while (read(serial_fd, buf, sizeof(buf)) > 0) {}
+        while (recv(gcs.fd, buf, sizeof(buf), 0) > 0) {}
+        usleep(1000);
+    }
+
+    UINT64 total = (UINT64)(opt.duration * r.rate);
+    std::vector<bool> seen(total, false);
+    UINT64 period = 1000000000ULL / r.rate;
+    UINT64 start = now_ns();
+    UINT64 next = start;
+    UINT64 stop = start + (UINT64)(opt.duration * 1e9);
+    UINT64 keepalive = start + BENCH_KEEPALIVE_NS;
+
+    while (true)
+    {
+        UINT64 now = now_ns();
+        if (now >= keepalive)
+        {
+            if (gcs.transport == GCS_UDP)
+                gcs_send(gcs, hello, sizeof(hello));
+            keepalive += BENCH_KEEPALIVE_NS;
+        }
+        if (r.sent < total && now >= next)
+        {
+            UINT32 len = make_frame(frame, r.run, r.dir, r.sent, r.size);
+            if (r.dir == DIR_DOWN)
+                write_all(serial_fd, frame, len);
+            else
+                gcs_send(gcs, frame, len);
+            r.sent++;
+            next += period;
+            continue;
+        }
+        if (r.received == total || now > stop + BENCH_DRAIN_NS)
+            break;
+
+        struct pollfd fds[2] = {{serial_fd, POLLIN, 0}, {gcs.fd, POLLIN, 0}};
+        int timeout = (r.sent < total && next > now) ? (int)((next - now) / 1000000ULL) : 1;
+        poll(fds, 2, timeout);
+
+        if (fds[0].revents & POLLIN)
+        {
+            ssize_t n = read(serial_fd, buf, sizeof(buf));
+            const UINT8 *p = buf;
+            while (n > 0)
+            {
+                UINT8 result;
+                UINT32 used = serial_framer.parse(p, n, result);
+                p += used;
+                n -= used;
+                UINT16 run;
+                UINT8 dir;
+                UINT32 seq;
+                UINT64 sent_ns;
+                //-- Frames still in flight from earlier points are ignored
+                if (result != FRAMER_FRAME || !take_frame(serial_framer, run, dir, seq, sent_ns) || run != r.run)
+                    continue;
+                if (dir == DIR_RTT)
+                    //-- Play the autopilot: answer right away
+                    write_all(serial_fd, serial_framer.data(), serial_framer.length());
+                else if (dir == DIR_UP && r.dir == DIR_UP)
+                    record(r, seen, seq, sent_ns, serial_framer.length());
+            }
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            ssize_t n;
+            while ((n = recv(gcs.fd, buf, sizeof(buf), 0)) > 0)
+            {
+                const UINT8 *p = buf;
+                while (n > 0)
+                {
+                    UINT8 result;
+                    UINT32 used = gcs_framer.parse(p, n, result);
+                    p += used;
+                    n -= used;
+                    UINT16 run;
+                    UINT8 dir;
+                    UINT32 seq;
+                    UINT64 sent_ns;
+                    if (result == FRAMER_FRAME && take_frame(gcs_framer, run, dir, seq, sent_ns) &&
+                        run == r.run && dir == r.dir)
+                        record(r, seen, seq, sent_ns, gcs_framer.length());
+                }
+            }
+        }
+    }
+    r.seconds = (now_ns() - start) / 1e9;
+    std::sort(r.latency_us.begin(), r.latency_us.end());
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+//---------------------------------------------------------------------------------
+static void print_result(const Result &r, bool json, bool first)
+{
+    double loss = r.sent ? 100.0 * (r.sent - r.received) / r.sent : 0;
+    double throughput = r.seconds > 0 ? r.bytes / r.seconds : 0;
+    double p50 = percentile(r.latency_us, 0.50);
+    double p99 = percentile(r.latency_us, 0.99);
+    double p999 = percentile(r.latency_us, 0.999);
+    double max = r.latency_us.empty() ? 0 : r.latency_us.back();
+    if (json)
+    {
+        printf("%s\n    {\"transport\": \"%s\", \"baud\": %u, \"size\": %u, \"rate\": %u, \"mode\": \"%s\", "
+               "\"sent\": %llu, \"received\": %llu, \"duplicates\": %llu, \"loss_pct\": %.3f, "
+               "\"throughput_Bps\": %.0f, \"p50_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f, \"max_us\": %.1f}",
+               first ? "" : ",", kTransportNames[r.transport], r.baud, r.size, r.rate, kDirNames[r.dir],
+               (unsigned long long)r.sent, (unsigned long long)r.received, (unsigned long long)r.duplicates,
+               loss, throughput, p50, p99, p999, max);
+    }
+    else
+    {
+        printf("%s,%u,%u,%u,%s,%llu,%llu,%llu,%.3f,%.0f,%.1f,%.1f,%.1f,%.1f\n",
+               kTransportNames[r.transport], r.baud, r.size, r.rate, kDirNames[r.dir],
+               (unsigned long long)r.sent, (unsigned long long)r.received, (unsigned long long)r.duplicates,
+               loss, throughput, p50, p99, p999, max);
+    }
+    fflush(stdout);
+}
+
+//---------------------------------------------------------------------------------
+static bool parse_args(int argc, char *argv[], Options &opt)
+{
+    opt.serial = NULL;
+    opt.host = "127.0.0.1";
+    opt.port = DEFAULT_UDP_CPORT;
+    opt.tcp_port = 5760;
+    opt.spawn = NULL;
+    opt.bauds = parse_list("115200");
+    opt.sizes = parse_list("32,128,255");
+    opt.rates = parse_list("50,200");
+    opt.duration = 3;
+    opt.json = false;
+    const char *modes = "up,down,rtt";
+    const char *transports = "udp";
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (!strcmp(arg, "--json"))
+        {
+            opt.json = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return false;
+        const char *val = argv[++i];
+        if (!strcmp(arg, "--serial"))
+            opt.serial = val;
+        else if (!strcmp(arg, "--host"))
+            opt.host = val;
+        else if (!strcmp(arg, "--port"))
+            opt.port = atoi(val);
+        else if (!strcmp(arg, "--tcp-port"))
+            opt.tcp_port = atoi(val);
+        else if (!strcmp(arg, "--transport"))
+            transports = val;
+        else if (!strcmp(arg, "--spawn"))
+            opt.spawn = val;
+        else if (!strcmp(arg, "--baud"))
+            opt.bauds = parse_list(val);
+        else if (!strcmp(arg, "--size"))
+            opt.sizes = parse_list(val);
+        else if (!strcmp(arg, "--rate"))
+            opt.rates = parse_list(val);
+        else if (!strcmp(arg, "--mode"))
+            modes = val;
+        else if (!strcmp(arg, "--duration"))
+            opt.duration = atof(val);
+        else
+            return false;
+    }
+
+    for (int d = 0; d < DIR_COUNT; d++)
+    {
+        if (strstr(modes, kDirNames[d]))
+            opt.dirs.push_back(d);
+    }
+    for (int t = 0; t < GCS_COUNT; t++)
+    {
+        if (strstr(transports, kTransportNames[t]))
+            opt.transports.push_back(t);
+    }
+    for (size_t i = 0; i < opt.sizes.size(); i++)
+    {
+        if (opt.sizes[i] < BENCH_HEADER_LEN || opt.sizes[i] > MAVLINK_MAX_PAYLOAD_LEN)
+            return false;
+    }
+    for (size_t i = 0; i < opt.rates.size(); i++)
+    {
+        if (opt.rates[i] == 0)
+            return false;
+    }
+    return (opt.serial || opt.spawn) && !opt.dirs.empty() && !opt.transports.empty() && opt.duration > 0;
+}
+
+//---------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    Options opt;
+    if (!parse_args(argc, argv, opt))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    if (opt.json)
+        printf("{\"results\": [");
+    else
+        printf("transport,baud,size,rate,mode,sent,received,duplicates,loss_pct,throughput_Bps,p50_us,p99_us,p999_us,max_us\n");
+
+    bool first = true;
+    UINT16 run = (UINT16)getpid();
+    for (size_t t = 0; t < opt.transports.size(); t++)
+    {
+        for (size_t b = 0; b < opt.bauds.size(); b++)
+        {
+            UINT8 transport = opt.transports[t];
+            pid_t child = -1;
+            const char *serial = opt.serial;
+            if (opt.spawn)
+            {
+                child = spawn_bridge(opt.spawn, opt.port, transport == GCS_TCP ? opt.tcp_port : 0, opt.bauds[b]);
+                serial = BENCH_LINK;
+            }
+            int serial_fd = open_serial(serial, opt.bauds[b]);
+            if (serial_fd < 0)
+            {
+                perror(serial);
+                return 1;
+            }
+            Gcs gcs;
+            if (!open_gcs(gcs, opt, transport))
+            {
+                perror(kTransportNames[transport]);
+                return 1;
+            }
+
+            for (size_t s = 0; s < opt.sizes.size(); s++)
+            {
+                for (size_t q = 0; q < opt.rates.size(); q++)
+                {
+                    for (size_t d = 0; d < opt.dirs.size(); d++)
+                    {
+                        Result r;
+                        r.run = run++;
+                        r.transport = transport;
+                        r.baud = opt.bauds[b];
+                        r.size = opt.sizes[s];
+                        r.rate = opt.rates[q];
+                        r.dir = opt.dirs[d];
+                        r.sent = r.received = r.duplicates = r.bytes = 0;
+                        r.seconds = 0;
+                        run_point(opt, serial_fd, gcs, r);
+                        print_result(r, opt.json, first);
+                        first = false;
+                    }
+                }
+            }
+
+            close(gcs.fd);
+            close(serial_fd);
+            if (child > 0)
+            {
+                kill(child, SIGTERM);
+                waitpid(child, NULL, 0);
+            }
+        }
+    }
+
+    if (opt.json)
+        printf("\n]}\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file sim_transport.h
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * In-memory transports for benchmarks: a UART whose receive side is fed
+ * by the benchmark and overruns like the ESP8266 buffer, and a UDP socket
+ * that records what the bridge sends.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef SIM_TRANSPORT_H
+#define SIM_TRANSPORT_H
+
+#include "transport.h"
+
+#include <deque>
+#include <vector>
+
+class SimSerial : public BridgeSerial
+{
+public:
+    SimSerial() : overrun(0), written(0), _overrun_seen(0) {}
+
+    //-- Bytes arriving on the line; whatever does not fit is lost
+    void feed(const UINT8 *buffer, UINT32 len)
+    {
+        for (UINT32 i = 0; i < len; i++)
+        {
+            if (_rx.size() < DEFAULT_RECEVE_BUFFER_SIZE)
+                _rx.push_back(buffer[i]);
+            else
+                overrun++;
+        }
+    }
+
+    void    begin               (UINT32) {}
+    UINT32  available           () { return _rx.size(); }
+    UINT32  read                (UINT8 *buffer, UINT32 len)
+    {
+        if (len > _rx.size())
+            len = _rx.size();
+        for (UINT32 i = 0; i < len; i++)
+        {
+            buffer[i] = _rx.front();
+            _rx.pop_front();
+        }
+        return len;
+    }
+    UINT32  availableForWrite   () { return 128; }
+    UINT32  write               (const UINT8 *, UINT32 len) { written += len; return len; }
+    UINT32  rxTime              () { return millis(); }
+    bool    hasRxError          () { return false; }
+    void    setFlowControl      (bool) {}
+    UINT32  detectBaudRate      () { return 0; }
+    bool    hasOverrun          ()
+    {
+        bool lost = overrun != _overrun_seen;
+        _overrun_seen = overrun;
+        return lost;
+    }
+
+    UINT64  overrun;
+    UINT64  written;
+
+private:
+    std::deque<UINT8> _rx;
+    UINT64  _overrun_seen;
+};
+
+class SimUdp : public BridgeUdp
+{
+public:
+    SimUdp() : datagrams(0), bytes(0), _pos(0) {}
+
+    void inject(const UINT8 *buffer, UINT32 len)
+    {
+        _in.push_back(std::vector<UINT8>(buffer, buffer + len));
+    }
+
+    bool    begin               (UINT16) { return true; }
+    UINT32  parsePacket         ()
+    {
+        _current.clear();
+        _pos = 0;
+        if (_in.empty())
+            return 0;
+        _current.swap(_in.front());
+        _in.pop_front();
+        return _current.size();
+    }
+    UINT32  read                (UINT8 *buffer, UINT32 len)
+    {
+        if (len > _current.size() - _pos)
+            len = _current.size() - _pos;
+        memcpy(buffer, &_current[_pos], len);
+        _pos += len;
+        return len;
+    }
+    UINT32  remoteIP            () { return 0x0101A8C0; } // 192.168.1.1
+    UINT16  remotePort          () { return 14550; }
+    UINT32  sendTo              (UINT32, UINT16, const UINT8 *, UINT32 len)
+    {
+        datagrams++;
+        bytes += len;
+        return len;
+    }
+    UINT32  sendTo              (UINT32 ip, UINT16 port, const UINT8 *, UINT32 header_len, const UINT8 *buffer, UINT32 len)
+    {
+        bytes += header_len;
+        return sendTo(ip, port, buffer, len) + header_len;
+    }
+
+    UINT64  datagrams;
+    UINT64  bytes;
+
+private:
+    std::deque<std::vector<UINT8> > _in;
+    std::vector<UINT8> _current;
+    UINT32  _pos;
+};
+
+#endif
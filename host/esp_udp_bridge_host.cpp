@@ -0,0 +1,272 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file esp_udp_bridge_host.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Runs the bridge core on Linux: POSIX sockets stand in for WiFiUDP and
+ * WiFiServer, and a pseudo terminal for the UART.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "common.h"
+#include "parameters.h"
+#include "bridge.h"
+#include "posix_tcp.h"
+#include "posix_udp.h"
+#include "pty_serial.h"
+#include "profiler.h"
+#include "scheduler.h"
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <signal.h>
+
+PtySerial               bridgeSerial;
+PosixUdp                bridgeUdp;
+PosixTcp                bridgeTcp;
+PosixTcp                bridgeWs;
+ESP8266Bridge           bridge(&bridgeSerial, &bridgeUdp, &bridgeTcp, &bridgeWs);
+Scheduler               scheduler;
+
+static volatile bool    running = true;
+
+//---------------------------------------------------------------------------------
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --port <port>     UDP port the bridge listens on (default %u)\n"
+            "  --tcp-port <port> Also accept TCP clients on this port\n"
+            "  --ws-port <port>  Also accept WebSocket clients on this port (path " WS_PATH ")\n"
+            "  --baud <rate>     Emulated UART baud rate, 0 for unpaced (default %u)\n"
+            "  --link <path>     Symlink to create for the serial side of the pty\n"
+            "  --qthreshold <n>  Outgoing queue threshold in bytes\n"
+            "  --qtimeout <ms>   Outgoing queue timeout\n"
+            "  --clients <n>     Max GCS clients the downlink is sent to\n"
+            "  --client-timeout <s>  Seconds before a silent client is dropped\n"
+            "  --tx-policy <n>   UART TX queue full: 0 drop newest, 1 drop oldest, 2 drop frames\n"
+            "  --autobaud        Find the rate from MAVLink traffic, starting at --baud\n"
+            "  --compress        LZF-compress downlink datagrams (read them through lz_proxy)\n"
+            "  --link-header     Sequenced link headers for clients that send them (lz_proxy --link-header)\n"
+            "  --reliable        Acknowledge uplink datagrams from clients that ask for it (lz_proxy --reliable)\n"
+            "  --fec <n>         Send a parity datagram after every n downlink datagrams (read them through lz_proxy)\n"
+            "  --rate-limit <msgid:Hz>  Forward at most Hz frames/s of a message (up to %u times)\n",
+            name, DEFAULT_UDP_CPORT, DEFAULT_UART_SPEED, RATE_LIMIT_SLOTS);
+}
+
+//---------------------------------------------------------------------------------
+static void on_signal(int)
+{
+    running = false;
+}
+
+//---------------------------------------------------------------------------------
+//-- Scheduler tasks, as in the sketch (there is no web server here)
+static void udpReadTask()
+{
+    PROFILE_START();
+    bridge.udp_readMessageRaw();
+    PROFILE_MARK(PROFILE_UDP_READ);
+}
+
+static void serialReadTask()
+{
+    PROFILE_START();
+    bridge.serial_readMessageRaw();
+    PROFILE_MARK(PROFILE_SERIAL_READ);
+}
+
+static void tcpReadTask()
+{
+    PROFILE_START();
+    bridge.tcp_readMessageRaw();
+    PROFILE_MARK(PROFILE_TCP_READ);
+}
+
+static void wsReadTask()
+{
+    PROFILE_START();
+    bridge.ws_readMessageRaw();
+    PROFILE_MARK(PROFILE_WS_READ);
+}
+
+static void housekeepingTask()
+{
+    PROFILE_START();
+    bridge.housekeeping();
+    PROFILE_MARK(PROFILE_HOUSEKEEPING);
+}
+
+//---------------------------------------------------------------------------------
+static bool setup(int argc, char *argv[])
+{
+    const char *link = NULL;
+    UINT8 limits = 0;
+
+    resetToDefaults();
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!strcmp(arg, "--autobaud"))
+        {
+            setUartAutoBaud(1);
+            continue;
+        }
+        if (!strcmp(arg, "--compress"))
+        {
+            setUdpCompress(1);
+            continue;
+        }
+        if (!strcmp(arg, "--link-header"))
+        {
+            setUdpLinkHeader(1);
+            continue;
+        }
+        if (!strcmp(arg, "--reliable"))
+        {
+            setUdpReliable(1);
+            continue;
+        }
+        if (!val)
+        {
+            usage(argv[0]);
+            return false;
+        }
+        if (!strcmp(arg, "--port"))
+            setWifiUdpCport(atoi(val));
+        else if (!strcmp(arg, "--tcp-port"))
+            setWifiTcpPort(atoi(val));
+        else if (!strcmp(arg, "--ws-port"))
+            setWifiWsPort(atoi(val));
+        else if (!strcmp(arg, "--baud"))
+            setUartBaudRate(atoi(val));
+        else if (!strcmp(arg, "--link"))
+            link = val;
+        else if (!strcmp(arg, "--qthreshold"))
+            setQueueThreshold(atoi(val));
+        else if (!strcmp(arg, "--qtimeout"))
+            setQueueTimeout(atoi(val));
+        else if (!strcmp(arg, "--clients"))
+            setMaxClients(atoi(val));
+        else if (!strcmp(arg, "--client-timeout"))
+            setClientTimeout(atoi(val));
+        else if (!strcmp(arg, "--tx-policy"))
+            setUartTxPolicy(atoi(val));
+        else if (!strcmp(arg, "--fec"))
+            setUdpFec(atoi(val));
+        else if (!strcmp(arg, "--rate-limit") && limits < RATE_LIMIT_SLOTS && RateLimiter::parseRule(val))
+            setRateLimit(limits++, RateLimiter::parseRule(val));
+        else
+        {
+            usage(argv[0]);
+            return false;
+        }
+        i++;
+    }
+
+    if (!bridgeSerial.open(link))
+    {
+        perror("pty");
+        return false;
+    }
+    printf("Serial: %s%s%s\n", bridgeSerial.slaveName(), link ? " -> " : "", link ? link : "");
+    printf("UDP port: %u\n", getWifiUdpCport());
+
+    bridge.begin(htonl(INADDR_BROADCAST), getWifiUdpHport(), getWifiUdpCport(), getUartBaudRate());
+    if (getWifiTcpPort())
+    {
+        if (!bridge.getTcpClients().enabled())
+        {
+            perror("tcp");
+            return false;
+        }
+        printf("TCP port: %u\n", getWifiTcpPort());
+    }
+    if (getWifiWsPort())
+    {
+        if (!bridge.getWsClients().enabled())
+        {
+            perror("ws");
+            return false;
+        }
+        printf("WebSocket: ws://127.0.0.1:%u" WS_PATH "\n", getWifiWsPort());
+    }
+    fflush(stdout);
+#ifdef ENABLE_PROFILER
+    Profile_begin();
+#endif
+    scheduler.addTask("udp_read", udpReadTask, TASK_IO, SCHED_IO_PERIOD, SCHED_IO_BUDGET);
+    scheduler.addTask("serial_read", serialReadTask, TASK_IO, SCHED_IO_PERIOD, SCHED_IO_BUDGET);
+    if (getWifiTcpPort())
+        scheduler.addTask("tcp_read", tcpReadTask, TASK_IO, SCHED_IO_PERIOD, SCHED_IO_BUDGET);
+    if (getWifiWsPort())
+        scheduler.addTask("ws_read", wsReadTask, TASK_IO, SCHED_IO_PERIOD, SCHED_IO_BUDGET);
+    scheduler.addTask("housekeeping", housekeepingTask, TASK_BACKGROUND, SCHED_HOUSEKEEPING_PERIOD, SCHED_HOUSEKEEPING_BUDGET);
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+static void loop()
+{
+    PROFILE_LOOP_START();
+    scheduler.run();
+
+    //-- Sleep until there is work, but wake up in time for queue timeouts
+    struct pollfd fds[2 * (TCP_MAX_CLIENTS + 1) + 1];
+    fds[0].fd = bridgeUdp.fd();
+    fds[0].events = POLLIN;
+    int n = 1 + bridgeTcp.pollFds(&fds[1]);
+    n += bridgeWs.pollFds(&fds[n]);
+    poll(fds, n, 1);
+}
+
+//---------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    if (!setup(argc, argv))
+        return 1;
+    while (running)
+        loop();
+    char stats[768];
+    scheduler.toJson(stats, sizeof(stats));
+    printf("%s\n", stats);
+#ifdef ENABLE_PROFILER
+    char profile[1024];
+    Profile_toJson(profile, sizeof(profile));
+    printf("%s\n", profile);
+#endif
+    return 0;
+}
@@ -0,0 +1,328 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file lz_proxy.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Sits between the bridge and an unmodified GCS when the bridge compresses
+ * its downlink (UDP_COMPRESS), adds FEC parity to it (UDP_FEC) or link
+ * headers (UDP_LINK_HEADER). Link headers are checked and stripped, lost
+ * datagrams are rebuilt from the parity where possible, LZF envelopes are
+ * unwrapped (anything else passes through as is) and the result is sent to
+ * the GCS; whatever the GCS sends back goes to the bridge, behind a link
+ * header of its own with --link-header. With --reliable (UDP_RELIABLE) the
+ * uplink is kept until the bridge acknowledges it, and resent when lost.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "common.h"
+#include "fec.h"
+#include "link_header.h"
+#include "lzf.h"
+#include "reliable.h"
+#include "posix_udp.h"
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+static volatile bool    running = true;
+
+static PosixUdp         bridgeSide;
+static PosixUdp         gcsSide;
+static FecDecoder       fec;
+static LinkPeer         bridgeLink;
+static bool             link_header = false;
+static RelSender        rel;
+static bool             reliable = false;
+static UINT32           bridge_ip = 0;
+static UINT16           bridge_port = DEFAULT_UDP_CPORT;
+static UINT32           gcs_ip = 0;
+static UINT16           gcs_port = 14550;
+
+static UINT64           datagrams = 0;  // From the bridge
+static UINT64           wire = 0;       // Bytes from the bridge
+static UINT64           parity_bytes = 0;
+static UINT64           passed = 0;     // Not in an LZF envelope
+static UINT64           unwrapped = 0;  // Bytes to the GCS
+static UINT64           uplinks = 0;
+
+//---------------------------------------------------------------------------------
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --bridge <ip[:port]>  The bridge (default 192.168.1.1:%u)\n"
+            "  --gcs <ip[:port]>     Where the GCS listens (default 127.0.0.1:14550)\n"
+            "  --listen <port>       Local port the GCS talks back to (default 14555)\n"
+            "  --link-header         Exchange link headers with the bridge (UDP_LINK_HEADER must be 1)\n"
+            "  --reliable            Resend lost uplink datagrams (UDP_RELIABLE must be 1)\n"
+            "  --interval <s>        Print statistics every s seconds (default only on exit)\n",
+            name, DEFAULT_UDP_CPORT);
+}
+
+//---------------------------------------------------------------------------------
+static void on_signal(int)
+{
+    running = false;
+}
+
+//---------------------------------------------------------------------------------
+//-- "a.b.c.d" or "a.b.c.d:port", port left as is when not given
+static bool parseEndpoint(const char *text, UINT32 &ip, UINT16 &port)
+{
+    char host[64];
+    const char *colon = strchr(text, ':');
+    UINT32 len = colon ? (UINT32)(colon - text) : strlen(text);
+    if (len >= sizeof(host))
+        return false;
+    memcpy(host, text, len);
+    host[len] = 0;
+    struct in_addr addr;
+    if (inet_pton(AF_INET, host, &addr) != 1)
+        return false;
+    ip = addr.s_addr;
+    if (colon)
+        port = atoi(colon + 1);
+    return port != 0;
+}
+
+//---------------------------------------------------------------------------------
+//-- One datagram as the bridge queued it, before any FEC
+static void deliver(const UINT8 *data, UINT32 len)
+{
+    static UINT8 plain[65536];
+    UINT32 out = Lzf_unwrap(data, len, plain, sizeof(plain));
+    if (out)
+    {
+        unwrapped += out;
+        gcsSide.sendTo(gcs_ip, gcs_port, plain, out);
+    }
+    else
+    {
+        passed++;
+        unwrapped += len;
+        gcsSide.sendTo(gcs_ip, gcs_port, data, len);
+    }
+}
+
+//---------------------------------------------------------------------------------
+static void downlink(const UINT8 *packet, UINT32 len)
+{
+    datagrams++;
+    wire += len;
+    if (link_header && bridgeLink.receive(packet, len, micros()))
+    {
+        packet += LINK_HEADER_LEN;
+        len -= LINK_HEADER_LEN;
+    }
+    if (reliable && RelSender::isAck(packet, len))
+    {
+        rel.ack(packet, micros());
+        return;
+    }
+    if (!FecDecoder::isFec(packet, len))
+    {
+        deliver(packet, len);
+        return;
+    }
+    if (packet[2] & FEC_PARITY)
+        parity_bytes += len;
+    const UINT8 *data;
+    UINT32 n = fec.receive(packet, len, data);
+    if (n)
+        deliver(data, n);
+    while ((n = fec.recovered(data)) > 0)
+        deliver(data, n);
+}
+
+//---------------------------------------------------------------------------------
+static void sendUp(const UINT8 *data, UINT32 len)
+{
+    if (link_header)
+    {
+        UINT8 header[LINK_HEADER_LEN];
+        bridgeLink.header(header, micros());
+        if (bridgeSide.sendTo(bridge_ip, bridge_port, header, LINK_HEADER_LEN, data, len))
+            bridgeLink.sent();
+    }
+    else
+        bridgeSide.sendTo(bridge_ip, bridge_port, data, len);
+}
+
+//---------------------------------------------------------------------------------
+static void uplink(const UINT8 *packet, UINT32 len)
+{
+    uplinks++;
+    if (reliable && len <= PACKET_BUFFER_SIZE)
+    {
+        const UINT8 *data;
+        len = rel.send(packet, len, micros(), data);
+        sendUp(data, len);
+    }
+    else
+        sendUp(packet, len);
+}
+
+//---------------------------------------------------------------------------------
+static void printStats()
+{
+    printf("Downlink: %llu datagrams (%llu not compressed), %llu bytes received, %llu bytes to the GCS (%.1f%%)\n",
+           (unsigned long long)datagrams, (unsigned long long)passed, (unsigned long long)wire,
+           (unsigned long long)unwrapped, unwrapped ? 100.0 * wire / unwrapped : 0.0);
+    const FecDecoderStats &fs = fec.getStats();
+    if (fs.parity)
+    {
+        UINT32 missing = fs.recovered + fs.lost;
+        printf("FEC: %u parity datagrams (%.1f%% airtime), %u recovered, %u lost (%.1f%% recovered), %u duplicates\n",
+               fs.parity, wire ? 100.0 * parity_bytes / (wire - parity_bytes) : 0.0, fs.recovered, fs.lost,
+               missing ? 100.0 * fs.recovered / missing : 100.0, fs.duplicates);
+    }
+    if (bridgeLink.active())
+    {
+        const LinkStats &ls = bridgeLink.getStats();
+        UINT32 expected = ls.received + ls.lost;
+        printf("Link: %u received, %u lost (%.2f%%), %u reordered, %u duplicates, %u restarts\n",
+               ls.received, ls.lost, expected ? 100.0 * ls.lost / expected : 0.0, ls.reordered, ls.duplicates, ls.restarts);
+        printf("Latency: RTT %u us (min %u), one-way %u us (max %u)\n",
+               ls.rtt_us, ls.rtt_min_us, ls.latency_us, ls.latency_max_us);
+    }
+    printf("Uplink: %llu datagrams\n", (unsigned long long)uplinks);
+    if (reliable)
+    {
+        const RelSenderStats &rs = rel.getStats();
+        printf("Reliable: %u acked, %u retransmits (%u fast), %u recovered in %.1f ms (max %.1f), %u given up, RTT %u us\n",
+               rs.acked, rs.retransmits, rs.fast, rs.recovered,
+               rs.recovered ? rs.recovery_us / 1000.0 / rs.recovered : 0.0, rs.recovery_max_us / 1000.0,
+               rs.abandoned, rs.srtt_us);
+    }
+    fflush(stdout);
+}
+
+//---------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    UINT16 listen_port = 14555;
+    UINT32 interval = 0;
+    parseEndpoint("192.168.1.1", bridge_ip, bridge_port);
+    parseEndpoint("127.0.0.1", gcs_ip, gcs_port);
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--link-header"))
+        {
+            link_header = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "--reliable"))
+        {
+            reliable = true;
+            continue;
+        }
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        bool ok = val != NULL;
+        if (ok && !strcmp(argv[i], "--bridge"))
+            ok = parseEndpoint(val, bridge_ip, bridge_port);
+        else if (ok && !strcmp(argv[i], "--gcs"))
+            ok = parseEndpoint(val, gcs_ip, gcs_port);
+        else if (ok && !strcmp(argv[i], "--listen"))
+            ok = (listen_port = atoi(val)) != 0;
+        else if (ok && !strcmp(argv[i], "--interval"))
+            interval = atoi(val) * 1000;
+        else
+            ok = false;
+        if (!ok)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    //-- The bridge learns us as a client from the GCS traffic we forward
+    if (!bridgeSide.begin(0) || !gcsSide.begin(listen_port))
+    {
+        perror("socket");
+        return 1;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    //-- Numbered from a random start, so the bridge can tell a restarted
+    //   proxy from late copies of the last one
+    srand(time(NULL) ^ getpid());
+    rel.reset(rand());
+    printf("Bridge: %s:%u, GCS: ", inet_ntoa(*(struct in_addr *)&bridge_ip), bridge_port);
+    printf("%s:%u, listening on %u\n", inet_ntoa(*(struct in_addr *)&gcs_ip), gcs_port, listen_port);
+    fflush(stdout);
+
+    static UINT8 packet[65536];
+    UINT32 last_report = millis();
+    while (running)
+    {
+        if (interval && (millis() - last_report) >= interval)
+        {
+            last_report = millis();
+            printStats();
+        }
+        struct pollfd fds[2];
+        fds[0].fd = bridgeSide.fd();
+        fds[0].events = POLLIN;
+        fds[1].fd = gcsSide.fd();
+        fds[1].events = POLLIN;
+        //-- Wake up in time to resend what the bridge did not acknowledge
+        int ready = poll(fds, 2, rel.pending() ? 1 : 100);
+        const UINT8 *data;
+        UINT32 len;
+        while ((len = rel.poll(micros(), data)) > 0)
+            sendUp(data, len);
+        if (ready <= 0)
+            continue;
+        while ((len = bridgeSide.parsePacket()) > 0)
+        {
+            len = bridgeSide.read(packet, sizeof(packet));
+            downlink(packet, len);
+        }
+        while ((len = gcsSide.parsePacket()) > 0)
+        {
+            //-- Answer the GCS wherever it talks from
+            gcs_ip = gcsSide.remoteIP();
+            gcs_port = gcsSide.remotePort();
+            len = gcsSide.read(packet, sizeof(packet));
+            uplink(packet, len);
+        }
+    }
+
+    fec.flush();
+    printStats();
+    return 0;
+}
@@ -0,0 +1,202 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file posix_tcp.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "posix_tcp.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+//---------------------------------------------------------------------------------
+PosixTcp::PosixTcp()
+    : _fd(-1)
+{
+    for (UINT8 i = 0; i < TCP_MAX_CLIENTS; i++)
+        _clients[i].fd = -1;
+}
+
+//---------------------------------------------------------------------------------
+PosixTcp::~PosixTcp()
+{
+    for (UINT8 i = 0; i < TCP_MAX_CLIENTS; i++)
+        close(i);
+    if (_fd >= 0)
+        ::close(_fd);
+}
+
+//---------------------------------------------------------------------------------
+bool PosixTcp::begin(UINT16 port)
+{
+    _fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (_fd < 0)
+        return false;
+    int one = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(_fd, TCP_MAX_CLIENTS) < 0)
+    {
+        ::close(_fd);
+        _fd = -1;
+        return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+int PosixTcp::_accept(UINT32 &ip, UINT16 &port)
+{
+    if (_fd < 0)
+        return -1;
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int fd = accept4(_fd, (struct sockaddr *)&addr, &addr_len, SOCK_NONBLOCK);
+    if (fd < 0)
+        return -1;
+    ip = addr.sin_addr.s_addr;
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+//---------------------------------------------------------------------------------
+bool PosixTcp::accept(UINT8 slot)
+{
+    Client &c = _clients[slot];
+    int fd = _accept(c.ip, c.port);
+    if (fd < 0)
+        return false;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    int sndbuf = 0;
+    socklen_t len = sizeof(sndbuf);
+    getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &len);
+    //-- Linux reports twice the size, half of it for its own bookkeeping
+    c.sndbuf = sndbuf / 2;
+    c.fd = fd;
+    c.closed = false;
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+bool PosixTcp::reject()
+{
+    UINT32 ip;
+    UINT16 port;
+    int fd = _accept(ip, port);
+    if (fd < 0)
+        return false;
+    ::close(fd);
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 PosixTcp::read(UINT8 slot, UINT8 *buffer, UINT32 len)
+{
+    Client &c = _clients[slot];
+    if (c.fd < 0 || c.closed)
+        return 0;
+    ssize_t got = recv(c.fd, buffer, len, 0);
+    if (got > 0)
+        return got;
+    if (got == 0 || (errno != EAGAIN && errno != EINTR))
+        c.closed = true;
+    return 0;
+}
+
+//---------------------------------------------------------------------------------
+//-- Room left in the socket send buffer
+UINT32 PosixTcp::availableForWrite(UINT8 slot)
+{
+    Client &c = _clients[slot];
+    int queued = 0;
+    if (c.fd < 0 || c.closed || ioctl(c.fd, SIOCOUTQ, &queued) < 0)
+        return 0;
+    return (UINT32)queued < c.sndbuf ? c.sndbuf - queued : 0;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 PosixTcp::write(UINT8 slot, const UINT8 *buffer, UINT32 len)
+{
+    Client &c = _clients[slot];
+    if (c.fd < 0 || c.closed || len == 0)
+        return 0;
+    ssize_t sent = send(c.fd, buffer, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent > 0)
+        return sent;
+    if (errno != EAGAIN && errno != EINTR)
+        c.closed = true;
+    return 0;
+}
+
+//---------------------------------------------------------------------------------
+int PosixTcp::pollFds(struct pollfd *fds) const
+{
+    int n = 0;
+    if (_fd < 0)
+        return 0;
+    fds[n].fd = _fd;
+    fds[n++].events = POLLIN;
+    for (UINT8 i = 0; i < TCP_MAX_CLIENTS; i++)
+    {
+        if (_clients[i].fd < 0 || _clients[i].closed)
+            continue;
+        fds[n].fd = _clients[i].fd;
+        fds[n++].events = POLLIN;
+    }
+    return n;
+}
+
+//---------------------------------------------------------------------------------
+void PosixTcp::close(UINT8 slot)
+{
+    Client &c = _clients[slot];
+    if (c.fd >= 0)
+        ::close(c.fd);
+    c.fd = -1;
+}
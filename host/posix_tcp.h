@@ -0,0 +1,86 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file posix_tcp.h
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * BridgeTcp on a non-blocking POSIX listening socket.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef POSIX_TCP_H
+#define POSIX_TCP_H
+
+#include "transport.h"
+
+struct pollfd;
+
+class PosixTcp : public BridgeTcp
+{
+public:
+    PosixTcp();
+    ~PosixTcp();
+
+    bool    begin               (UINT16 port);
+    bool    accept              (UINT8 slot);
+    bool    reject              ();
+    bool    connected           (UINT8 slot) { return _clients[slot].fd >= 0 && !_clients[slot].closed; }
+    UINT32  read                (UINT8 slot, UINT8 *buffer, UINT32 len);
+    UINT32  availableForWrite   (UINT8 slot);
+    UINT32  write               (UINT8 slot, const UINT8 *buffer, UINT32 len);
+    void    close               (UINT8 slot);
+    UINT32  remoteIP            (UINT8 slot) { return _clients[slot].ip; }
+    UINT16  remotePort          (UINT8 slot) { return _clients[slot].port; }
+
+    //-- The listening socket and the open connections, for poll(); fds must
+    //   have room for TCP_MAX_CLIENTS + 1. Returns how many were filled in.
+    int     pollFds             (struct pollfd *fds) const;
+
+private:
+    struct Client
+    {
+        int     fd;
+        bool    closed;     // The peer hung up (or the socket failed)
+        UINT32  sndbuf;
+        UINT32  ip;
+        UINT16  port;
+    };
+
+    int     _accept             (UINT32 &ip, UINT16 &port);
+
+private:
+    int     _fd;
+    Client  _clients[TCP_MAX_CLIENTS];
+};
+
+#endif
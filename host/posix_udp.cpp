@@ -0,0 +1,152 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file posix_udp.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "posix_udp.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+//---------------------------------------------------------------------------------
+PosixUdp::PosixUdp()
+    : _fd(-1), _packet_len(0), _packet_pos(0), _remote_ip(0), _remote_port(0)
+{
+}
+
+//---------------------------------------------------------------------------------
+PosixUdp::~PosixUdp()
+{
+    if (_fd >= 0)
+        close(_fd);
+}
+
+//---------------------------------------------------------------------------------
+bool PosixUdp::begin(UINT16 port)
+{
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd < 0)
+        return false;
+    int one = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(_fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        close(_fd);
+        _fd = -1;
+        return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 PosixUdp::parsePacket()
+{
+    _packet_len = 0;
+    _packet_pos = 0;
+    if (_fd < 0)
+        return 0;
+
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    ssize_t len = recvfrom(_fd, _packet, sizeof(_packet), 0, (struct sockaddr *)&addr, &addr_len);
+    if (len <= 0)
+        return 0;
+    _packet_len = len;
+    _remote_ip = addr.sin_addr.s_addr;
+    _remote_port = ntohs(addr.sin_port);
+    return _packet_len;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 PosixUdp::read(UINT8 *buffer, UINT32 len)
+{
+    UINT32 left = _packet_len - _packet_pos;
+    if (len > left)
+        len = left;
+    memcpy(buffer, &_packet[_packet_pos], len);
+    _packet_pos += len;
+    return len;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 PosixUdp::sendTo(UINT32 ip, UINT16 port, const UINT8 *buffer, UINT32 len)
+{
+    if (_fd < 0 || ip == 0 || port == 0)
+        return 0;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = ip;
+    addr.sin_port = htons(port);
+    ssize_t sent = sendto(_fd, buffer, len, 0, (struct sockaddr *)&addr, sizeof(addr));
+    return sent > 0 ? sent : 0;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 PosixUdp::sendTo(UINT32 ip, UINT16 port, const UINT8 *header, UINT32 header_len, const UINT8 *buffer, UINT32 len)
+{
+    if (_fd < 0 || ip == 0 || port == 0)
+        return 0;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = ip;
+    addr.sin_port = htons(port);
+    struct iovec iov[2];
+    iov[0].iov_base = (void *)header;
+    iov[0].iov_len = header_len;
+    iov[1].iov_base = (void *)buffer;
+    iov[1].iov_len = len;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &addr;
+    msg.msg_namelen = sizeof(addr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    ssize_t sent = sendmsg(_fd, &msg, 0);
+    return sent > 0 ? sent : 0;
+}
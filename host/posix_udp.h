@@ -0,0 +1,70 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file posix_udp.h
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * BridgeUdp on a non-blocking POSIX datagram socket.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef POSIX_UDP_H
+#define POSIX_UDP_H
+
+#include "transport.h"
+
+class PosixUdp : public BridgeUdp
+{
+public:
+    PosixUdp();
+    ~PosixUdp();
+
+    bool    begin               (UINT16 port);
+    UINT32  parsePacket         ();
+    UINT32  read                (UINT8 *buffer, UINT32 len);
+    UINT32  remoteIP            () { return _remote_ip; }
+    UINT16  remotePort          () { return _remote_port; }
+    UINT32  sendTo              (UINT32 ip, UINT16 port, const UINT8 *buffer, UINT32 len);
+    UINT32  sendTo              (UINT32 ip, UINT16 port, const UINT8 *header, UINT32 header_len, const UINT8 *buffer, UINT32 len);
+
+    int     fd                  () const { return _fd; }
+
+private:
+    int     _fd;
+    UINT8   _packet[65536];
+    UINT32  _packet_len;
+    UINT32  _packet_pos;
+    UINT32  _remote_ip;
+    UINT16  _remote_port;
+};
+
+#endif
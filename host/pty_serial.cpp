@@ -0,0 +1,211 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file pty_serial.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "pty_serial.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+//-- The ESP8266 UART TX FIFO
+#define PTY_TX_FIFO_SIZE    128
+
+//---------------------------------------------------------------------------------
+PtySerial::PtySerial()
+    : _fd(-1), _link_path(NULL), _bytes_per_sec(0), _rx_len(0)
+    , _rx_time(0), _rx_credit(0), _tx_busy_until(0)
+{
+    _slave_name[0] = 0;
+}
+
+//---------------------------------------------------------------------------------
+PtySerial::~PtySerial()
+{
+    if (_fd >= 0)
+        close(_fd);
+    if (_link_path)
+        unlink(_link_path);
+}
+
+//---------------------------------------------------------------------------------
+bool PtySerial::open(const char *linkPath)
+{
+    _fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (_fd < 0 || grantpt(_fd) < 0 || unlockpt(_fd) < 0)
+        return false;
+    strncpy(_slave_name, ptsname(_fd), sizeof(_slave_name) - 1);
+    _slave_name[sizeof(_slave_name) - 1] = 0;
+
+    //-- Raw, binary transparent line
+    struct termios tio;
+    tcgetattr(_fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(_fd, TCSANOW, &tio);
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+
+    if (linkPath)
+    {
+        unlink(linkPath);
+        if (symlink(_slave_name, linkPath) == 0)
+            _link_path = linkPath;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+void PtySerial::begin(UINT32 baudRate)
+{
+    //-- 8N1: ten bits on the line per byte
+    _bytes_per_sec = baudRate / 10;
+    _rx_time = HostClock_nowUs();
+    _rx_credit = 0;
+    _tx_busy_until = _rx_time;
+}
+
+//---------------------------------------------------------------------------------
+//-- Move what the line could have delivered since the last call into _rx
+void PtySerial::_fill()
+{
+    if (_fd < 0 || _rx_len == sizeof(_rx))
+        return;
+
+    UINT32 want = sizeof(_rx) - _rx_len;
+    if (_bytes_per_sec)
+    {
+        UINT64 now = HostClock_nowUs();
+        _rx_credit += (now - _rx_time) * _bytes_per_sec;
+        _rx_time = now;
+        //-- Nothing arriving: the line does not store credit beyond a full buffer
+        if (_rx_credit > (UINT64)sizeof(_rx) * 1000000ULL)
+            _rx_credit = (UINT64)sizeof(_rx) * 1000000ULL;
+        if (want > _rx_credit / 1000000ULL)
+            want = _rx_credit / 1000000ULL;
+    }
+    if (want == 0)
+        return;
+
+    ssize_t got = ::read(_fd, &_rx[_rx_len], want);
+    if (got > 0)
+    {
+        _rx_len += got;
+        if (_bytes_per_sec)
+            _rx_credit -= (UINT64)got * 1000000ULL;
+    }
+}
+
+//---------------------------------------------------------------------------------
+UINT32 PtySerial::available()
+{
+    _fill();
+    return _rx_len;
+}
+
+//---------------------------------------------------------------------------------
+UINT32 PtySerial::read(UINT8 *buffer, UINT32 len)
+{
+    _fill();
+    if (len > _rx_len)
+        len = _rx_len;
+    memcpy(buffer, _rx, len);
+    memmove(_rx, &_rx[len], _rx_len - len);
+    _rx_len -= len;
+    return len;
+}
+
+//---------------------------------------------------------------------------------
+//-- Bytes written but still "in the TX FIFO"
+UINT32 PtySerial::_txQueued()
+{
+    if (!_bytes_per_sec)
+        return 0;
+    UINT64 now = HostClock_nowUs();
+    if (_tx_busy_until <= now)
+    {
+        _tx_busy_until = now;
+        return 0;
+    }
+    return (UINT32)(((_tx_busy_until - now) * _bytes_per_sec + 999999ULL) / 1000000ULL);
+}
+
+//---------------------------------------------------------------------------------
+UINT32 PtySerial::availableForWrite()
+{
+    UINT32 queued = _txQueued();
+    return queued < PTY_TX_FIFO_SIZE ? PTY_TX_FIFO_SIZE - queued : 0;
+}
+
+//---------------------------------------------------------------------------------
+//-- Like HardwareSerial::write() on the ESP8266, this blocks until every
+//   byte fits in the TX FIFO
+UINT32 PtySerial::write(const UINT8 *buffer, UINT32 len)
+{
+    if (_fd < 0)
+        return 0;
+
+    if (_bytes_per_sec)
+    {
+        _txQueued();
+        _tx_busy_until += (UINT64)len * 1000000ULL / _bytes_per_sec;
+        //-- Wait until all but a FIFO's worth of bytes left the line
+        UINT64 fifo_us = (UINT64)PTY_TX_FIFO_SIZE * 1000000ULL / _bytes_per_sec;
+        UINT64 now = HostClock_nowUs();
+        if (_tx_busy_until > now + fifo_us)
+        {
+            UINT64 wait = _tx_busy_until - fifo_us - now;
+            if (HostClock_isVirtual())
+                HostClock_advance(wait);
+            else
+                usleep(wait);
+        }
+    }
+
+    UINT32 written = 0;
+    while (written < len)
+    {
+        ssize_t n = ::write(_fd, buffer + written, len - written);
+        if (n > 0)
+            written += n;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else
+            //-- Nobody is draining the slave side; the bytes would be lost
+            //   on a real UART as well
+            break;
+    }
+    return len;
+}
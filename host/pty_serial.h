@@ -0,0 +1,88 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file pty_serial.h
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * BridgeSerial on the master side of a pseudo terminal. The autopilot (or
+ * a test tool) opens the slave side as if it were the UART. Reads and
+ * writes are paced to the configured baud rate, so the bridge sees the
+ * same byte rate it would on the ESP8266.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef PTY_SERIAL_H
+#define PTY_SERIAL_H
+
+#include "transport.h"
+
+class PtySerial : public BridgeSerial
+{
+public:
+    PtySerial();
+    ~PtySerial();
+
+    //-- Opens the pty; optionally symlinks the slave to linkPath
+    bool        open                (const char *linkPath = NULL);
+    const char *slaveName           () const { return _slave_name; }
+
+    void        begin               (UINT32 baudRate);
+    UINT32      available           ();
+    UINT32      read                (UINT8 *buffer, UINT32 len);
+    UINT32      availableForWrite   ();
+    UINT32      write               (const UINT8 *buffer, UINT32 len);
+    //-- The pty blocks the writer instead of losing data
+    bool        hasOverrun          () { return false; }
+    UINT32      rxTime              () { return millis(); }
+    bool        hasRxError          () { return false; }
+    void        setFlowControl      (bool) {}
+    UINT32      detectBaudRate      () { return 0; }
+
+private:
+    void        _fill               ();
+    UINT32      _txQueued           ();
+
+private:
+    int         _fd;
+    char        _slave_name[64];
+    const char *_link_path;
+    UINT32      _bytes_per_sec;     // 0 disables pacing
+    //-- Bytes that "arrived" on the line but were not read yet, sized like
+    //   the receive buffer set up on the ESP8266
+    UINT8       _rx[DEFAULT_RECEVE_BUFFER_SIZE];
+    UINT32      _rx_len;
+    UINT64      _rx_time;
+    UINT64      _rx_credit;         // Line bytes allowed to arrive, in 1/1000000 bytes
+    UINT64      _tx_busy_until;     // When the last byte written leaves the line
+};
+
+#endif
@@ -0,0 +1,68 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file EEPROM.h
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * RAM backed EEPROM (contents are lost on exit).
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include "Arduino.h"
+
+#define HOST_EEPROM_SIZE    4096
+
+class EEPROMClass
+{
+public:
+    EEPROMClass() { memset(_data, 0xFF, sizeof(_data)); }
+
+    void        begin       (size_t size) { _size = size < sizeof(_data) ? size : sizeof(_data); }
+    uint8_t     read        (int address) { return _data[address]; }
+    void        write       (int address, uint8_t value) { _data[address] = value; }
+    uint8_t    *getDataPtr  () { return _data; }
+    bool        commit      () { return true; }
+
+    template <typename T> void get(int address, T &t) { memcpy(&t, &_data[address], sizeof(T)); }
+    template <typename T> void put(int address, const T &t) { memcpy(&_data[address], &t, sizeof(T)); }
+
+private:
+    uint8_t     _data[HOST_EEPROM_SIZE];
+    size_t      _size;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
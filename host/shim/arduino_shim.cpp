@@ -0,0 +1,118 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file arduino_shim.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "Arduino.h"
+#include "EEPROM.h"
+
+#include <time.h>
+
+EspClass    ESP;
+EEPROMClass EEPROM;
+
+static bool     _virtual = false;
+static uint64_t _virtual_us = 0;
+
+//---------------------------------------------------------------------------------
+static uint64_t _monotonicUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+//---------------------------------------------------------------------------------
+void HostClock_setVirtual(bool enable)
+{
+    _virtual = enable;
+    _virtual_us = 0;
+}
+
+//---------------------------------------------------------------------------------
+bool HostClock_isVirtual()
+{
+    return _virtual;
+}
+
+//---------------------------------------------------------------------------------
+void HostClock_advance(uint64_t us)
+{
+    _virtual_us += us;
+}
+
+//---------------------------------------------------------------------------------
+uint64_t HostClock_nowUs()
+{
+    return _virtual ? _virtual_us : _monotonicUs();
+}
+
+//---------------------------------------------------------------------------------
+uint32_t millis()
+{
+    return (uint32_t)(HostClock_nowUs() / 1000);
+}
+
+//---------------------------------------------------------------------------------
+uint32_t micros()
+{
+    return (uint32_t)HostClock_nowUs();
+}
+
+//---------------------------------------------------------------------------------
+void delay(uint32_t ms)
+{
+    if (_virtual)
+    {
+        _virtual_us += (uint64_t)ms * 1000;
+        return;
+    }
+    struct timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+//---------------------------------------------------------------------------------
+void yield()
+{
+}
+
+//---------------------------------------------------------------------------------
+//-- 80 MHz like the ESP8266 core clock, so cycle based figures compare
+uint32_t EspClass::getCycleCount()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec) * 80 / 1000);
+}
@@ -0,0 +1,167 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file test_autobaud.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for AutoBaud: accepting a rate on clean MAVLink traffic,
+ * moving on after a window of garbage, and the pulse width shortcut.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "autobaud.h"
+
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+//---------------------------------------------------------------------------------
+static std::vector<UINT8> heartbeat(UINT8 sysid, UINT8 seq)
+{
+    const UINT8 header[] = {MAVLINK_STX_V2, 9, 0, 0, seq, sysid, 1, 0, 0, 0};
+    std::vector<UINT8> frame(header, header + sizeof(header));
+    frame.resize(frame.size() + 9, 0x55);
+    UINT8 extra = 0;
+    Mavlink_crcExtra(0, extra);
+    UINT16 crc = Mavlink_crc(&frame[1], frame.size() - 1);
+    crc = Mavlink_crc(&extra, 1, crc);
+    frame.push_back(crc & 0xFF);
+    frame.push_back(crc >> 8);
+    return frame;
+}
+
+//---------------------------------------------------------------------------------
+static void test_accept()
+{
+    AutoBaud autobaud;
+    autobaud.begin(115200, 0);
+    CHECK(autobaud.active());
+    CHECK(autobaud.rate() == 115200);
+    for (UINT8 i = 0; i < AUTOBAUD_FRAMES; i++)
+    {
+        std::vector<UINT8> frame = heartbeat(1, i);
+        autobaud.feed(frame.data(), frame.size());
+    }
+    CHECK(!autobaud.poll(10, 0));
+    CHECK(!autobaud.active());
+    CHECK(autobaud.rate() == 115200);
+    CHECK(autobaud.trials() == 1);
+}
+
+//---------------------------------------------------------------------------------
+//-- Garbage, or frames from different "systems", is not a match
+static void test_reject()
+{
+    AutoBaud autobaud;
+    autobaud.begin(115200, 0);
+    UINT8 noise[200];
+    UINT32 seed = 1;
+    for (UINT32 i = 0; i < sizeof(noise); i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        noise[i] = seed >> 16;
+    }
+    for (UINT8 i = 0; i < AUTOBAUD_FRAMES; i++)
+    {
+        std::vector<UINT8> frame = heartbeat(10 + i, i);
+        autobaud.feed(frame.data(), frame.size());
+        autobaud.feed(noise, sizeof(noise));
+    }
+    CHECK(!autobaud.poll(AUTOBAUD_WINDOW - 1, 0));
+    CHECK(autobaud.active());
+    CHECK(autobaud.poll(AUTOBAUD_WINDOW, 0));
+    CHECK(autobaud.active());
+    CHECK(autobaud.rate() != 115200);
+    CHECK(autobaud.trials() == 2);
+
+    //-- The next rate starts from scratch
+    for (UINT8 i = 0; i < AUTOBAUD_FRAMES; i++)
+    {
+        std::vector<UINT8> frame = heartbeat(1, i);
+        autobaud.feed(frame.data(), frame.size());
+    }
+    CHECK(!autobaud.poll(AUTOBAUD_WINDOW + 10, 0));
+    CHECK(!autobaud.active());
+}
+
+//---------------------------------------------------------------------------------
+//-- Every candidate is tried in turn, without trying the same rate twice in a row
+static void test_cycle()
+{
+    AutoBaud autobaud;
+    autobaud.begin(57600, 0);
+    UINT32 now = 0;
+    UINT32 last = autobaud.rate();
+    bool seen921600 = false;
+    bool seen2000000 = false;
+    for (int i = 0; i < 20; i++)
+    {
+        now += AUTOBAUD_WINDOW;
+        CHECK(autobaud.poll(now, 0));
+        CHECK(autobaud.rate() != last);
+        last = autobaud.rate();
+        seen921600 |= last == 921600;
+        seen2000000 |= last == 2000000;
+    }
+    CHECK(seen921600 && seen2000000);
+}
+
+//---------------------------------------------------------------------------------
+static void test_measured()
+{
+    AutoBaud autobaud;
+    autobaud.begin(115200, 0);
+    CHECK(autobaud.poll(5, 460800));
+    CHECK(autobaud.rate() == 460800);
+    //-- The same estimate is not retried
+    CHECK(!autobaud.poll(6, 460800));
+    CHECK(autobaud.rate() == 460800);
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    test_accept();
+    test_reject();
+    test_cycle();
+    test_measured();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All AutoBaud tests passed\n");
+    return 0;
+}
@@ -0,0 +1,269 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file test_fec.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for the FEC encoder and decoder: single losses rebuilt in any
+ * arrival order, double losses and lost parity counted, short groups.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "fec.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+typedef std::vector<UINT8> Datagram;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+//---------------------------------------------------------------------------------
+static Datagram payload(UINT32 len)
+{
+    Datagram d(len);
+    for (UINT32 i = 0; i < len; i++)
+        d[i] = rand();
+    return d;
+}
+
+//---------------------------------------------------------------------------------
+//-- Encodes as the bridge does: a parity after every full group, and after
+//   the last (possibly short) one
+static std::vector<Datagram> encode(const std::vector<Datagram> &in, UINT8 group)
+{
+    FecEncoder enc;
+    enc.begin(group);
+    std::vector<Datagram> out;
+    UINT8 buf[PACKET_BUFFER_SIZE];
+    const UINT8 *parity;
+    for (size_t i = 0; i < in.size(); i++)
+    {
+        memcpy(buf, &in[i][0], in[i].size());
+        UINT32 len = enc.add(buf, in[i].size());
+        out.push_back(Datagram(buf, buf + len));
+        if (enc.full())
+        {
+            len = enc.parity(parity);
+            out.push_back(Datagram(parity, parity + len));
+        }
+    }
+    UINT32 len = enc.parity(parity);
+    if (len)
+        out.push_back(Datagram(parity, parity + len));
+    return out;
+}
+
+//---------------------------------------------------------------------------------
+static std::vector<Datagram> decode(FecDecoder &dec, const std::vector<Datagram> &in)
+{
+    std::vector<Datagram> out;
+    for (size_t i = 0; i < in.size(); i++)
+    {
+        CHECK(FecDecoder::isFec(&in[i][0], in[i].size()));
+        const UINT8 *data;
+        UINT32 len = dec.receive(&in[i][0], in[i].size(), data);
+        if (len)
+            out.push_back(Datagram(data, data + len));
+        while ((len = dec.recovered(data)) > 0)
+            out.push_back(Datagram(data, data + len));
+    }
+    dec.flush();
+    return out;
+}
+
+//---------------------------------------------------------------------------------
+static bool sameSet(std::vector<Datagram> a, std::vector<Datagram> b)
+{
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return a == b;
+}
+
+//---------------------------------------------------------------------------------
+static std::vector<Datagram> traffic(UINT32 count)
+{
+    std::vector<Datagram> in;
+    in.push_back(payload(1));
+    in.push_back(payload(FEC_PAYLOAD_MAX));
+    while (in.size() < count)
+        in.push_back(payload(1 + rand() % 600));
+    return in;
+}
+
+//---------------------------------------------------------------------------------
+static void test_no_loss()
+{
+    std::vector<Datagram> in = traffic(40);
+    std::vector<Datagram> wire = encode(in, 4);
+    CHECK(wire.size() == 50);
+    FecDecoder dec;
+    CHECK(sameSet(decode(dec, wire), in));
+    CHECK(dec.getStats().datagrams == 40);
+    CHECK(dec.getStats().parity == 10);
+    CHECK(dec.getStats().recovered == 0);
+    CHECK(dec.getStats().lost == 0);
+}
+
+//---------------------------------------------------------------------------------
+//-- One datagram of every group lost, in turn every position
+static void test_single_loss()
+{
+    for (UINT8 group = 1; group <= FEC_GROUP_MAX; group++)
+    {
+        std::vector<Datagram> in = traffic(group * 6);
+        std::vector<Datagram> wire = encode(in, group);
+        std::vector<Datagram> lossy;
+        for (size_t i = 0; i < wire.size(); i++)
+        {
+            size_t g = i / (group + 1);
+            if (i % (group + 1) != g % group)
+                lossy.push_back(wire[i]);
+        }
+        FecDecoder dec;
+        CHECK(sameSet(decode(dec, lossy), in));
+        CHECK(dec.getStats().recovered == 6);
+        CHECK(dec.getStats().lost == 0);
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- Parity ahead of the data it needs: the loss is rebuilt once the rest is in
+static void test_reorder()
+{
+    std::vector<Datagram> in = traffic(4);
+    std::vector<Datagram> wire = encode(in, 4);
+    std::vector<Datagram> lossy;
+    lossy.push_back(wire[4]);
+    lossy.push_back(wire[0]);
+    lossy.push_back(wire[3]);
+    lossy.push_back(wire[2]);
+    //-- Late arrival of the rebuilt one, and a repeated parity
+    lossy.push_back(wire[1]);
+    lossy.push_back(wire[4]);
+    FecDecoder dec;
+    std::vector<Datagram> out = decode(dec, lossy);
+    CHECK(out.size() == 4);
+    CHECK(sameSet(out, in));
+    CHECK(dec.getStats().recovered == 1);
+    CHECK(dec.getStats().duplicates == 2);
+    CHECK(dec.getStats().lost == 0);
+}
+
+//---------------------------------------------------------------------------------
+static void test_unrecoverable()
+{
+    std::vector<Datagram> in = traffic(8);
+    std::vector<Datagram> wire = encode(in, 4);
+    //-- Two of the first group, then one of the second along with its parity
+    std::vector<Datagram> lossy;
+    lossy.push_back(wire[0]);
+    lossy.push_back(wire[3]);
+    lossy.push_back(wire[4]);
+    lossy.push_back(wire[5]);
+    lossy.push_back(wire[7]);
+    lossy.push_back(wire[8]);
+    FecDecoder dec;
+    CHECK(decode(dec, lossy).size() == 5);
+    CHECK(dec.getStats().recovered == 0);
+    CHECK(dec.getStats().lost == 3);
+}
+
+//---------------------------------------------------------------------------------
+//-- More groups in flight than the decoder keeps: the oldest are closed
+static void test_eviction()
+{
+    std::vector<Datagram> in = traffic(3 * 40);
+    std::vector<Datagram> wire = encode(in, 3);
+    std::vector<Datagram> lossy;
+    for (size_t i = 0; i < wire.size(); i++)
+    {
+        if (i % 4 != 1 && i % 4 != 2)
+            lossy.push_back(wire[i]);
+    }
+    FecDecoder dec;
+    CHECK(decode(dec, lossy).size() == 40);
+    CHECK(dec.getStats().lost == 80);
+}
+
+//---------------------------------------------------------------------------------
+static void test_short_group()
+{
+    FecEncoder enc;
+    enc.begin(8);
+    UINT8 buf[PACKET_BUFFER_SIZE] = { 1, 2, 3 };
+    const UINT8 *parity;
+    CHECK(enc.parity(parity) == 0);
+    UINT32 len = enc.add(buf, 3);
+    CHECK(len == 3 + FEC_HEADER_LEN);
+    CHECK(buf[0] == FEC_MAGIC && buf[3] == 1 && buf[5] == 3);
+    CHECK(!enc.full());
+    CHECK(enc.parity(parity) == FEC_OVERHEAD + 3);
+    CHECK(parity[2] == (FEC_PARITY | 1));
+    //-- A group of one is a copy
+    FecDecoder dec;
+    const UINT8 *data;
+    CHECK(dec.receive(parity, FEC_OVERHEAD + 3, data) == 0);
+    CHECK(dec.recovered(data) == 3);
+    CHECK(data[0] == 1 && data[2] == 3);
+    CHECK(enc.getStats().groups == 1);
+    CHECK(enc.getStats().data_bytes == 3 + FEC_HEADER_LEN);
+    CHECK(enc.getStats().parity_bytes == FEC_OVERHEAD + 3);
+    //-- Not FEC, or too short
+    CHECK(!FecDecoder::isFec(buf, FEC_HEADER_LEN));
+    buf[0] = 0xFD;
+    CHECK(!FecDecoder::isFec(buf, 10));
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    srand(1);
+    test_no_loss();
+    test_single_loss();
+    test_reorder();
+    test_unrecoverable();
+    test_eviction();
+    test_short_group();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All FEC tests passed\n");
+    return 0;
+}
@@ -0,0 +1,225 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file test_link_header.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for LinkPeer: loss, reordering and duplicate counting across
+ * sequence wrap, startup and peer restarts, and round trip and one-way latency
+ * between two clocks that are far apart.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "link_header.h"
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+//---------------------------------------------------------------------------------
+static void datagram(LinkPeer &peer, UINT16 seq, UINT32 time = 1000)
+{
+    UINT8 header[LINK_HEADER_LEN] = { LINK_MAGIC, (UINT8)seq, (UINT8)(seq >> 8) };
+    header[3] = time & 0xFF;
+    header[4] = (time >> 8) & 0xFF;
+    CHECK(peer.receive(header, sizeof(header), time + 500));
+}
+
+//---------------------------------------------------------------------------------
+static void test_sequence()
+{
+    LinkPeer peer;
+    CHECK(!peer.active());
+    datagram(peer, 0);
+    CHECK(peer.active());
+    datagram(peer, 1);
+    datagram(peer, 3);
+    datagram(peer, 4);
+    CHECK(peer.getStats().received == 4);
+    CHECK(peer.getStats().lost == 1);
+    //-- Late, then again
+    datagram(peer, 2);
+    CHECK(peer.getStats().lost == 0);
+    CHECK(peer.getStats().reordered == 1);
+    datagram(peer, 2);
+    datagram(peer, 4);
+    CHECK(peer.getStats().duplicates == 2);
+    CHECK(peer.getStats().received == 5);
+
+    //-- Burst longer than the window: the late one cannot be told from a duplicate
+    datagram(peer, 5 + LINK_WINDOW + 10);
+    CHECK(peer.getStats().lost == LINK_WINDOW + 10);
+    datagram(peer, 5);
+    CHECK(peer.getStats().duplicates == 3);
+    datagram(peer, 5 + LINK_WINDOW + 9);
+    CHECK(peer.getStats().reordered == 2);
+    CHECK(peer.getStats().lost == LINK_WINDOW + 9);
+}
+
+//---------------------------------------------------------------------------------
+//-- Out of order before there is anything to compare with
+static void test_startup_reorder()
+{
+    LinkPeer peer;
+    datagram(peer, 2);
+    datagram(peer, 1);
+    CHECK(peer.getStats().lost == 0);
+    CHECK(peer.getStats().reordered == 0);
+    CHECK(peer.getStats().duplicates == 1);
+    CHECK(peer.getStats().received == 1);
+    datagram(peer, 4);
+    CHECK(peer.getStats().lost == 1);
+    datagram(peer, 3);
+    CHECK(peer.getStats().lost == 0);
+    CHECK(peer.getStats().reordered == 1);
+}
+
+//---------------------------------------------------------------------------------
+static void test_wrap_and_restart()
+{
+    LinkPeer peer;
+    for (UINT32 seq = 65530; seq < 65540; seq++)
+        datagram(peer, seq);
+    CHECK(peer.getStats().received == 10);
+    CHECK(peer.getStats().lost == 0);
+    CHECK(peer.getStats().duplicates == 0);
+    //-- The peer rebooted
+    datagram(peer, 20000);
+    datagram(peer, 20001);
+    CHECK(peer.getStats().restarts == 1);
+    CHECK(peer.getStats().lost == 0);
+    CHECK(peer.getStats().received == 12);
+    //-- One from before the reboot turns up late
+    datagram(peer, 19999);
+    CHECK(peer.getStats().lost == 0);
+    CHECK(peer.getStats().duplicates == 1);
+
+    //-- Not a link header
+    UINT8 frame[LINK_HEADER_LEN] = { 0xFD };
+    CHECK(!peer.receive(frame, sizeof(frame), 0));
+    CHECK(!LinkPeer::hasHeader(frame, sizeof(frame)));
+    frame[0] = LINK_MAGIC;
+    CHECK(!LinkPeer::hasHeader(frame, LINK_HEADER_LEN - 1));
+}
+
+//---------------------------------------------------------------------------------
+//-- Bridge and proxy clocks 3 billion us apart, 2 ms each way
+static void test_latency()
+{
+    const UINT32 offset = 3000000000u;
+    LinkPeer bridge;
+    LinkPeer proxy;
+    UINT8 header[LINK_HEADER_LEN];
+    UINT32 now = 5000;
+
+    //-- Proxy to bridge, held 7 ms, bridge to proxy
+    proxy.header(header, now + offset);
+    proxy.sent();
+    CHECK(header[7] == 0 && header[8] == 0);
+    now += 2000;
+    CHECK(bridge.receive(header, sizeof(header), now));
+    now += 7000;
+    bridge.header(header, now);
+    bridge.sent();
+    now += 2000;
+    CHECK(proxy.receive(header, sizeof(header), now + offset));
+    CHECK(proxy.getStats().rtt_us == 4000);
+    CHECK(proxy.getStats().rtt_min_us == 4000);
+
+    //-- Back again, so the bridge knows the round trip too
+    proxy.header(header, now + offset);
+    proxy.sent();
+    now += 2000;
+    CHECK(bridge.receive(header, sizeof(header), now));
+    CHECK(bridge.getStats().rtt_us == 4000);
+    CHECK(bridge.getStats().received == 2);
+    CHECK(proxy.getStats().sent == 2);
+
+    //-- Steady 2 ms, then one datagram queued 6 ms longer
+    for (int i = 0; i < 20; i++)
+    {
+        now += 10000;
+        bridge.header(header, now);
+        bridge.sent();
+        CHECK(proxy.receive(header, sizeof(header), now + 2000 + offset));
+    }
+    CHECK(proxy.getStats().latency_us == 2000);
+    now += 10000;
+    bridge.header(header, now);
+    bridge.sent();
+    CHECK(proxy.receive(header, sizeof(header), now + 8000 + offset));
+    CHECK(proxy.getStats().latency_max_us == 8000);
+    CHECK(proxy.getStats().latency_us == 2000 + 6000 / 8);
+    CHECK(proxy.getStats().lost == 0);
+}
+
+//---------------------------------------------------------------------------------
+//-- A late or repeated datagram must not move the echoed time back
+static void test_echo_order()
+{
+    LinkPeer bridge;
+    LinkPeer proxy;
+    UINT8 first[LINK_HEADER_LEN];
+    UINT8 second[LINK_HEADER_LEN];
+    UINT8 header[LINK_HEADER_LEN];
+    proxy.header(first, 1000);
+    proxy.sent();
+    proxy.header(second, 2000);
+    proxy.sent();
+    CHECK(bridge.receive(second, sizeof(second), 52000));
+    CHECK(bridge.receive(first, sizeof(first), 53000));
+    CHECK(bridge.receive(second, sizeof(second), 54000));
+    //-- The first one is from before the first received: not ours to count
+    CHECK(bridge.getStats().duplicates == 2 && bridge.getStats().lost == 0);
+    //-- Echo of the newest (2000), aged by the time since it arrived
+    bridge.header(header, 60000);
+    UINT32 echo = header[7] | ((UINT32)header[8] << 8) | ((UINT32)header[9] << 16) | ((UINT32)header[10] << 24);
+    CHECK(echo == 2000 + (60000 - 52000));
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    test_sequence();
+    test_startup_reorder();
+    test_wrap_and_restart();
+    test_latency();
+    test_echo_order();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All link header tests passed\n");
+    return 0;
+}
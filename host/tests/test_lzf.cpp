@@ -0,0 +1,178 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file test_lzf.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for the LZF codec and envelope: round trips of telemetry-like,
+ * repetitive, random and tiny buffers, and rejection of corrupt input.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "lzf.h"
+
+#include <stdlib.h>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+//---------------------------------------------------------------------------------
+static UINT32 roundTrip(const UINT8 *in, UINT32 len)
+{
+    static UINT8 packed[PACKET_BUFFER_SIZE * 2];
+    static UINT8 plain[PACKET_BUFFER_SIZE];
+    UINT32 n = Lzf_compress(in, len, packed, sizeof(packed));
+    CHECK(n > 0);
+    CHECK(Lzf_decompress(packed, n, plain, sizeof(plain)) == len);
+    CHECK(memcmp(in, plain, len) == 0);
+    //-- A buffer one byte short is refused, not overrun
+    if (n > 1)
+        CHECK(Lzf_decompress(packed, n, plain, len - 1) == 0);
+    return n;
+}
+
+//---------------------------------------------------------------------------------
+//-- A datagram of MAVLink v2 frames: the same few messages with a running
+//   sequence number and slowly changing fields
+static UINT32 telemetry(UINT8 *out, UINT32 size)
+{
+    UINT32 len = 0;
+    for (UINT8 seq = 0; len + 40 <= size; seq++)
+    {
+        UINT8 *f = &out[len];
+        memset(f, 0, 40);
+        f[0] = 0xFD;
+        f[1] = 28;
+        f[4] = seq;
+        f[5] = 1;
+        f[6] = 1;
+        f[7] = (seq % 3) ? 30 : 33;
+        f[10] = seq;
+        f[14] = (UINT8)(seq * 7);
+        f[38] = rand();
+        f[39] = rand();
+        len += 40;
+    }
+    return len;
+}
+
+//---------------------------------------------------------------------------------
+static void test_round_trip()
+{
+    UINT8 buf[PACKET_BUFFER_SIZE];
+    UINT32 len = telemetry(buf, sizeof(buf));
+    UINT32 n = roundTrip(buf, len);
+    printf("Telemetry: %u -> %u bytes\n", len, n);
+    CHECK(n < len / 2);
+
+    memset(buf, 0x55, sizeof(buf));
+    CHECK(roundTrip(buf, sizeof(buf)) < 32);
+
+    for (UINT32 i = 0; i < sizeof(buf); i++)
+        buf[i] = rand();
+    roundTrip(buf, sizeof(buf));
+    //-- No gain: refused when asked to shrink
+    UINT8 packed[PACKET_BUFFER_SIZE];
+    CHECK(Lzf_compress(buf, sizeof(buf), packed, sizeof(buf) - 1) == 0);
+
+    for (UINT32 len = 1; len <= 70; len++)
+    {
+        for (UINT32 i = 0; i < len; i++)
+            buf[i] = (i % 5 == 0) ? rand() : 'a';
+        roundTrip(buf, len);
+    }
+}
+
+//---------------------------------------------------------------------------------
+static void test_corrupt()
+{
+    UINT8 plain[64];
+    //-- A match before the start of the output
+    const UINT8 back[] = { 0x00, 'a', 0x20, 0x05 };
+    CHECK(Lzf_decompress(back, sizeof(back), plain, sizeof(plain)) == 0);
+    //-- A literal run longer than the input
+    const UINT8 run[] = { 0x05, 'a', 'b' };
+    CHECK(Lzf_decompress(run, sizeof(run), plain, sizeof(plain)) == 0);
+    //-- A match missing its offset byte
+    const UINT8 cut[] = { 0x00, 'a', 0x20 };
+    CHECK(Lzf_decompress(cut, sizeof(cut), plain, sizeof(plain)) == 0);
+}
+
+//---------------------------------------------------------------------------------
+static void test_envelope()
+{
+    UINT8 plain[PACKET_BUFFER_SIZE];
+    UINT8 env[PACKET_BUFFER_SIZE];
+    UINT8 data[100];
+    for (UINT32 i = 0; i < sizeof(data); i++)
+        data[i] = i / 10;
+
+    env[0] = LZF_MAGIC;
+    env[1] = LZF_COMPRESSED;
+    env[2] = sizeof(data);
+    env[3] = 0;
+    UINT32 n = Lzf_compress(data, sizeof(data), &env[LZF_HEADER_LEN], sizeof(data) - 1);
+    CHECK(n > 0);
+    CHECK(Lzf_unwrap(env, n + LZF_HEADER_LEN, plain, sizeof(plain)) == sizeof(data));
+    CHECK(memcmp(plain, data, sizeof(data)) == 0);
+    CHECK(Lzf_unwrap(env, n + LZF_HEADER_LEN - 1, plain, sizeof(plain)) == 0);
+    CHECK(Lzf_unwrap(env, n + LZF_HEADER_LEN, plain, sizeof(data) - 1) == 0);
+
+    env[1] = LZF_STORED;
+    memcpy(&env[LZF_HEADER_LEN], data, sizeof(data));
+    CHECK(Lzf_unwrap(env, sizeof(data) + LZF_HEADER_LEN, plain, sizeof(plain)) == sizeof(data));
+    CHECK(Lzf_unwrap(env, sizeof(data) + LZF_HEADER_LEN + 1, plain, sizeof(plain)) == 0);
+    env[1] = 7;
+    CHECK(Lzf_unwrap(env, sizeof(data) + LZF_HEADER_LEN, plain, sizeof(plain)) == 0);
+
+    //-- Plain MAVLink is not an envelope
+    const UINT8 frame[] = { 0xFD, 9, 0, 0, 0, 1, 1, 0, 0, 0 };
+    CHECK(Lzf_unwrap(frame, sizeof(frame), plain, sizeof(plain)) == 0);
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    srand(1);
+    test_round_trip();
+    test_corrupt();
+    test_envelope();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All LZF tests passed\n");
+    return 0;
+}
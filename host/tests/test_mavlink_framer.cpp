@@ -0,0 +1,232 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+/**
+ * @file test_mavlink_framer.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for MavlinkFramer: v1/v2 frames whole and split, checksum
+ * rejection, resynchronizing after a false start byte, and signed frames.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "mavlink_framer.h"
+
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+struct Piece
+{
+    UINT8               result;
+    UINT32              msgid;
+    std::vector<UINT8>  bytes;
+};
+
+//---------------------------------------------------------------------------------
+static void seal(std::vector<UINT8> &frame, UINT8 extra)
+{
+    UINT16 crc = Mavlink_crc(&frame[1], frame.size() - 1);
+    crc = Mavlink_crc(&extra, 1, crc);
+    frame.push_back(crc & 0xFF);
+    frame.push_back(crc >> 8);
+}
+
+//---------------------------------------------------------------------------------
+static std::vector<UINT8> frameV2(UINT32 msgid, UINT8 plen, UINT8 extra, bool sign = false)
+{
+    const UINT8 header[] = {MAVLINK_STX_V2, plen, (UINT8)(sign ? MAVLINK_IFLAG_SIGNED : 0), 0, 7, 1, 1,
+                            (UINT8)msgid, (UINT8)(msgid >> 8), (UINT8)(msgid >> 16)};
+    std::vector<UINT8> frame(header, header + sizeof(header));
+    for (UINT8 i = 0; i < plen; i++)
+        frame.push_back(i * 3 + 1);
+    seal(frame, extra);
+    if (sign)
+        frame.resize(frame.size() + MAVLINK_SIGNATURE_LEN, 0xA5);
+    return frame;
+}
+
+//---------------------------------------------------------------------------------
+static std::vector<UINT8> frameV1(UINT8 msgid, UINT8 plen, UINT8 extra)
+{
+    const UINT8 header[] = {MAVLINK_STX_V1, plen, 7, 1, 1, msgid};
+    std::vector<UINT8> frame(header, header + sizeof(header));
+    for (UINT8 i = 0; i < plen; i++)
+        frame.push_back(i + 2);
+    seal(frame, extra);
+    return frame;
+}
+
+//---------------------------------------------------------------------------------
+//-- Feeds input in chunks of at most step bytes and collects what comes out
+static std::vector<Piece> run(const std::vector<UINT8> &input, UINT32 step)
+{
+    MavlinkFramer framer;
+    std::vector<Piece> out;
+    UINT32 pos = 0;
+    while (pos < input.size() || framer.pending())
+    {
+        UINT32 n = input.size() - pos;
+        if (n > step)
+            n = step;
+        UINT8 result;
+        UINT32 used = framer.parse(n ? &input[pos] : NULL, n, result);
+        pos += used;
+        if (result == FRAMER_NONE)
+        {
+            if (n == 0)
+                break;
+            continue;
+        }
+        Piece piece;
+        piece.result = result;
+        piece.msgid = (result == FRAMER_FRAME) ? framer.msgId() : 0;
+        piece.bytes.assign(framer.data(), framer.data() + framer.length());
+        //-- Adjacent raw runs are one run as far as the caller is concerned
+        if (result == FRAMER_RAW && !out.empty() && out.back().result == FRAMER_RAW)
+            out.back().bytes.insert(out.back().bytes.end(), piece.bytes.begin(), piece.bytes.end());
+        else
+            out.push_back(piece);
+    }
+    return out;
+}
+
+//---------------------------------------------------------------------------------
+static const UINT32 kSteps[] = {1, 3, 7, 1000};
+
+//---------------------------------------------------------------------------------
+static void test_valid()
+{
+    std::vector<UINT8> hb = frameV2(0, 9, 50);
+    std::vector<UINT8> v1 = frameV1(30, 28, 39);
+    std::vector<UINT8> other = frameV2(0x4E42, 20, 0x5A);
+    std::vector<UINT8> input;
+    input.insert(input.end(), hb.begin(), hb.end());
+    input.insert(input.end(), v1.begin(), v1.end());
+    input.insert(input.end(), other.begin(), other.end());
+    for (UINT32 s = 0; s < sizeof(kSteps) / sizeof(kSteps[0]); s++)
+    {
+        std::vector<Piece> out = run(input, kSteps[s]);
+        CHECK(out.size() == 3);
+        if (out.size() != 3)
+            continue;
+        CHECK(out[0].result == FRAMER_FRAME && out[0].msgid == 0 && out[0].bytes == hb);
+        CHECK(out[1].result == FRAMER_FRAME && out[1].msgid == 30 && out[1].bytes == v1);
+        CHECK(out[2].result == FRAMER_FRAME && out[2].msgid == 0x4E42 && out[2].bytes == other);
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- A known message with the wrong CRC_EXTRA, or a flipped payload bit
+static void test_bad_crc()
+{
+    std::vector<UINT8> wrong = frameV2(0, 9, 51);
+    std::vector<UINT8> flipped = frameV1(30, 28, 39);
+    flipped[10] ^= 0x10;
+    for (UINT32 s = 0; s < sizeof(kSteps) / sizeof(kSteps[0]); s++)
+    {
+        std::vector<Piece> out = run(wrong, kSteps[s]);
+        CHECK(out.size() == 1 && out[0].result == FRAMER_RAW && out[0].bytes == wrong);
+        out = run(flipped, kSteps[s]);
+        CHECK(out.size() == 1 && out[0].result == FRAMER_RAW && out[0].bytes == flipped);
+    }
+}
+
+//---------------------------------------------------------------------------------
+//-- A stray start byte swallows the head of a real frame as its "header";
+//   the framer has to find that frame again from the byte after it
+static void test_resync()
+{
+    std::vector<UINT8> hb = frameV2(0, 9, 50);
+    std::vector<UINT8> input;
+    input.push_back(0x11);
+    input.push_back(MAVLINK_STX_V1);
+    input.push_back(4);
+    input.insert(input.end(), hb.begin(), hb.end());
+    input.push_back(0x22);
+    for (UINT32 s = 0; s < sizeof(kSteps) / sizeof(kSteps[0]); s++)
+    {
+        std::vector<Piece> out = run(input, kSteps[s]);
+        CHECK(out.size() == 3);
+        if (out.size() != 3)
+            continue;
+        CHECK(out[0].result == FRAMER_RAW && out[0].bytes.size() == 3);
+        CHECK(out[1].result == FRAMER_FRAME && out[1].msgid == 0 && out[1].bytes == hb);
+        CHECK(out[2].result == FRAMER_RAW && out[2].bytes.size() == 1 && out[2].bytes[0] == 0x22);
+    }
+}
+
+//---------------------------------------------------------------------------------
+static void test_signed()
+{
+    std::vector<UINT8> cmd = frameV2(76, 33, 152, true);
+    std::vector<UINT8> flags = frameV2(76, 33, 152);
+    flags[2] = 0x80;
+    for (UINT32 s = 0; s < sizeof(kSteps) / sizeof(kSteps[0]); s++)
+    {
+        std::vector<Piece> out = run(cmd, kSteps[s]);
+        CHECK(out.size() == 1 && out[0].result == FRAMER_FRAME && out[0].msgid == 76 && out[0].bytes == cmd);
+        //-- Unknown incompatibility flags are never delimited
+        out = run(flags, kSteps[s]);
+        CHECK(out.size() == 1 && out[0].result == FRAMER_RAW && out[0].bytes == flags);
+    }
+}
+
+//---------------------------------------------------------------------------------
+static void test_crc()
+{
+    //-- CRC-16/MCRF4XX check value
+    const UINT8 check[] = "123456789";
+    CHECK(Mavlink_crc(check, 9) == 0x6F91);
+    UINT8 extra = 0;
+    CHECK(Mavlink_crcExtra(253, extra) && extra == 83);
+    CHECK(Mavlink_crcExtra(0, extra) && extra == 50);
+    CHECK(!Mavlink_crcExtra(3, extra));
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    test_crc();
+    test_valid();
+    test_bad_crc();
+    test_resync();
+    test_signed();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All MavlinkFramer tests passed\n");
+    return 0;
+}
@@ -0,0 +1,125 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file test_packet_pool.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for PacketPool: allocation until empty, reference counting
+ * and statistics.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "packet_pool.h"
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+//---------------------------------------------------------------------------------
+static void test_exhaust()
+{
+    PacketPool pool;
+    CHECK(pool.alloc() == NULL);
+    pool.begin();
+    PacketBuffer *buffers[PACKET_POOL_SIZE];
+    for (int i = 0; i < PACKET_POOL_SIZE; i++)
+    {
+        buffers[i] = pool.alloc();
+        CHECK(buffers[i] != NULL);
+        CHECK(buffers[i]->len == 0 && buffers[i]->refs == 1);
+        for (int j = 0; j < i; j++)
+            CHECK(buffers[i] != buffers[j]);
+    }
+    CHECK(pool.alloc() == NULL);
+    CHECK(pool.getStats().exhausted == 2);
+    CHECK(pool.getStats().in_use == PACKET_POOL_SIZE);
+
+    pool.release(buffers[1]);
+    PacketBuffer *again = pool.alloc();
+    CHECK(again == buffers[1]);
+    for (int i = 0; i < PACKET_POOL_SIZE; i++)
+        pool.release(buffers[i]);
+    CHECK(pool.getStats().in_use == 0);
+    CHECK(pool.getStats().high_water == PACKET_POOL_SIZE);
+    CHECK(pool.getStats().allocs == PACKET_POOL_SIZE + 1);
+}
+
+//---------------------------------------------------------------------------------
+//-- A buffer goes back only when its last holder lets go
+static void test_refs()
+{
+    PacketPool pool;
+    pool.begin();
+    PacketBuffer *buffer = pool.alloc();
+    pool.retain(buffer);
+    pool.retain(buffer);
+    pool.release(buffer);
+    pool.release(buffer);
+    CHECK(pool.getStats().in_use == 1);
+    pool.release(buffer);
+    CHECK(pool.getStats().in_use == 0);
+    //-- One release too many must not put it on the free list twice
+    pool.release(buffer);
+    CHECK(pool.getStats().bad_releases == 1);
+    CHECK(pool.getStats().in_use == 0);
+    CHECK(pool.alloc() == buffer);
+    CHECK(pool.alloc() != buffer);
+}
+
+//---------------------------------------------------------------------------------
+//-- begin() again must not lose buffers that are in use
+static void test_begin_once()
+{
+    PacketPool pool;
+    pool.begin();
+    PacketBuffer *buffer = pool.alloc();
+    pool.begin();
+    for (int i = 1; i < PACKET_POOL_SIZE; i++)
+        CHECK(pool.alloc() != buffer);
+    CHECK(pool.alloc() == NULL);
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    test_exhaust();
+    test_refs();
+    test_begin_once();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All PacketPool tests passed\n");
+    return 0;
+}
@@ -0,0 +1,182 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+/**
+ * @file test_parameters.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for EEPROM persistence: a save round trips, a blank EEPROM
+ * loads defaults, and saves from older layouts keep their parameters
+ * while the ones appended since start from their defaults.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "parameters.h"
+#include "EEPROM.h"
+
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+//---------------------------------------------------------------------------------
+static void blank()
+{
+    memset(EEPROM.getDataPtr(), 0xFF, EEPROM_SPACE);
+}
+
+//---------------------------------------------------------------------------------
+//-- What an older firmware saved: its first count parameters, zeros up to
+//   its EEPROM space and the CRC at crc_add, without a layout word
+static void saveOld(int count, UINT32 space, UINT32 crc_add)
+{
+    UINT8 *data = EEPROM.getDataPtr();
+    memset(data, 0xFF, EEPROM_SPACE);
+    memset(data, 0, space);
+    UINT32 address = 0;
+    for (int i = 0; i < count; i++)
+    {
+        ParameterFields *param = Param_getAt(i);
+        memcpy(&data[address], param->value, param->length);
+        address += param->length;
+    }
+    //-- CRC-32 without the final inversion, bit by bit
+    UINT32 crc = 0;
+    for (UINT32 i = 0; i < address; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+    }
+    EEPROM.put(crc_add, crc);
+}
+
+//---------------------------------------------------------------------------------
+static void customize()
+{
+    resetToDefaults();
+    setUartBaudRate(57600);
+    setWifiSsid("Field");
+    setQueueTimeout(25);
+    setUartTxPolicy(UART_TX_DROP_NEWEST);
+    setRateLimit(0, RATE_LIMIT_RULE(30, 5));
+    setWifiTcpPort(5760);
+}
+
+//---------------------------------------------------------------------------------
+static void test_round_trip()
+{
+    customize();
+    Eeprom_saveAllParams();
+    resetToDefaults();
+    Eeprom_loadAllParams();
+    CHECK(getUartBaudRate() == 57600);
+    CHECK(strcmp(getWifiSsid(), "Field") == 0);
+    CHECK(getQueueTimeout() == 25);
+    CHECK(getUartTxPolicy() == UART_TX_DROP_NEWEST);
+    CHECK(getRateLimit(0) == RATE_LIMIT_RULE(30, 5));
+    CHECK(getWifiTcpPort() == 5760);
+}
+
+//---------------------------------------------------------------------------------
+static void test_blank()
+{
+    blank();
+    customize();
+    Eeprom_loadAllParams();
+    CHECK(getUartBaudRate() == 57600);
+    CHECK(strcmp(getWifiSsid(), "Field") == 0);
+}
+
+//---------------------------------------------------------------------------------
+//-- The original 32 word layout ended at UART_BAUDRATE, and its CRC sits
+//   where RATE_LIMIT3 is now
+static void test_original_layout()
+{
+    customize();
+    saveOld(ID_UART + 1, 32 * sizeof(UINT32), EEPROM_LEGACY_CRC_ADD);
+    resetToDefaults();
+    Eeprom_loadAllParams();
+    CHECK(getUartBaudRate() == 57600);
+    CHECK(strcmp(getWifiSsid(), "Field") == 0);
+    CHECK(getQueueTimeout() == DEFAULT_QUEUE_TIMEOUT);
+    CHECK(getUartTxPolicy() == DEFAULT_UART_TX_POLICY);
+    for (UINT8 i = 0; i < RATE_LIMIT_SLOTS; i++)
+        CHECK(getRateLimit(i) == 0);
+    CHECK(getWifiTcpPort() == DEFAULT_TCP_PORT);
+}
+
+//---------------------------------------------------------------------------------
+//-- Grown to 48 words with the rate limits, still without a layout word
+static void test_grown_layout()
+{
+    customize();
+    saveOld(ID_RATELIMIT8 + 1, EEPROM_SPACE, EEPROM_CRC_ADD);
+    resetToDefaults();
+    Eeprom_loadAllParams();
+    CHECK(getUartBaudRate() == 57600);
+    CHECK(getQueueTimeout() == 25);
+    CHECK(getUartTxPolicy() == UART_TX_DROP_NEWEST);
+    CHECK(getRateLimit(0) == RATE_LIMIT_RULE(30, 5));
+    CHECK(getWifiTcpPort() == DEFAULT_TCP_PORT);
+}
+
+//---------------------------------------------------------------------------------
+//-- A save that does not match its CRC is not trusted at all
+static void test_corrupt()
+{
+    customize();
+    Eeprom_saveAllParams();
+    EEPROM.write(0, EEPROM.read(0) ^ 1);
+    resetToDefaults();
+    Eeprom_loadAllParams();
+    CHECK(getUartBaudRate() == DEFAULT_UART_SPEED);
+    CHECK(getQueueTimeout() == DEFAULT_QUEUE_TIMEOUT);
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    EEPROM.begin(EEPROM_SPACE);
+    test_round_trip();
+    test_blank();
+    test_original_layout();
+    test_grown_layout();
+    test_corrupt();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All parameter tests passed\n");
+    return 0;
+}
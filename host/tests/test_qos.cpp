@@ -0,0 +1,160 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file test_qos.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for QosQueue: message classes, strict priority order and
+ * which class gives way when the queues are full.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "qos.h"
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+#define RECORD_LEN  250     // Four of these fill a class, eight the whole queue
+
+//---------------------------------------------------------------------------------
+static void test_classify()
+{
+    QosQueue qos;
+    CHECK(qos.classify(0) == QOS_CRITICAL);     // HEARTBEAT
+    CHECK(qos.classify(77) == QOS_CRITICAL);    // COMMAND_ACK
+    CHECK(qos.classify(33) == QOS_HIGH);        // GLOBAL_POSITION_INT
+    CHECK(qos.classify(22) == QOS_BULK);        // PARAM_VALUE
+    CHECK(qos.classify(120) == QOS_BULK);       // LOG_DATA
+    CHECK(qos.classify(2) == QOS_NORMAL);       // SYSTEM_TIME (not listed)
+    CHECK(qos.classify(12345) == QOS_NORMAL);
+    CHECK(qos.getStats(QOS_CRITICAL).frames == 2);
+    CHECK(qos.getStats(QOS_NORMAL).frames == 2);
+}
+
+//---------------------------------------------------------------------------------
+//-- Highest class first, oldest first within a class, fields preserved
+static void test_order()
+{
+    QosQueue qos;
+    UINT8 data[QOS_RECORD_MAX];
+    for (int i = 0; i < 3; i++)
+    {
+        data[0] = QOS_BULK;
+        data[1] = i;
+        qos.push(QOS_BULK, data, 10, 0x01, true);
+    }
+    data[0] = QOS_CRITICAL;
+    data[1] = 0;
+    qos.push(QOS_CRITICAL, data, 20, 0x04, true);
+    data[0] = QOS_NORMAL;
+    qos.push(QOS_NORMAL, data, 5, 0x02, false);
+    CHECK(qos.queued() == 3 * 14 + 24 + 9);
+
+    UINT8 out[QOS_RECORD_MAX];
+    UINT8 clients;
+    bool frame;
+    CHECK(qos.pop(out, clients, frame) == 20 && out[0] == QOS_CRITICAL && clients == 0x04 && frame);
+    CHECK(qos.pop(out, clients, frame) == 5 && out[0] == QOS_NORMAL && clients == 0x02 && !frame);
+    for (int i = 0; i < 3; i++)
+        CHECK(qos.pop(out, clients, frame) == 10 && out[0] == QOS_BULK && out[1] == i);
+    CHECK(qos.pop(out, clients, frame) == 0);
+    CHECK(qos.empty());
+}
+
+//---------------------------------------------------------------------------------
+//-- A full queue gives way from the lowest class, and a class never pushes
+//   out a higher one
+static void test_congestion()
+{
+    QosQueue qos;
+    UINT8 data[QOS_RECORD_MAX];
+    memset(data, 0, sizeof(data));
+    UINT32 dropped = 0;
+    for (int i = 0; i < 4; i++)
+        dropped += qos.push(QOS_BULK, data, RECORD_LEN, 0x01, true);
+    for (int i = 0; i < 4; i++)
+        dropped += qos.push(QOS_HIGH, data, RECORD_LEN, 0x01, true);
+    CHECK(dropped == 0);
+
+    //-- Over the limit: bulk goes, critical stays
+    CHECK(qos.push(QOS_CRITICAL, data, RECORD_LEN, 0x01, true) == RECORD_LEN);
+    CHECK(qos.getStats(QOS_BULK).dropped == 1);
+    CHECK(qos.getStats(QOS_BULK).drop_bytes == RECORD_LEN);
+    CHECK(qos.getStats(QOS_CRITICAL).queued == 1);
+    CHECK(qos.queued() <= QOS_QUEUE_LIMIT);
+
+    //-- Bulk only replaces its own oldest data
+    CHECK(qos.push(QOS_BULK, data, RECORD_LEN, 0x01, true) == RECORD_LEN);
+    CHECK(qos.getStats(QOS_BULK).dropped == 2);
+    CHECK(qos.getStats(QOS_HIGH).dropped == 0);
+
+    //-- Critical keeps winning until bulk is gone
+    for (int i = 0; i < 3; i++)
+        CHECK(qos.push(QOS_CRITICAL, data, RECORD_LEN, 0x01, true) == RECORD_LEN);
+    CHECK(qos.getStats(QOS_BULK).dropped == 5);
+    CHECK(qos.getStats(QOS_HIGH).dropped == 0);
+    CHECK(qos.getStats(QOS_CRITICAL).dropped == 0);
+
+    //-- Full of higher classes: high replaces its own, bulk finds no room
+    CHECK(qos.push(QOS_HIGH, data, RECORD_LEN, 0x01, true) == RECORD_LEN);
+    CHECK(qos.getStats(QOS_HIGH).dropped == 1);
+    UINT32 before = qos.getStats(QOS_BULK).drop_bytes;
+    CHECK(qos.push(QOS_BULK, data, RECORD_LEN, 0x01, true) == RECORD_LEN);
+    CHECK(qos.getStats(QOS_BULK).drop_bytes == before + RECORD_LEN);
+    CHECK(qos.getStats(QOS_BULK).high_water == 4 * (RECORD_LEN + 4));
+
+    UINT8 out[QOS_RECORD_MAX];
+    UINT8 clients;
+    bool frame;
+    UINT32 total = 0;
+    while (qos.pop(out, clients, frame))
+        total++;
+    CHECK(total == 4 + 4);
+    CHECK(qos.queued() == 0);
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    test_classify();
+    test_order();
+    test_congestion();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All QosQueue tests passed\n");
+    return 0;
+}
@@ -0,0 +1,128 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file test_rate_limiter.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for RateLimiter: rule parsing, the rate frames pass at, and
+ * lookup of indexed and searched message IDs.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "rate_limiter.h"
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+//---------------------------------------------------------------------------------
+static void test_parse()
+{
+    CHECK(RateLimiter::parseRule("22:5") == RATE_LIMIT_RULE(22, 5));
+    CHECK(RateLimiter::parseRule("12900:255") == RATE_LIMIT_RULE(12900, 255));
+    CHECK(RateLimiter::parseRule("") == 0);
+    CHECK(RateLimiter::parseRule("22") == 0);
+    CHECK(RateLimiter::parseRule("22:0") == 0);
+    CHECK(RateLimiter::parseRule("22:256") == 0);
+    CHECK(RateLimiter::parseRule("22:5x") == 0);
+    CHECK(RateLimiter::parseRule(":5") == 0);
+    CHECK(RateLimiter::parseRule("16777216:5") == 0);
+}
+
+//---------------------------------------------------------------------------------
+//-- A 50 Hz stream limited to 10 Hz, for 10 s
+static void test_rate()
+{
+    RateLimiter limiter;
+    limiter.setRule(0, RATE_LIMIT_RULE(30, 10));
+    UINT32 passed = 0;
+    UINT32 other = 0;
+    for (UINT32 now = 1000; now < 11000; now += 20)
+    {
+        passed += limiter.allow(30, now);
+        other += limiter.allow(31, now);
+    }
+    //-- The steady rate plus the initial burst
+    CHECK(passed >= 100 && passed <= 100 + RATE_LIMIT_BURST);
+    CHECK(other == 500);
+    CHECK(limiter.at(0).passed == passed);
+    CHECK(limiter.at(0).decimated == 500 - passed);
+    CHECK(limiter.decimated() == 500 - passed);
+
+    //-- Slower than the limit: nothing is dropped
+    RateLimiter slow;
+    slow.setRule(3, RATE_LIMIT_RULE(0, 2));
+    for (UINT32 now = 0; now < 10000; now += 1000)
+        CHECK(slow.allow(0, now));
+    CHECK(slow.decimated() == 0);
+}
+
+//---------------------------------------------------------------------------------
+//-- IDs past the index are searched; clearing a rule removes it from both
+static void test_lookup()
+{
+    RateLimiter limiter;
+    limiter.setRule(1, RATE_LIMIT_RULE(511, 1));
+    limiter.setRule(2, RATE_LIMIT_RULE(512, 1));
+    limiter.setRule(7, RATE_LIMIT_RULE(70000, 1));
+    const UINT32 ids[] = { 511, 512, 70000 };
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(limiter.allow(ids[i], 5000));
+        CHECK(limiter.allow(ids[i], 5000));
+        CHECK(!limiter.allow(ids[i], 5000));
+        //-- Neighbours are not limited
+        CHECK(limiter.allow(ids[i] + 7, 5000) && limiter.allow(ids[i] + 7, 5000) && limiter.allow(ids[i] + 7, 5000));
+    }
+    limiter.setRule(1, 0);
+    limiter.setRule(7, 0);
+    CHECK(limiter.allow(511, 5000));
+    CHECK(limiter.allow(70000, 5000));
+    CHECK(!limiter.allow(512, 5000));
+    CHECK(limiter.at(1).rule == 0);
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    test_parse();
+    test_rate();
+    test_lookup();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All RateLimiter tests passed\n");
+    return 0;
+}
@@ -0,0 +1,326 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file test_reliable.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for RelSender and RelReceiver: duplicate suppression (late
+ * originals too) and the selective ACK, fast and timed retransmits, giving up on a datagram, and
+ * a lossy link that still delivers everything exactly once.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "reliable.h"
+
+#include <stdlib.h>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+//---------------------------------------------------------------------------------
+static void datagram(UINT8 *out, UINT16 seq, UINT16 base)
+{
+    out[0] = REL_MAGIC;
+    out[1] = REL_DATA;
+    out[2] = seq & 0xFF;
+    out[3] = seq >> 8;
+    out[4] = base & 0xFF;
+    out[5] = base >> 8;
+}
+
+//---------------------------------------------------------------------------------
+static void test_receiver()
+{
+    RelReceiver rx;
+    UINT8 data[REL_HEADER_LEN];
+    UINT8 ack[REL_ACK_LEN];
+    CHECK(!rx.active());
+    //-- Joined late: 98 and 99 are still owed
+    datagram(data, 100, 98);
+    CHECK(RelReceiver::isData(data, sizeof(data)));
+    CHECK(!RelReceiver::isData(data, REL_HEADER_LEN - 1));
+    CHECK(rx.receive(data));
+    CHECK(rx.active());
+    CHECK(!rx.receive(data));
+    rx.ack(ack);
+    CHECK(RelSender::isAck(ack, sizeof(ack)));
+    CHECK((ack[2] | (ack[3] << 8)) == 98);
+    CHECK(ack[4] == 0x02 && ack[5] == 0 && ack[6] == 0 && ack[7] == 0);
+    datagram(data, 98, 98);
+    CHECK(rx.receive(data));
+    datagram(data, 99, 98);
+    CHECK(rx.receive(data));
+    //-- 101 lost, 102 and 104 arrive
+    datagram(data, 102, 101);
+    CHECK(rx.receive(data));
+    datagram(data, 104, 101);
+    CHECK(rx.receive(data));
+    CHECK(!rx.receive(data));
+    rx.ack(ack);
+    CHECK((ack[2] | (ack[3] << 8)) == 101);
+    CHECK(ack[4] == 0x05 && ack[5] == 0 && ack[6] == 0 && ack[7] == 0);
+    //-- The hole fills: everything up to 102 is done
+    datagram(data, 101, 101);
+    CHECK(rx.receive(data));
+    rx.ack(ack);
+    CHECK((ack[2] | (ack[3] << 8)) == 103);
+    CHECK(ack[4] == 0x01);
+    CHECK(rx.getStats().received == 6);
+    CHECK(rx.getStats().duplicates == 2);
+    CHECK(rx.getStats().acks == 3);
+    //-- A late retransmission from before the last ACK
+    datagram(data, 99, 98);
+    CHECK(!rx.receive(data));
+    CHECK(rx.getStats().restarts == 0);
+
+    //-- The proxy gave up on 103
+    datagram(data, 106, 105);
+    CHECK(rx.receive(data));
+    CHECK(rx.getStats().skipped == 1);
+    rx.ack(ack);
+    CHECK((ack[2] | (ack[3] << 8)) == 105);
+    CHECK(ack[4] == 0x01);
+
+    //-- Across the wrap, then a restarted proxy
+    RelReceiver wrap;
+    datagram(data, 0xFFFE, 0xFFFE);
+    CHECK(wrap.receive(data));
+    datagram(data, 0xFFFF, 0xFFFE);
+    CHECK(wrap.receive(data));
+    datagram(data, 0, 0xFFFF);
+    CHECK(wrap.receive(data));
+    datagram(data, 0xFFFF, 0xFFFF);
+    CHECK(!wrap.receive(data));
+    CHECK(wrap.getStats().restarts == 0);
+    for (UINT16 seq = 1; seq < 100; seq++)
+    {
+        datagram(data, seq, seq);
+        CHECK(wrap.receive(data));
+    }
+    datagram(data, 0x8000, 0x8000);
+    CHECK(wrap.receive(data));
+    CHECK(wrap.getStats().restarts == 1);
+    CHECK(wrap.getStats().skipped == 0);
+    wrap.ack(ack);
+    CHECK((ack[2] | (ack[3] << 8)) == 0x8001);
+}
+
+//---------------------------------------------------------------------------------
+static void test_stale_original()
+{
+    RelReceiver rx;
+    UINT8 data[REL_HEADER_LEN];
+    UINT8 ack[REL_ACK_LEN];
+    //-- 100 only arrives as a retransmission, after 101..131
+    for (UINT16 seq = 0; seq <= 140; seq++)
+    {
+        if (seq == 100)
+            continue;
+        datagram(data, seq, (seq > 100 && seq < 132) ? 100 : seq);
+        CHECK(rx.receive(data));
+        if (seq == 131)
+        {
+            datagram(data, 100, 100);
+            CHECK(rx.receive(data));
+        }
+    }
+    //-- Then the original turns up: a duplicate, not a restarted proxy
+    datagram(data, 100, 69);
+    CHECK(!rx.receive(data));
+    CHECK(rx.getStats().received == 141);
+    CHECK(rx.getStats().duplicates == 1);
+    CHECK(rx.getStats().restarts == 0);
+    CHECK(rx.getStats().skipped == 0);
+    rx.ack(ack);
+    CHECK((ack[2] | (ack[3] << 8)) == 141);
+    CHECK(ack[4] == 0);
+}
+
+//---------------------------------------------------------------------------------
+static void test_fast_retransmit()
+{
+    RelSender tx;
+    RelReceiver rx;
+    UINT8 payload[8] = { 0xFE, 1, 2, 3, 4, 5, 6, 7 };
+    UINT8 ack[REL_ACK_LEN];
+    const UINT8 *out;
+    UINT32 now = 1000000;
+
+    CHECK(!tx.pending());
+    //-- Round trip of 2 ms from a clean exchange
+    CHECK(tx.send(payload, sizeof(payload), now, out) == REL_HEADER_LEN + sizeof(payload));
+    CHECK(out[0] == REL_MAGIC && out[1] == REL_DATA && out[REL_HEADER_LEN] == 0xFE);
+    CHECK(tx.pending());
+    CHECK(rx.receive(out));
+    rx.ack(ack);
+    tx.ack(ack, now + 2000);
+    CHECK(!tx.pending());
+    CHECK(tx.getStats().srtt_us == 2000);
+
+    //-- Seq 1 is lost, 2 arrives: 1 goes again without waiting for the timeout
+    now += 10000;
+    tx.send(payload, sizeof(payload), now, out);
+    UINT8 lost[REL_HEADER_LEN + sizeof(payload)];
+    memcpy(lost, out, sizeof(lost));
+    tx.send(payload, sizeof(payload), now + 100, out);
+    CHECK(rx.receive(out));
+    rx.ack(ack);
+    tx.ack(ack, now + 2100);
+    CHECK(tx.getStats().acked == 2);
+    CHECK(tx.poll(now + 2100, out) == sizeof(lost));
+    CHECK(!memcmp(out, lost, sizeof(lost)));
+    CHECK(tx.poll(now + 2100, out) == 0);
+    CHECK(tx.getStats().fast == 1);
+    CHECK(rx.receive(out));
+    rx.ack(ack);
+    tx.ack(ack, now + 4100);
+    CHECK(!tx.pending());
+    CHECK(tx.getStats().recovered == 1);
+    CHECK(tx.getStats().recovery_max_us == 4100);
+    //-- No round trip sample from the retransmitted one
+    CHECK(tx.getStats().srtt_us == 2000);
+}
+
+//---------------------------------------------------------------------------------
+static void test_timeout()
+{
+    RelSender tx;
+    UINT8 payload[4] = { 1, 2, 3, 4 };
+    const UINT8 *out;
+    UINT32 now = 0xFFFFF000;    // Across the clock wrap
+
+    tx.send(payload, sizeof(payload), now, out);
+    CHECK(tx.poll(now + REL_MIN_RTO - 1, out) == 0);
+    for (UINT8 i = 0; i < REL_MAX_RETRIES; i++)
+    {
+        now += REL_MIN_RTO;
+        CHECK(tx.poll(now, out) == REL_HEADER_LEN + sizeof(payload));
+        CHECK(tx.poll(now, out) == 0);
+    }
+    now += REL_MIN_RTO;
+    CHECK(tx.poll(now, out) == 0);
+    CHECK(!tx.pending());
+    CHECK(tx.getStats().retransmits == REL_MAX_RETRIES);
+    CHECK(tx.getStats().fast == 0);
+    CHECK(tx.getStats().abandoned == 1);
+
+    //-- A full window gives up on the oldest to make room
+    RelSender full;
+    for (UINT16 i = 0; i <= REL_WINDOW; i++)
+        full.send(payload, sizeof(payload), 0, out);
+    CHECK(full.getStats().abandoned == 1);
+    CHECK((out[2] | (out[3] << 8)) == REL_WINDOW);
+    CHECK(full.pending());
+}
+
+//---------------------------------------------------------------------------------
+//-- Both directions drop a third of the datagrams; every payload still arrives
+//   exactly once
+static void test_lossy_link()
+{
+    RelSender tx;
+    RelReceiver rx;
+    std::vector<UINT32> delivered(200, 0);
+    UINT8 ack[REL_ACK_LEN];
+    const UINT8 *out;
+    UINT32 now = 0;
+    UINT32 len;
+    srand(7);
+
+    for (UINT32 n = 0; n < delivered.size(); n++)
+    {
+        UINT8 payload[4] = { (UINT8)n, (UINT8)(n >> 8), 0, 0 };
+        len = tx.send(payload, sizeof(payload), now, out);
+        if (rand() % 3)
+        {
+            if (rx.receive(out))
+                delivered[out[REL_HEADER_LEN] | (out[REL_HEADER_LEN + 1] << 8)]++;
+            rx.ack(ack);
+            if (rand() % 3)
+                tx.ack(ack, now + 1000);
+        }
+        now += 1000;
+        while ((len = tx.poll(now, out)) > 0)
+        {
+            if (rand() % 3)
+            {
+                if (rx.receive(out))
+                    delivered[out[REL_HEADER_LEN] | (out[REL_HEADER_LEN + 1] << 8)]++;
+                rx.ack(ack);
+                if (rand() % 3)
+                    tx.ack(ack, now + 1000);
+            }
+        }
+    }
+    //-- Drain: the link stops losing
+    for (UINT32 i = 0; i < 100 && tx.pending(); i++)
+    {
+        now += REL_MIN_RTO;
+        while ((len = tx.poll(now, out)) > 0)
+        {
+            if (rx.receive(out))
+                delivered[out[REL_HEADER_LEN] | (out[REL_HEADER_LEN + 1] << 8)]++;
+            rx.ack(ack);
+            tx.ack(ack, now + 1000);
+        }
+    }
+    CHECK(!tx.pending());
+    CHECK(tx.getStats().abandoned == 0);
+    CHECK(tx.getStats().retransmits > 0);
+    CHECK(rx.getStats().skipped == 0);
+    UINT32 once = 0;
+    for (UINT32 n = 0; n < delivered.size(); n++)
+        once += delivered[n] == 1;
+    CHECK(once == delivered.size());
+    CHECK(rx.getStats().received == delivered.size());
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    test_receiver();
+    test_stale_original();
+    test_fast_retransmit();
+    test_timeout();
+    test_lossy_link();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All reliable uplink tests passed\n");
+    return 0;
+}
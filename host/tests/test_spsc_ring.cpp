@@ -0,0 +1,227 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file test_spsc_ring.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for SpscRing: copying and in-place access, wrap around, full
+ * and empty rings, and a producer and consumer on two threads.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "spsc_ring.h"
+
+#include <thread>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+//---------------------------------------------------------------------------------
+static void test_empty()
+{
+    SpscRing<16> ring;
+    UINT32 len;
+    CHECK(ring.capacity() == 16);
+    CHECK(ring.empty());
+    CHECK(ring.used() == 0);
+    CHECK(ring.space() == 16);
+    ring.readSpan(len);
+    CHECK(len == 0);
+    UINT8 out[4];
+    CHECK(ring.read(out, sizeof(out)) == 0);
+}
+
+//---------------------------------------------------------------------------------
+static void test_copy()
+{
+    SpscRing<16> ring;
+    const UINT8 in[] = { 1, 2, 3, 4, 5 };
+    UINT8 out[8];
+    CHECK(ring.write(in, sizeof(in)) == 5);
+    CHECK(ring.used() == 5);
+    CHECK(ring.space() == 11);
+    CHECK(ring.read(out, 3) == 3);
+    CHECK(out[0] == 1 && out[1] == 2 && out[2] == 3);
+    CHECK(ring.read(out, sizeof(out)) == 2);
+    CHECK(out[0] == 4 && out[1] == 5);
+    CHECK(ring.empty());
+}
+
+//---------------------------------------------------------------------------------
+static void test_full()
+{
+    SpscRing<8> ring;
+    UINT8 in[12];
+    for (UINT32 i = 0; i < sizeof(in); i++)
+        in[i] = i;
+    CHECK(ring.write(in, sizeof(in)) == 8);
+    CHECK(ring.space() == 0);
+    UINT32 len;
+    ring.writeSpan(len);
+    CHECK(len == 0);
+    CHECK(ring.write(in, 1) == 0);
+    UINT8 out[8];
+    CHECK(ring.read(out, sizeof(out)) == 8);
+    CHECK(memcmp(in, out, 8) == 0);
+}
+
+//---------------------------------------------------------------------------------
+//-- Spans stop at the end of the buffer; copies carry on at the start
+static void test_wrap()
+{
+    SpscRing<8> ring;
+    UINT8 in[8] = { 10, 11, 12, 13, 14, 15, 16, 17 };
+    UINT8 out[8];
+    ring.write(in, 6);
+    ring.read(out, 6);
+
+    UINT32 len;
+    UINT8 *wspan = ring.writeSpan(len);
+    CHECK(len == 2);
+    wspan[0] = 20;
+    wspan[1] = 21;
+    ring.commit(2);
+    wspan = ring.writeSpan(len);
+    CHECK(len == 6);
+    wspan[0] = 22;
+    ring.commit(1);
+    CHECK(ring.used() == 3);
+
+    const UINT8 *rspan = ring.readSpan(len);
+    CHECK(len == 2);
+    CHECK(rspan[0] == 20 && rspan[1] == 21);
+    ring.consume(1);
+    rspan = ring.readSpan(len);
+    CHECK(len == 1 && rspan[0] == 21);
+    ring.consume(1);
+    rspan = ring.readSpan(len);
+    CHECK(len == 1 && rspan[0] == 22);
+    ring.consume(1);
+    CHECK(ring.empty());
+
+    //-- Copying across the end of the buffer
+    ring.write(in, 6);
+    ring.read(out, 6);
+    CHECK(ring.write(in, 8) == 8);
+    CHECK(ring.read(out, 8) == 8);
+    CHECK(memcmp(in, out, 8) == 0);
+}
+
+//---------------------------------------------------------------------------------
+static void test_reset()
+{
+    SpscRing<8> ring;
+    const UINT8 in[] = { 1, 2, 3 };
+    ring.write(in, sizeof(in));
+    ring.reset();
+    CHECK(ring.empty());
+    UINT32 len;
+    UINT8 *span = ring.writeSpan(len);
+    CHECK(len == 8);
+    CHECK(span == ring.readSpan(len));
+}
+
+//---------------------------------------------------------------------------------
+//-- Many passes around the buffer at a length that does not divide its size
+static void test_many_passes()
+{
+    SpscRing<8> ring;
+    UINT8 in[5] = { 1, 2, 3, 4, 5 };
+    UINT8 out[5];
+    for (UINT32 i = 0; i < 300000; i++)
+    {
+        in[0] = i;
+        if (ring.write(in, 5) != 5 || ring.read(out, 5) != 5 || out[0] != (UINT8)i)
+        {
+            CHECK(false);
+            break;
+        }
+    }
+    CHECK(ring.empty());
+}
+
+//---------------------------------------------------------------------------------
+//-- Every byte arrives once and in order with the two sides on their own threads
+static void test_threads()
+{
+    static SpscRing<1024> ring;
+    const UINT32 total = 256 * 1024;
+    std::thread producer([&]() {
+        UINT32 sent = 0;
+        while (sent < total)
+        {
+            UINT32 len;
+            UINT8 *span = ring.writeSpan(len);
+            if (len > total - sent)
+                len = total - sent;
+            for (UINT32 i = 0; i < len; i++)
+                span[i] = (UINT8)(sent + i);
+            ring.commit(len);
+            sent += len;
+        }
+    });
+    UINT32 received = 0;
+    bool ordered = true;
+    while (received < total)
+    {
+        UINT32 len;
+        const UINT8 *span = ring.readSpan(len);
+        for (UINT32 i = 0; i < len; i++)
+            ordered &= span[i] == (UINT8)(received + i);
+        ring.consume(len);
+        received += len;
+    }
+    producer.join();
+    CHECK(ordered);
+    CHECK(ring.empty());
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    test_empty();
+    test_copy();
+    test_full();
+    test_wrap();
+    test_reset();
+    test_many_passes();
+    test_threads();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All SpscRing tests passed\n");
+    return 0;
+}
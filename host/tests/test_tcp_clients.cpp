@@ -0,0 +1,247 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file test_tcp_clients.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for TcpClientTable against a scripted BridgeTcp: accepting and
+ * rejecting connections, writing straight from the datagram, queueing for
+ * a slow client, trimming whole datagrams and dropping a stalled client.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "tcp_clients.h"
+
+#include <string>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+//-- Connections whose send window the test sets
+class ScriptedTcp : public BridgeTcp
+{
+public:
+    ScriptedTcp() : pending(0), rejected(0)
+    {
+        for (int i = 0; i < TCP_MAX_CLIENTS; i++)
+        {
+            open[i] = false;
+            window[i] = 0;
+            writes[i] = 0;
+        }
+    }
+
+    bool    begin               (UINT16) { return true; }
+    bool    accept              (UINT8 slot)
+    {
+        if (!pending)
+            return false;
+        pending--;
+        open[slot] = true;
+        window[slot] = 4096;
+        out[slot].clear();
+        in[slot].clear();
+        return true;
+    }
+    bool    reject              ()
+    {
+        if (!pending)
+            return false;
+        pending--;
+        rejected++;
+        return true;
+    }
+    bool    connected           (UINT8 slot) { return open[slot]; }
+    UINT32  read                (UINT8 slot, UINT8 *buffer, UINT32 len)
+    {
+        if (len > in[slot].size())
+            len = in[slot].size();
+        memcpy(buffer, in[slot].data(), len);
+        in[slot].erase(0, len);
+        return len;
+    }
+    UINT32  availableForWrite   (UINT8 slot) { return window[slot]; }
+    UINT32  write               (UINT8 slot, const UINT8 *buffer, UINT32 len)
+    {
+        if (len > window[slot])
+            len = window[slot];
+        out[slot].append((const char *)buffer, len);
+        window[slot] -= len;
+        writes[slot]++;
+        return len;
+    }
+    void    close               (UINT8 slot) { open[slot] = false; }
+    UINT32  remoteIP            (UINT8 slot) { return 0x0101A8C0 + (slot << 24); }
+    UINT16  remotePort          (UINT8 slot) { return 50000 + slot; }
+
+    int         pending;
+    int         rejected;
+    bool        open[TCP_MAX_CLIENTS];
+    UINT32      window[TCP_MAX_CLIENTS];
+    UINT32      writes[TCP_MAX_CLIENTS];
+    std::string out[TCP_MAX_CLIENTS];
+    std::string in[TCP_MAX_CLIENTS];
+};
+
+//---------------------------------------------------------------------------------
+static std::string datagram(UINT8 tag, UINT32 len)
+{
+    std::string d(len, (char)tag);
+    d[0] = 0xFD;
+    return d;
+}
+
+//---------------------------------------------------------------------------------
+static void test_accept()
+{
+    ScriptedTcp tcp;
+    TcpClientTable table;
+    table.begin(NULL, 5760);
+    CHECK(!table.enabled());
+    table.begin(&tcp, 0);
+    CHECK(!table.enabled());
+    table.begin(&tcp, 5760);
+    CHECK(table.enabled());
+
+    tcp.pending = TCP_MAX_CLIENTS + 2;
+    CHECK(table.poll(0) == (1 << TCP_MAX_CLIENTS) - 1);
+    CHECK(table.mask() == (1 << TCP_MAX_CLIENTS) - 1);
+    CHECK(tcp.rejected == 2);
+    CHECK(table.getStats().accepted == TCP_MAX_CLIENTS);
+    CHECK(table.getStats().rejected == 2);
+    CHECK(table.at(1).port == 50001);
+
+    //-- A closed slot is reused by the next connection
+    tcp.open[1] = false;
+    CHECK(table.poll(10) == 0);
+    CHECK(table.mask() == (((1 << TCP_MAX_CLIENTS) - 1) & ~2));
+    CHECK(table.getStats().closed == 1);
+    tcp.pending = 1;
+    CHECK(table.poll(20) == 2);
+
+    //-- Uplink bytes are counted per client
+    UINT8 buffer[16];
+    tcp.in[2] = "hello";
+    CHECK(table.read(2, buffer, sizeof(buffer)) == 5);
+    CHECK(table.read(2, buffer, sizeof(buffer)) == 0);
+    CHECK(table.at(2).bytes_in == 5);
+}
+
+//---------------------------------------------------------------------------------
+static void test_send()
+{
+    ScriptedTcp tcp;
+    TcpClientTable table;
+    table.begin(&tcp, 5760);
+    tcp.pending = 2;
+    table.poll(0);
+
+    //-- Both keep up: written straight from the buffer, nothing queued
+    std::string a = datagram(1, 1000);
+    CHECK(table.send((const UINT8 *)a.data(), a.size(), 1) == 2);
+    CHECK(tcp.out[0] == a && tcp.out[1] == a);
+    CHECK(table.queued(0) == 0 && table.at(0).direct == a.size());
+
+    //-- Client 1 falls behind: the rest of the datagram waits in its queue
+    tcp.window[1] = 300;
+    std::string b = datagram(2, 1000);
+    CHECK(table.send((const UINT8 *)b.data(), b.size(), 2) == 2);
+    CHECK(tcp.out[0] == a + b);
+    CHECK(tcp.out[1] == a + b.substr(0, 300));
+    CHECK(table.queued(1) == 700);
+    CHECK(table.at(1).queue_high_water == 700);
+
+    //-- Behind a queue, later datagrams queue whole, or are trimmed whole
+    std::string c = datagram(3, 1000);
+    std::string d = datagram(4, 1000);
+    CHECK(table.send((const UINT8 *)c.data(), c.size(), 3) == 2);
+    CHECK(table.send((const UINT8 *)d.data(), d.size(), 4) == 1);
+    CHECK(table.queued(1) == 1700);
+    CHECK(table.at(1).trimmed == 1000);
+    CHECK(table.at(0).trimmed == 0);
+    CHECK(tcp.out[0] == a + b + c + d);
+
+    //-- Room again: the stream resumes where it stopped, frames intact
+    tcp.window[1] = 4096;
+    table.flush(5);
+    CHECK(table.queued(1) == 0);
+    CHECK(tcp.out[1] == a + b + c);
+    CHECK(table.at(1).bytes_out == a.size() + b.size() + c.size());
+    table.send((const UINT8 *)d.data(), d.size(), 6);
+    CHECK(tcp.out[1] == a + b + c + d);
+}
+
+//---------------------------------------------------------------------------------
+static void test_stall()
+{
+    ScriptedTcp tcp;
+    TcpClientTable table;
+    table.begin(&tcp, 5760);
+    tcp.pending = 2;
+    table.poll(0);
+
+    std::string a = datagram(1, 500);
+    tcp.window[0] = 100;
+    table.send((const UINT8 *)a.data(), a.size(), 1000);
+    CHECK(table.queued(0) == 400);
+    //-- Slow but moving is fine
+    tcp.window[0] = 10;
+    table.flush(1000 + TCP_STALL_TIMEOUT - 1);
+    table.flush(1000 + 2 * TCP_STALL_TIMEOUT - 2);
+    CHECK(table.mask() == 3);
+    //-- Taking nothing for TCP_STALL_TIMEOUT is not
+    table.flush(1000 + 3 * TCP_STALL_TIMEOUT);
+    CHECK(table.mask() == 2);
+    CHECK(!tcp.open[0]);
+    CHECK(table.getStats().stalled == 1);
+    //-- An idle client with nothing queued is never dropped
+    table.flush(1000 + 10 * TCP_STALL_TIMEOUT);
+    CHECK(table.mask() == 2);
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    test_accept();
+    test_send();
+    test_stall();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All TCP client tests passed\n");
+    return 0;
+}
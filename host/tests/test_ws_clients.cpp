@@ -0,0 +1,343 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2020, 2021 Masoud Iranmehr. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file test_ws_clients.cpp
+ * ESP8266 Wifi AP, UART/UDP Bridge - host build
+ *
+ * Unit tests for WsClientTable against a scripted BridgeTcp: the upgrade
+ * handshake, unmasking client frames in place, ping and close, server
+ * frames written as one piece with the datagram, a Close queued behind
+ * them, and slow handshakes.
+ *
+ * @author Masoud Iranmehr <masoud.iranmehr@gmail.com>
+ */
+
+#include "ws_clients.h"
+
+#include <string>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+//-- Connections whose send window the test sets
+class ScriptedTcp : public BridgeTcp
+{
+public:
+    ScriptedTcp() : pending(0), rejected(0)
+    {
+        for (int i = 0; i < TCP_MAX_CLIENTS; i++)
+        {
+            open[i] = false;
+            window[i] = 0;
+            writes[i] = 0;
+        }
+    }
+
+    bool    begin               (UINT16) { return true; }
+    bool    accept              (UINT8 slot)
+    {
+        if (!pending)
+            return false;
+        pending--;
+        open[slot] = true;
+        window[slot] = 4096;
+        out[slot].clear();
+        in[slot].clear();
+        return true;
+    }
+    bool    reject              ()
+    {
+        if (!pending)
+            return false;
+        pending--;
+        rejected++;
+        return true;
+    }
+    bool    connected           (UINT8 slot) { return open[slot]; }
+    UINT32  read                (UINT8 slot, UINT8 *buffer, UINT32 len)
+    {
+        if (len > in[slot].size())
+            len = in[slot].size();
+        memcpy(buffer, in[slot].data(), len);
+        in[slot].erase(0, len);
+        return len;
+    }
+    UINT32  availableForWrite   (UINT8 slot) { return window[slot]; }
+    UINT32  write               (UINT8 slot, const UINT8 *buffer, UINT32 len)
+    {
+        if (len > window[slot])
+            len = window[slot];
+        out[slot].append((const char *)buffer, len);
+        window[slot] -= len;
+        writes[slot]++;
+        return len;
+    }
+    void    close               (UINT8 slot) { open[slot] = false; }
+    UINT32  remoteIP            (UINT8 slot) { return 0x0101A8C0 + (slot << 24); }
+    UINT16  remotePort          (UINT8 slot) { return 50000 + slot; }
+
+    int         pending;
+    int         rejected;
+    bool        open[TCP_MAX_CLIENTS];
+    UINT32      window[TCP_MAX_CLIENTS];
+    UINT32      writes[TCP_MAX_CLIENTS];
+    std::string out[TCP_MAX_CLIENTS];
+    std::string in[TCP_MAX_CLIENTS];
+};
+
+//---------------------------------------------------------------------------------
+//-- The example request of RFC 6455, section 1.3
+static std::string request(const char *path)
+{
+    return std::string("GET ") + path + " HTTP/1.1\r\n"
+           "Host: server.example.com\r\n"
+           "Upgrade: websocket\r\n"
+           "Connection: Upgrade\r\n"
+           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+           "Origin: http://example.com\r\n"
+           "Sec-WebSocket-Version: 13\r\n\r\n";
+}
+
+//---------------------------------------------------------------------------------
+//-- A masked client frame
+static std::string frame(UINT8 opcode, const std::string &payload, bool fin = true)
+{
+    static const UINT8 key[4] = {0x37, 0xFA, 0x21, 0x3D};
+    std::string f;
+    f += (char)((fin ? 0x80 : 0x00) | opcode);
+    if (payload.size() < 126)
+        f += (char)(0x80 | payload.size());
+    else
+    {
+        f += (char)(0x80 | 126);
+        f += (char)(payload.size() >> 8);
+        f += (char)(payload.size() & 0xFF);
+    }
+    f.append((const char *)key, 4);
+    for (size_t i = 0; i < payload.size(); i++)
+        f += (char)(payload[i] ^ key[i & 3]);
+    return f;
+}
+
+//---------------------------------------------------------------------------------
+//-- A read may take bytes and give no payload (request, control frames), so
+//   read until the connection has nothing left
+static std::string readAll(ScriptedTcp &tcp, WsClientTable &table, UINT8 slot, UINT32 chunk)
+{
+    std::string payload;
+    UINT8 buffer[512];
+    while (!tcp.in[slot].empty() && (table.mask() & (1 << slot)))
+    {
+        UINT32 n = table.read(slot, buffer, chunk);
+        payload.append((const char *)buffer, n);
+    }
+    return payload;
+}
+
+//---------------------------------------------------------------------------------
+static void open(ScriptedTcp &tcp, WsClientTable &table, UINT8 slot)
+{
+    tcp.pending = 1;
+    table.poll(0);
+    tcp.in[slot] = request(WS_PATH);
+    readAll(tcp, table, slot, 512);
+    tcp.out[slot].clear();
+}
+
+//---------------------------------------------------------------------------------
+static void test_handshake()
+{
+    ScriptedTcp tcp;
+    WsClientTable table;
+    table.begin(&tcp, 81);
+    CHECK(table.enabled());
+
+    //-- Read a few bytes at a time, the answer comes with the empty line
+    tcp.pending = 2;
+    CHECK(table.poll(0) == 3);
+    CHECK(!table.open(0));
+    tcp.in[0] = request(WS_PATH);
+    CHECK(readAll(tcp, table, 0, 7).empty());
+    CHECK(table.open(0));
+    CHECK(tcp.out[0].find("HTTP/1.1 101 Switching Protocols\r\n") == 0);
+    CHECK(tcp.out[0].find("\r\nSec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n\r\n") != std::string::npos);
+    CHECK(table.getStats().upgraded == 1);
+
+    //-- Anything else is answered 400 and closed
+    tcp.in[1] = request("/other");
+    CHECK(readAll(tcp, table, 1, 512).empty());
+    CHECK(tcp.out[1].find("HTTP/1.1 400") == 0);
+    CHECK(!tcp.open[1]);
+    CHECK(table.mask() == 1);
+    CHECK(table.getStats().bad_requests == 1);
+
+    //-- So is a connection that sends no request in time
+    tcp.pending = 1;
+    CHECK(table.poll(100) == 2);
+    table.flush(100 + WS_HANDSHAKE_TIMEOUT - 1);
+    CHECK(table.mask() == 3);
+    table.flush(100 + WS_HANDSHAKE_TIMEOUT);
+    CHECK(table.mask() == 1);
+    CHECK(table.getStats().bad_requests == 2);
+}
+
+//---------------------------------------------------------------------------------
+static void test_frames()
+{
+    ScriptedTcp tcp;
+    WsClientTable table;
+    table.begin(&tcp, 81);
+    open(tcp, table, 0);
+
+    //-- Data frames come out unmasked and back to back, whatever the reads
+    std::string big(300, 'x');
+    for (size_t i = 0; i < big.size(); i++)
+        big[i] = (char)i;
+    tcp.in[0] = frame(0x2, "hello") + frame(0x2, "wor", false) + frame(0x0, "ld") + frame(0x2, big);
+    CHECK(readAll(tcp, table, 0, 5) == "helloworld" + big);
+    tcp.in[0] = frame(0x2, "hello") + frame(0x2, big);
+    CHECK(readAll(tcp, table, 0, 512) == "hello" + big);
+    CHECK(table.getStats().messages_in == 6);
+
+    //-- A ping between data frames is answered with the same payload
+    tcp.in[0] = frame(0x2, "ab") + frame(0x9, "ping!") + frame(0x2, "cd");
+    CHECK(readAll(tcp, table, 0, 512) == "abcd");
+    CHECK(tcp.out[0] == std::string("\x8A\x05ping!", 7));
+    CHECK(table.getStats().pings == 1);
+
+    //-- Close is echoed, then the connection goes
+    tcp.out[0].clear();
+    tcp.in[0] = frame(0x8, std::string("\x03\xE8", 2));
+    CHECK(readAll(tcp, table, 0, 512).empty());
+    CHECK(tcp.out[0] == std::string("\x88\x02\x03\xE8", 4));
+    CHECK(!tcp.open[0] && table.mask() == 0);
+    CHECK(table.getStats().closes == 1);
+
+    //-- An unmasked frame is a protocol error (1002)
+    open(tcp, table, 0);
+    tcp.in[0] = std::string("\x82\x02hi", 4);
+    CHECK(readAll(tcp, table, 0, 512).empty());
+    CHECK(tcp.out[0] == std::string("\x88\x02\x03\xEA", 4));
+    CHECK(!tcp.open[0]);
+    CHECK(table.getStats().protocol_errors == 1);
+}
+
+//---------------------------------------------------------------------------------
+static void test_send()
+{
+    ScriptedTcp tcp;
+    WsClientTable table;
+    table.begin(&tcp, 81);
+    open(tcp, table, 0);
+    tcp.pending = 1;
+    table.poll(0);
+
+    //-- Only clients past the handshake get the downlink
+    std::string a(100, 'a');
+    CHECK(table.send((const UINT8 *)a.data(), a.size(), 1) == 1);
+    CHECK(tcp.out[0] == std::string("\x82\x64", 2) + a);
+    CHECK(tcp.out[1].empty());
+    CHECK(table.getStats().messages_out == 1);
+
+    //-- The header and the datagram are queued, or trimmed, as one piece
+    std::string b(1000, 'b');
+    tcp.out[0].clear();
+    tcp.window[0] = 1;
+    table.send((const UINT8 *)b.data(), b.size(), 2);
+    CHECK(tcp.out[0] == "\x82");
+    CHECK(table.connections().queued(0) == 3 + b.size());
+    CHECK(table.send((const UINT8 *)b.data(), b.size(), 3) == 1);
+    CHECK(table.send((const UINT8 *)b.data(), b.size(), 4) == 0);
+    CHECK(table.connections().queued(0) == 2 * (4 + b.size()) - 1);
+    CHECK(table.connections().at(0).trimmed == 4 + b.size());
+    tcp.window[0] = 4096;
+    table.flush(5);
+    std::string message = std::string("\x82\x7E\x03\xE8", 4) + b;
+    CHECK(tcp.out[0] == message + message);
+}
+
+//---------------------------------------------------------------------------------
+//-- A Close behind queued messages goes out after them, then the connection
+static void test_close_queued()
+{
+    ScriptedTcp tcp;
+    WsClientTable table;
+    table.begin(&tcp, 81);
+    open(tcp, table, 0);
+
+    std::string a(100, 'a');
+    tcp.window[0] = 1;
+    CHECK(table.send((const UINT8 *)a.data(), a.size(), 1) == 1);
+    tcp.in[0] = frame(0x8, std::string("\x03\xE8", 2)) + frame(0x2, "late");
+    CHECK(readAll(tcp, table, 0, 512).empty());
+    CHECK(tcp.open[0] && table.mask() == 1);
+    CHECK(!table.open(0));
+    CHECK(table.send((const UINT8 *)a.data(), a.size(), 2) == 0);
+    CHECK(table.getStats().messages_in == 0);
+    tcp.window[0] = 4096;
+    table.flush(3);
+    CHECK(tcp.out[0] == std::string("\x82\x64", 2) + a + std::string("\x88\x02\x03\xE8", 4));
+    CHECK(!tcp.open[0] && table.mask() == 0);
+
+    //-- The same for a protocol error, or the stall timeout when the client
+    //   stops reading
+    open(tcp, table, 0);
+    tcp.window[0] = 1;
+    table.send((const UINT8 *)a.data(), a.size(), 10);
+    tcp.in[0] = std::string("\x82\x02hi", 4);
+    CHECK(readAll(tcp, table, 0, 512).empty());
+    CHECK(tcp.open[0]);
+    tcp.window[0] = 0;
+    table.flush(10 + TCP_STALL_TIMEOUT - 1);
+    CHECK(tcp.open[0]);
+    table.flush(10 + TCP_STALL_TIMEOUT);
+    CHECK(!tcp.open[0] && table.mask() == 0);
+    CHECK(table.getStats().protocol_errors == 1);
+}
+
+//---------------------------------------------------------------------------------
+int main()
+{
+    test_handshake();
+    test_frames();
+    test_send();
+    test_close_queued();
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All WebSocket client tests passed\n");
+    return 0;
+}